@@ -24,31 +24,25 @@ private:
   class Factor {
   public:
     FIELD_TYPE type;
-    Field field;
+    Field field; // the value of a constant
+    std::string name; // the text of the factor: the operator, the variable or the constant
     int const_opr_var; // +1 for const, 0 for operator, -1 for variable
     int rel_offset;
+    bool too_long; // a string constant longer than any STR20 field, so that it equals none
 
     Factor(FIELD_TYPE t, int con, int int_val, std::string& str_val, int off) {
       type = t;
       const_opr_var = con;
       rel_offset = off;
+      name = str_val;
+      too_long = false;
       if (con == 1) {
         if (type == INT) {
           field.integer = int_val;
-        } else {
-          field.str = new std::string(str_val);
+        } else if (!field.str.assign(str_val)) {
+          too_long = true;
         }
-      } else {
-        field.str = new std::string(str_val);
       }
-      //      if (con == false) {
-      //        return;
-      //      }
-      //      if (t == INT) {
-      //        field.integer = int_val;
-      //      } else {
-      //        field.str = new std::string(str_val);
-      //      }
     }
 
     void printFactor() {
@@ -63,9 +57,9 @@ private:
       std::string str_or_int = "INT";
       if (type == STR20) {
         str_or_int = "STR20";
-        std::cout << tf << " :: " << str_or_int << " :: " << (*(field.str)) << "\n";
+        std::cout << tf << " :: " << str_or_int << " :: " << name << "\n";
       } else if (const_opr_var == -1){
-        std::cout << tf << " :: " << str_or_int << " :: " << (*(field.str)) << "\n";
+        std::cout << tf << " :: " << str_or_int << " :: " << name << "\n";
       } else {
         std::cout << tf << " :: " << str_or_int << " :: " << field.integer << "\n";
       }
@@ -121,7 +115,7 @@ public:
       if (postfix[i].const_opr_var == -1 || postfix[i].const_opr_var == 1) {
         st.push(&postfix[i]);
       } else {
-        if (*(postfix[i].field.str) == "NOT") {
+        if (postfix[i].name == "NOT") {
           continue;
         }
 
@@ -133,19 +127,15 @@ public:
         if (f1->const_opr_var == 1) {
           if (f2->const_opr_var == -1) {
             if (f2->type == INT) {
-              int converted_val = stoi(*(f1->field.str));
               f1->type = INT;
-              delete f1->field.str;
-              f1->field.integer = converted_val;
+              f1->field.integer = stoi(f1->name);
             }
           }
         } else if (f2->const_opr_var == 1) {
           if (f1->const_opr_var == -1) {
             if (f1->type == INT) {
-              int converted_val = stoi(*(f2->field.str));
               f2->type = INT;
-              delete f2->field.str;
-              f2->field.integer = converted_val;
+              f2->field.integer = stoi(f2->name);
             }
           }
         }
@@ -153,12 +143,28 @@ public:
       }
     }
 
+    // String constants of a dictionary-encoded relation are compared by their codes
+    for (int i = 0; i < postfix.size(); ++i) {
+      if (postfix[i].const_opr_var == 1 && postfix[i].type == STR20 && !postfix[i].too_long) {
+        postfix[i].field.str.code = rel->getDictionaryCode(postfix[i].name);
+      }
+    }
+
     //    for (int i = 0; i < postfix.size(); ++i) {
     //      postfix[i].printFactor();
     //    }
   }
 
-  bool evaluate(Tuple& tup) {
+  // Sets the flags of the fields the condition reads, indexed by the field offset
+  void markReferencedFields(std::vector<bool>& fields) const {
+    for (int i = 0; i < postfix.size(); ++i) {
+      if (postfix[i].const_opr_var == -1) {
+        fields[postfix[i].rel_offset] = true;
+      }
+    }
+  }
+
+  bool evaluate(const Tuple& tup) {
     std::stack<std::pair<FIELD_TYPE, Field> > st;
 
     Field f_true, f_false;
@@ -173,7 +179,7 @@ public:
       } else if (postfix[i].const_opr_var == -1) {
         st.push(std::make_pair(postfix[i].type, tup.getField(postfix[i].rel_offset)));
       } else {
-        std::string& opr = *(postfix[i].field.str);
+        std::string& opr = postfix[i].name;
         if (opr == "NOT") {
           std::pair<FIELD_TYPE, Field> f = st.top();
           st.pop();
@@ -219,7 +225,9 @@ public:
               st.push(bool_false);
             }
           } else {
-            if (*(f1.second.str) == *(f2.second.str)) {
+            // no operator yields a string, so the two strings are the factors before this one
+            if (!postfix[i - 1].too_long && !postfix[i - 2].too_long &&
+                f1.second.str == f2.second.str) {
               st.push(bool_true);
             } else {
               st.push(bool_false);
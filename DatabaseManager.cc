@@ -3,11 +3,15 @@
 
 #include <string>
 #include <algorithm>
+#include <cerrno>
+#include <climits>
 #include <unordered_map>
 #include <unordered_set>
 #include <list>
 #include <queue>
 #include <fstream>
+#include <functional>
+#include <sstream>
 
 #include "./StorageManager/Block.h"
 #include "./StorageManager/Config.h"
@@ -18,10 +22,14 @@
 #include "./StorageManager/Schema.h"
 #include "./StorageManager/SchemaManager.h"
 #include "./StorageManager/Tuple.h"
+#include "arena.cc"
 #include "utils.cc"
 #include "parser.cc"
 #include "parse_tree.cc"
 #include "MemoryManager.cc"
+#include "scanner.cc"
+#include "loader.cc"
+#include "profiler.cc"
 #include "ConditionEvaluator.cc"
 
 class DatabaseManager {
@@ -30,41 +38,52 @@ private:
   Disk* disk;
   SchemaManager schema_manager;
   MemoryManager mManager;
+  QueryProfiler profiler; // the I/O breakdown of the last query
+  bool print_profile;
+  Prefetcher prefetcher;
+  bool prefetch; // joins and merges read their next blocks on the I/O thread
   std::vector<std::string> temp_relations;
   std::vector<std::string> tokens;
+  Arena arena; // parse trees and other objects of the current query; reset after every query
+  bool dictionary_encoding;
+  enum BLOCK_LAYOUT block_layout;
   std::ofstream fout;
 
-  bool appendTupleToRelation(Relation* relation_ptr, int memory_block_index, Tuple& tuple) {
-    Block* block_ptr;
-    if (relation_ptr->getNumOfBlocks() == 0) {
-      //cout << "The relation is empty" << endl;
-      //cout << "Get the handle to the memory block " << memory_block_index << " and clear it" << endl;
-      block_ptr = mem->getBlock(memory_block_index);
-      block_ptr->clear(); //clear the block
-      block_ptr->appendTuple(tuple); // append the tuple
-      //cout << "Write to the first block of the relation" << endl;
-      relation_ptr->setBlock(relation_ptr->getNumOfBlocks(), memory_block_index);
-    } else {
-      //cout << "Read the last block of the relation into memory block: " << memory_block_index << endl;
-      relation_ptr->getBlock(relation_ptr->getNumOfBlocks() - 1, memory_block_index);
-      block_ptr = mem->getBlock(memory_block_index);
-
-      if (block_ptr->isFull()) {
-        //cout << "(The block is full: Clear the memory block and append the tuple)" << endl;
-        block_ptr->clear(); //clear the block
-        block_ptr->appendTuple(tuple); // append the tuple
-        //cout << "Write to a new block at the end of the relation" << endl;
-        relation_ptr->setBlock(relation_ptr->getNumOfBlocks(), memory_block_index); //write back to the relation
-      } else {
-        //cout << "(The block is not full: Append it directly)" << endl;
-        block_ptr->appendTuple(tuple); // append the tuple
-        //cout << "Write to the last block of the relation" << endl;
-        relation_ptr->setBlock(relation_ptr->getNumOfBlocks()-1,memory_block_index); //write back to the relation
-      }
+  // Reads an INT field from its text; returns false if it is not a number
+  bool parseIntField(const std::string& value, int& number) {
+    char* end;
+    errno = 0;
+    long parsed = strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) {
+      return false;
     }
+    number = (int)parsed;
     return true;
   }
 
+  // Returns true if the text is a value of the field type. Nothing is stored, so that
+  // not even the dictionary learns a string
+  bool checkFieldString(enum FIELD_TYPE type, const std::string& value) {
+    if (type == INT) {
+      int number;
+      return parseIntField(value, number);
+    }
+    Str20 scratch;
+    return scratch.assign(value);
+  }
+
+  // Sets a field of the tuple from its text; returns false if an INT field is not a number
+  bool setFieldFromString(Tuple& tuple, int offset, const std::string& value) {
+    if (tuple.getSchema().getFieldType(offset) == INT) {
+      int number;
+      if (!parseIntField(value, number)) {
+        return false;
+      }
+      return tuple.setField(offset, number);
+    }
+    return tuple.setField(offset, value);
+  }
+
   bool appendTupleToMemBlock(int memory_block_index, Tuple& tuple) {
     Block* block_ptr;
     block_ptr = mem->getBlock(memory_block_index);
@@ -77,7 +96,7 @@ private:
     return true;
   }
 
-  bool appendTupleToMemBlock(Block* block_ptr, Tuple& tuple) {
+  bool appendTupleToMemBlock(Block* block_ptr, const Tuple& tuple) {
     if(block_ptr->isFull()) {
       return false;
     } else {
@@ -91,15 +110,50 @@ private:
     cout << str;
   }
 
-  void printAndLog(Tuple tuple) {
+  void printAndLog(const Tuple& tuple) {
     tuple.printTuple(fout);
     tuple.printTuple(std::cout);
   }
 
 public:
-  DatabaseManager(MainMemory* m, Disk* d) : schema_manager(m, d), mManager(m) , fout("log.txt", std::ofstream::out) {
+  DatabaseManager(MainMemory* m, Disk* d) : schema_manager(m, d), mManager(m), profiler(d), prefetcher(d), fout("log.txt", std::ofstream::out) {
     this->mem = m;
     this->disk = d;
+    this->dictionary_encoding = false;
+    this->block_layout = ROW_LAYOUT;
+    this->print_profile = false;
+    this->prefetch = false;
+  }
+
+  // Relations created from now on store their STR20 fields dictionary-encoded
+  void setDictionaryEncoding(bool dictionary_encoding) {
+    this->dictionary_encoding = dictionary_encoding;
+  }
+
+  // Relations created from now on lay out their disk blocks this way
+  void setBlockLayout(enum BLOCK_LAYOUT block_layout) {
+    this->block_layout = block_layout;
+  }
+
+  // Prints the I/O breakdown of every query after its Execution Time
+  void setPrintProfile(bool print_profile) {
+    this->print_profile = print_profile;
+  }
+
+  // Joins and the merges of the two-pass algorithms read their next blocks on the I/O thread
+  // while they work on the current ones, so that the wall time overlaps the disk latency
+  void setPrefetch(bool prefetch) {
+    this->prefetch = prefetch;
+  }
+
+  // The order in which the I/O thread serves the reads queued by prefetching
+  void setIOScheduling(enum IO_SCHEDULING_POLICY policy) {
+    prefetcher.setPolicy(policy);
+  }
+
+  // The disk I/Os and times of the last query, by operator and by relation
+  const QueryProfiler& getLastQueryProfile() const {
+    return profiler;
   }
 
   ~DatabaseManager() {
@@ -114,7 +168,17 @@ public:
     Utils::getAttributeTypeList(root, column_names, data_types);
     //Create schema and Create Relation
     Schema schema(column_names, data_types);
-    return schema_manager.createRelation(table_name,schema);
+    return schema_manager.createRelation(table_name,schema, dictionary_encoding, block_layout);
+  }
+
+  // Creates a relation of the query, deleted once the query ends; returns nullptr if the
+  // name is taken
+  Relation* createTempRelation(const std::string& name, const Schema& schema) {
+    Relation* rel = schema_manager.createRelation(name, schema, dictionary_encoding, block_layout, true);
+    if (rel != nullptr) {
+      temp_relations.push_back(name);
+    }
+    return rel;
   }
 
   bool processCreateTableStatement(ParseTreeNode* root) {
@@ -127,25 +191,39 @@ public:
 
   bool processDropTableStatement(ParseTreeNode* root) {
     std::string table_name = Utils::getTableName(root);
+    if (schema_manager.relationExists(table_name)) {
+      mManager.forgetRelation(schema_manager.getRelation(table_name));
+    }
     return schema_manager.deleteRelation(table_name);
   }
 
-  bool insertTuplesIntoTable(std::string table_name, std::vector<Tuple> tuples) {
+  bool insertTuplesIntoTable(std::string table_name, const std::vector<Tuple>& tuples) {
+    OperatorScope scope(profiler, "insert", table_name);
     Relation* r = schema_manager.getRelation(table_name);
-    bool result = true;
-    int free_block_index = mManager.getFreeBlockIndex();
-    if (free_block_index == -1) {
+    TableLoader loader(r, mem, mManager);
+    if (!loader.open(mManager.numFreeBlocks())) {
       return false;
     }
     for(int i = 0; i < tuples.size(); i++) {
-      result = appendTupleToRelation(r, free_block_index, tuples[i]);
-      if(!result) {
-        mManager.releaseBlock(free_block_index);
+      if(!loader.append(tuples[i])) {
         return false;
       }
     }
-    mManager.releaseBlock(free_block_index);
-    return true;
+    return loader.close();
+  }
+
+  // A tuple of r with the listed fields of a tuple of the SELECT of an INSERT
+  Tuple createInsertedTuple(Relation* r, const std::vector<std::string>& att_list, const Tuple& tuple) {
+    Tuple t = r->createTuple();
+    Schema s = r->getSchema();
+    for (int k = 0; k < att_list.size(); ++k) {
+      FIELD_TYPE f = s.getFieldType(att_list[k]);
+      if(f == INT)
+        t.setField(att_list[k], tuple.getField(att_list[k]).integer);
+      else
+        t.setField(att_list[k], tuple.getField(att_list[k]).str);
+    }
+    return t;
   }
 
   bool processInsertStatement(ParseTreeNode* root) {
@@ -155,90 +233,216 @@ public:
       return false;
     }
 
-    std::vector<Tuple> insert_tuples;
-
     if(root->children[4]->children[0]->type == NODE_TYPE::VALUES_LITERAL) {
+      std::vector<Tuple> insert_tuples;
+
       // get attribute_list
       std::vector<std::string> att_list;
       Utils::getAttributeList(root, att_list);
 
-      // get value_list
-      std::vector<std::string> value_list;
-      Utils::getValueList(root, value_list);
+      // get one value_list per tuple
+      std::vector<std::vector<std::string>> value_lists;
+      Utils::getValueLists(root, value_lists);
 
       // get schema from relation
       Schema s = r->getSchema();
-      Tuple t = r->createTuple();
-
-
-      // get field types from schema
-      for (int i = 0; i < att_list.size(); ++i) {
-        FIELD_TYPE f = s.getFieldType(att_list[i]);
-        bool result = true;
-        if (f == INT) {
-          int value = stoi(value_list[i], nullptr, 10);
-          result = t.setField(att_list[i], value);
-        } else {
-          result = t.setField(att_list[i], value_list[i]);
-        }
-        if (result == false) {
+
+      for (int j = 0; j < value_lists.size(); ++j) {
+        std::vector<std::string>& value_list = value_lists[j];
+        if (value_list.size() != att_list.size()) {
           return false;
         }
+        Tuple t = r->createTuple();
+        for (int i = 0; i < att_list.size(); ++i) {
+          int offset = s.getFieldOffset(att_list[i]);
+          if (offset == -1 || !setFieldFromString(t, offset, value_list[i])) {
+            return false;
+          }
+        }
+        insert_tuples.push_back(t);
       }
-      insert_tuples.push_back(t);
+      return insertTuplesIntoTable(table_name, insert_tuples);
     }
     else {
-      //processSelectSingleTable(root->children[4]->children[0], insert_tuples);
+      // The SELECT is done before anything is inserted: its output is a relation of its
+      // own or memory blocks, never the target, so that a target that is also the source
+      // is not read while it grows. That output is loaded into the target as it is read
       ParseTreeNode* select_tree_root = root->children[4]->children[0];
       std::vector<int> returnMemBlockIndices;
       std::vector<std::string> att_list;
       Utils::getAttributeList(root, att_list);
-      Schema s = r->getSchema();
-      
+
       Relation *rel = processSelectMultiTable(select_tree_root, true, returnMemBlockIndices);
+      OperatorScope scope(profiler, "insert", table_name);
       if(rel == nullptr) {
-        for(int i = 0; i < returnMemBlockIndices.size(); i++) {
+        // the loader needs a block: the tuples of the last output block are copied out if
+        // the output takes every block
+        std::vector<Tuple> last_tuples;
+        if (mManager.numFreeBlocks() == 0 && !returnMemBlockIndices.empty()) {
+          Block* block = mem->getBlock(returnMemBlockIndices.back());
+          for(const Tuple& tuple : *block) {
+            last_tuples.push_back(createInsertedTuple(r, att_list, tuple));
+          }
+          mManager.releaseBlock(returnMemBlockIndices.back());
+          returnMemBlockIndices.pop_back();
+        }
+        TableLoader loader(r, mem, mManager);
+        bool result = loader.open(mManager.numFreeBlocks());
+        for(int i = 0; result && i < returnMemBlockIndices.size(); i++) {
           Block* block = mem->getBlock(returnMemBlockIndices[i]);
-          std::vector<Tuple> tuples = block->getTuples();
-          for(int j = 0; j < tuples.size(); j++) {
-            Tuple t = r->createTuple();
-            for (int k = 0; k < att_list.size(); ++k) {
-              FIELD_TYPE f = s.getFieldType(att_list[k]);
-              if(f == INT)
-                t.setField(att_list[k], tuples[j].getField(att_list[k]).integer);
-              else
-                t.setField(att_list[k], *(tuples[j].getField(att_list[k]).str));
+          for(const Tuple& tuple : *block) {
+            if (!loader.append(createInsertedTuple(r, att_list, tuple))) {
+              result = false;
+              break;
             }
-            insert_tuples.push_back(t);
           }
         }
+        for(int i = 0; result && i < last_tuples.size(); i++) {
+          result = loader.append(last_tuples[i]);
+        }
+        result = loader.close() && result;
+        mManager.releaseNBlocks(returnMemBlockIndices);
+        return result;
       }
       else {
-        for(int i = 0; i < rel->getNumOfBlocks(); i++) {
-          int free_block_index = mManager.getFreeBlockIndex();
-          rel->getBlock(i, free_block_index);
-          Block* mem_block = mem->getBlock(free_block_index);
-          std::vector<Tuple> tuples = mem_block->getTuples();
-          for(int j = 0; j < tuples.size(); j++) {
-            Tuple t = r->createTuple();
-            for (int k = 0; k < att_list.size(); ++k) {
-              FIELD_TYPE f = s.getFieldType(att_list[k]);
-              if(f == INT)
-                t.setField(att_list[k], tuples[j].getField(att_list[k]).integer);
-              else
-                t.setField(att_list[k], *(tuples[j].getField(att_list[k]).str));
+        // the scan and the loader share the free blocks
+        TableScanner scanner(rel, mem, mManager);
+        if (!scanner.open(std::max(1, mManager.numFreeBlocks() / 2))) {
+          return false;
+        }
+        TableLoader loader(r, mem, mManager);
+        if (!loader.open(mManager.numFreeBlocks())) {
+          return false;
+        }
+        while (scanner.nextBatch()) {
+          for (int i = 0; i < scanner.getBatchSize(); i++) {
+            for(const Tuple& tuple : *scanner.getBlock(i)) {
+              if (tuple.isNull()) {
+                continue;
+              }
+              if (!loader.append(createInsertedTuple(r, att_list, tuple))) {
+                return false;
+              }
             }
-            insert_tuples.push_back(t);
           }
         }
+        scanner.close();
+        return loader.close();
+      }
+    }
+
+  }
+
+  // Splits a line of a CSV or TSV file; a field may be quoted to hold the delimiter
+  void splitDelimitedLine(const std::string& line, char delimiter, std::vector<std::string>& values) {
+    values.clear();
+    std::string value;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+      if (line[i] == '"') {
+        quoted = !quoted;
+      } else if (line[i] == delimiter && !quoted) {
+        values.push_back(value);
+        value.clear();
+      } else if (line[i] != '\r') {
+        value += line[i];
+      }
+    }
+    values.push_back(value);
+  }
+
+  // COPY table_name FROM "file": one tuple per line with the fields in the order of the schema,
+  // separated by commas, or by tabs if the file name ends with .tsv.
+  // The whole file is checked before any tuple is loaded, so a bad line loads nothing
+  bool processCopyStatement(ParseTreeNode* root) {
+    std::string table_name = root->children[1]->value;
+    std::string file_name = root->children[3]->value;
+    OperatorScope scope(profiler, "copy", table_name);
+    Relation* r = schema_manager.getRelation(table_name);
+    if (r == nullptr) {
+      return false;
+    }
+    std::ifstream fin(file_name);
+    if (!fin) {
+      std::cerr << "COPY ERROR: cannot open " << file_name << std::endl;
+      return false;
+    }
+    char delimiter = ',';
+    if (file_name.size() >= 4 && file_name.compare(file_name.size() - 4, 4, ".tsv") == 0) {
+      delimiter = '\t';
+    }
+
+    Tuple t = r->createTuple();
+    std::string line;
+    for (int line_number = 1; std::getline(fin, line); ++line_number) {
+      if (!readDelimitedTuple(line, delimiter, t, file_name, line_number, false)) {
+        return false;
       }
     }
 
-    return insertTuplesIntoTable(table_name, insert_tuples);
+    fin.clear();
+    fin.seekg(0);
+    TableLoader loader(r, mem, mManager);
+    if (!loader.open(mManager.numFreeBlocks())) {
+      return false;
+    }
+    for (int line_number = 1; std::getline(fin, line); ++line_number) {
+      if (line.empty() || line == "\r") {
+        continue;
+      }
+      readDelimitedTuple(line, delimiter, t, file_name, line_number, true);
+      if (!loader.append(t)) {
+        return false;
+      }
+    }
+    return loader.close();
+  }
+
+  // Checks a line of a COPY file and, if set_fields, sets the fields of t from it; an empty
+  // line is accepted and leaves t as it is. Returns false and prints why if the line is bad
+  bool readDelimitedTuple(const std::string& line, char delimiter, Tuple& t,
+                          const std::string& file_name, int line_number, bool set_fields) {
+    if (line.empty() || line == "\r") {
+      return true;
+    }
+    std::vector<std::string> values;
+    splitDelimitedLine(line, delimiter, values);
+    int num_fields = t.getNumOfFields();
+    if (values.size() != num_fields) {
+      std::cerr << "COPY ERROR: line " << line_number << " of " << file_name << " has "
+                << values.size() << " fields for " << num_fields << " columns" << std::endl;
+      return false;
+    }
+    for (int i = 0; i < num_fields; ++i) {
+      if (!checkFieldString(t.getSchema().getFieldType(i), values[i]) ||
+          (set_fields && !setFieldFromString(t, i, values[i]))) {
+        std::cerr << "COPY ERROR: line " << line_number << " of " << file_name
+                  << " has a bad value " << values[i] << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool processSaveStatement(ParseTreeNode* root) {
+    return schema_manager.saveImage(root->children[2]->value);
+  }
+
+  // The cached pages of every table are dropped: the tables are replaced by new ones
+  bool processLoadStatement(ParseTreeNode* root) {
+    std::vector<std::string> names;
+    schema_manager.getRelationNames(names);
+    for (int i = 0; i < names.size(); ++i) {
+      mManager.forgetRelation(schema_manager.getRelation(names[i]));
+    }
+    return schema_manager.loadImage(root->children[2]->value);
   }
 
   void removeTempRelations() {
     for(int i = 0; i < temp_relations.size(); i++) {
+      if (schema_manager.relationExists(temp_relations[i])) {
+        mManager.forgetRelation(schema_manager.getRelation(temp_relations[i]));
+      }
       schema_manager.deleteRelation(temp_relations[i]);
     }
     temp_relations.clear();
@@ -246,6 +450,7 @@ public:
 
   bool processDeleteStatement(ParseTreeNode* root) {
     std::string tableName = root->children[2]->value;
+    OperatorScope scope(profiler, "delete", tableName);
     Relation* rel = schema_manager.getRelation(tableName);
 
     if (root->children.size() == 3) {
@@ -256,41 +461,76 @@ public:
     ConditionEvaluator eval;
     eval.initialize(root->children[4], rel);
 
-    int inMemBlockIndex = mManager.getFreeBlockIndex();
-    int outMemBlockIndex = mManager.getFreeBlockIndex();
-    if (inMemBlockIndex == -1 || outMemBlockIndex == -1) {
+    TableScanner scanner(rel, mem, mManager);
+    if (!scanner.open(mManager.numFreeBlocks())) {
       return false;
     }
-    Block* outMemBlockPtr = mem->getBlock(outMemBlockIndex);
-
-    int writeBlockIndex = 0;
+    // The deleted tuples are nulled in place: only the blocks that lose a tuple are
+    // written back, and the holes are reused by later insertions.
+    // A block left without tuples is not written yet: it is dropped if only such blocks
+    // follow it, and written as a block of holes otherwise
     int numBlocks = rel->getNumOfBlocks();
-    for (int i = 0; i < numBlocks; ++i) {
-      rel->getBlock(i, inMemBlockIndex);
-      Block* inMemBlockPtr = mem->getBlock(inMemBlockIndex);
-      std::vector<Tuple> tuples = inMemBlockPtr->getTuples();
-      for (int j = 0; j < tuples.size(); ++j) {
-        bool ans = true;
-        ans = eval.evaluate(tuples[j]);
-
-        if (!ans) {
-          if(!appendTupleToMemBlock(outMemBlockPtr, tuples[j])) {
-            rel->setBlock(writeBlockIndex, outMemBlockIndex);
-            outMemBlockPtr->clear();
-            appendTupleToMemBlock(outMemBlockPtr, tuples[j]);
-            writeBlockIndex++;
+    std::vector<int> deletedOffsets;
+    std::vector<bool> emptied(numBlocks, false);
+    while (scanner.nextBatch()) {
+      for (int k = 0; k < scanner.getBatchSize(); ++k) {
+        Block* inMemBlockPtr = scanner.getBlock(k);
+        deletedOffsets.clear();
+        int offset = 0;
+        int numLeft = 0;
+        for (const Tuple& tuple : *inMemBlockPtr) {
+          if (!tuple.isNull() && eval.evaluate(tuple)) {
+            deletedOffsets.push_back(offset);
+          } else if (!tuple.isNull()) {
+            numLeft++;
+          }
+          offset++;
+        }
+
+        if (!deletedOffsets.empty()) {
+          for (int j = 0; j < deletedOffsets.size(); ++j) {
+            inMemBlockPtr->nullTuple(deletedOffsets[j]);
+          }
+          if (numLeft == 0) {
+            emptied[scanner.getRelationBlockIndex(k)] = true;
+          } else {
+            rel->setBlock(scanner.getRelationBlockIndex(k), scanner.getMemoryBlockIndex(k));
           }
         }
       }
     }
+    scanner.close();
 
-    if (!outMemBlockPtr->isEmpty()) {
-      rel->setBlock(writeBlockIndex, outMemBlockIndex);
-      outMemBlockPtr->clear();
-      writeBlockIndex++;
+    // Trailing blocks left without tuples are dropped
+    int lastBlockIndex = numBlocks - 1;
+    while (lastBlockIndex >= 0 && (emptied[lastBlockIndex] || rel->getNumOfTuples(lastBlockIndex) == 0)) {
+      lastBlockIndex--;
+    }
+    if (lastBlockIndex + 1 < numBlocks) {
+      rel->deleteBlocks(lastBlockIndex + 1);
+    }
+    // The emptied blocks before them hold nothing but holes, so they are written without
+    // being read again
+    int holesBlockIndex = -1;
+    for (int i = 0; i <= lastBlockIndex; ++i) {
+      if (!emptied[i]) {
+        continue;
+      }
+      if (holesBlockIndex == -1 && (holesBlockIndex = mManager.getFreeBlockIndex()) == -1) {
+        return false;
+      }
+      Block* holes = mem->getBlock(holesBlockIndex);
+      holes->clear();
+      Tuple hole = rel->createTuple();
+      for (int j = 0; j < rel->getNumOfSlots(i); ++j) {
+        holes->appendTuple(hole);
+      }
+      holes->nullTuples();
+      rel->setBlock(i, holesBlockIndex);
+    }
+    if (holesBlockIndex != -1) {
+      mManager.releaseBlock(holesBlockIndex);
     }
-
-    rel->deleteBlocks(writeBlockIndex);
     return true;
   }
 
@@ -325,15 +565,14 @@ public:
       return;
     }
     for(int i = 0; i < nBlocks; i++) {
-      rel_ptr->getBlock(i, mem_block_indices[i]);
+      mManager.readBlock(rel_ptr, i, mem_block_indices[i]);
     }
     sortTuples(mem_block_indices, relation_name, column_name);
     printFieldNames(rel_ptr->getSchema());
     for(int i = 0; i < nBlocks; i++) {
       Block* block = mem->getBlock(mem_block_indices[i]);
-      std::vector<Tuple> tuples = block->getTuples();
-      for(int j = 0; j < tuples.size(); j++) {
-        printAndLog(tuples[j]);
+      for(const Tuple& tuple : *block) {
+        printAndLog(tuple);
         printAndLog("\n");
       }
     }
@@ -380,9 +619,9 @@ public:
         return -1;
       return 0;
     }
-    if(*field1.str > *field2.str)
+    if(field1.str > field2.str)
       return 1;
-    else if(*field1.str < *field2.str)
+    else if(field1.str < field2.str)
       return -1;
     return 0;
   }
@@ -459,7 +698,7 @@ public:
     return std::make_pair(inSchema, outSchema);
   }
 
-  void printFieldNames(Schema schema) {
+  void printFieldNames(const Schema& schema) {
     std::vector<std::string> field_names;
     field_names = schema.getFieldNames();
     for(int i = 0; i < field_names.size(); i++) {
@@ -472,6 +711,7 @@ public:
       ParseTreeNode* postFixExpr, std::vector<int>& returnMemBlockIndices,
       std::unordered_map<std::string, bool>& projListMap, bool storeOutput) {
     Relation* rel = schema_manager.getRelation(relName);
+    OperatorScope scope(profiler, "table scan", relName);
     int numBlocksInRel = rel->getNumOfBlocks();
 
     Schema curSchema = rel->getSchema();
@@ -497,19 +737,15 @@ public:
     Schema outSchema(outFieldNames, outFieldTypes);
 
     std::string outRelName = relName + "_out_tmp";
-    Relation* outRel = schema_manager.createRelation(outRelName, outSchema);
-    temp_relations.push_back(outRelName);
+    Relation* outRel = createTempRelation(outRelName, outSchema);
+    if (outRel == nullptr) {
+      return nullptr;
+    }
     relName = outRelName;
 
     bool allInMemory = true;
     std::vector<int> curMemBlockIndices;
 
-    int inMemBlockIndex = mManager.getFreeBlockIndex();
-    if (inMemBlockIndex == -1) {
-      return nullptr;
-    }
-    Block* inMemBlockPtr = mem->getBlock(inMemBlockIndex);
-
     int curMemBlockIndex = mManager.getFreeBlockIndex();
     if (curMemBlockIndex == -1) {
       return nullptr;
@@ -522,72 +758,97 @@ public:
       eval.initialize(postFixExpr, rel);
     }
 
+    // Only the projected fields and the fields of the condition are decoded
+    std::vector<bool> readFields(curFieldNames.size(), false);
+    for (int k = 0; k < oldToOut.size(); ++k) {
+      readFields[oldToOut[k]] = true;
+    }
+    if (postFixExpr != nullptr) {
+      eval.markReferencedFields(readFields);
+    }
+
+    // A stored output keeps enough free blocks to stay in memory: it takes at most
+    // as many blocks as the relation, as the projected tuples are never larger
+    TableScanner scanner(rel, mem, mManager);
+    int scanBlocks = mManager.numFreeBlocks();
+    if (storeOutput) {
+      scanBlocks -= numBlocksInRel - 1;
+    }
+    // a scan of every field reads whole blocks, which the buffer pool caches
+    bool readAllFields = std::find(readFields.begin(), readFields.end(), false) == readFields.end();
+    if (!scanner.open(scanBlocks, readAllFields ? nullptr : &readFields)) {
+      return nullptr;
+    }
+
     if (!storeOutput) {
       printFieldNames(outSchema);
     }
 
-    for (int i = 0; i < numBlocksInRel; ++i) {
-      rel->getBlock(i, inMemBlockIndex);
-      std::vector<Tuple> curTuples = inMemBlockPtr->getTuples();
-      std::vector<Tuple> outTuples;
+    while (scanner.nextBatch()) {
+      for (int b = 0; b < scanner.getBatchSize(); ++b) {
+        Block* inMemBlockPtr = scanner.getBlock(b);
+        std::vector<Tuple> outTuples;
 
-      for (int j = 0; j < curTuples.size(); ++j) {
-        bool ans = true;
-        // condition evaluator
-        if (postFixExpr != nullptr) {
-          ans = eval.evaluate(curTuples[j]);
-        }
+        for (const Tuple& curTuple : *inMemBlockPtr) {
+          if (curTuple.isNull()) {
+            continue;
+          }
+          bool ans = true;
+          // condition evaluator
+          if (postFixExpr != nullptr) {
+            ans = eval.evaluate(curTuple);
+          }
 
-        if (ans) {
-          Tuple outTuple = outRel->createTuple();
-          for (int k = 0; k < oldToOut.size(); ++k) {
-            if (curFieldTypes[oldToOut[k]] == INT) {
-              outTuple.setField(k, curTuples[j].getField(oldToOut[k]).integer);
-            } else {
-              outTuple.setField(k, *(curTuples[j].getField(oldToOut[k]).str));
+          if (ans) {
+            Tuple outTuple = outRel->createTuple();
+            for (int k = 0; k < oldToOut.size(); ++k) {
+              if (curFieldTypes[oldToOut[k]] == INT) {
+                outTuple.setField(k, curTuple.getField(oldToOut[k]).integer);
+              } else {
+                outTuple.setField(k, curTuple.getField(oldToOut[k]).str);
+              }
             }
+            outTuples.push_back(outTuple);
+            // create new Tuple according to Projection List
+            // push newTuple to newTuples
           }
-          outTuples.push_back(outTuple);
-          // create new Tuple according to Projection List
-          // push newTuple to newTuples
         }
-      }
 
-      for (int j = 0; j < outTuples.size(); ++j) {
-        if (storeOutput) {
-          if (!appendTupleToMemBlock(curMemBlockPtr, outTuples[j])) {
-            curMemBlockIndex = mManager.getFreeBlockIndex();
-            if (curMemBlockIndex == -1) {
-              for (int k = 0; k < curMemBlockIndices.size(); ++k) {
-                if (storeOutput) {
-                  outRel->setBlock(outRel->getNumOfBlocks(), curMemBlockIndices[k]);
-                } else {
-                  Block* curBlock = mem->getBlock(curMemBlockIndices[k]);
-                  std::vector<Tuple> tuplesInThisBlock = curBlock->getTuples();
-                  for (int l = 0; l < tuplesInThisBlock.size(); ++l) {
-                    printAndLog(tuplesInThisBlock[l]);
-                  }
-                }
-              }
-              allInMemory = false;
-              mManager.releaseNBlocks(curMemBlockIndices);
-              curMemBlockIndices.clear();
+        for (int j = 0; j < outTuples.size(); ++j) {
+          if (storeOutput) {
+            if (!appendTupleToMemBlock(curMemBlockPtr, outTuples[j])) {
               curMemBlockIndex = mManager.getFreeBlockIndex();
               if (curMemBlockIndex == -1) {
-                return nullptr;
+                for (int k = 0; k < curMemBlockIndices.size(); ++k) {
+                  if (storeOutput) {
+                    outRel->setBlock(outRel->getNumOfBlocks(), curMemBlockIndices[k]);
+                  } else {
+                    Block* curBlock = mem->getBlock(curMemBlockIndices[k]);
+                    for (const Tuple& tuple : *curBlock) {
+                      printAndLog(tuple);
+                    }
+                  }
+                }
+                allInMemory = false;
+                mManager.releaseNBlocks(curMemBlockIndices);
+                curMemBlockIndices.clear();
+                curMemBlockIndex = mManager.getFreeBlockIndex();
+                if (curMemBlockIndex == -1) {
+                  return nullptr;
+                }
               }
+              curMemBlockPtr = mem->getBlock(curMemBlockIndex);
+              curMemBlockIndices.push_back(curMemBlockIndex);
+              appendTupleToMemBlock(curMemBlockPtr, outTuples[j]);
             }
-            curMemBlockPtr = mem->getBlock(curMemBlockIndex);
-            curMemBlockIndices.push_back(curMemBlockIndex);
-            appendTupleToMemBlock(curMemBlockPtr, outTuples[j]);
+          } else {
+            printAndLog(outTuples[j]);
+            printAndLog("\n");
           }
-        } else {
-          printAndLog(outTuples[j]);
-          printAndLog("\n");
         }
       }
     }
-    mManager.releaseBlock(inMemBlockIndex);
+    scanner.close();
 
     if (storeOutput) {
       if (allInMemory) {
@@ -596,6 +857,12 @@ public:
         }
         return nullptr;
       } else {
+        // the blocks filled since the last spill go to the relation too
+        for (int i = 0; i < curMemBlockIndices.size(); ++i) {
+          if (!mem->getBlock(curMemBlockIndices[i])->isEmpty()) {
+            outRel->setBlock(outRel->getNumOfBlocks(), curMemBlockIndices[i]);
+          }
+        }
         mManager.releaseNBlocks(curMemBlockIndices);
         return outRel;
       }
@@ -606,6 +873,30 @@ public:
   }
 
 
+  // The disk time of a nested-loop join under the disk profile: the outer relation is read
+  // in chunks of all the free blocks but one, and the inner one once per chunk, in batches
+  // of the blocks left over (halved when they are prefetched)
+  double estimateNestedLoopTime(int outer_n, int inner_n, int free_blocks) {
+    if (outer_n == 0 || inner_n == 0) {
+      return 0;
+    }
+    int chunk = std::min(outer_n, free_blocks - 1);
+    int num_chunks = (outer_n + chunk - 1) / chunk;
+    int batch = std::max(1, std::min(inner_n, free_blocks - chunk));
+    if (prefetch && batch >= 2) {
+      batch /= 2;
+    }
+    double outer_time = (outer_n / chunk) * disk->estimateAccessTime(chunk);
+    if (outer_n % chunk > 0) {
+      outer_time += disk->estimateAccessTime(outer_n % chunk);
+    }
+    double inner_time = (inner_n / batch) * disk->estimateAccessTime(batch);
+    if (inner_n % batch > 0) {
+      inner_time += disk->estimateAccessTime(inner_n % batch);
+    }
+    return outer_time + num_chunks * inner_time;
+  }
+
   Relation* crossJoinWithCondition(std::string rSmall, std::string rLarge,
       ParseTreeNode* postFixExpr, std::unordered_map<std::string, bool>& selectListMap,
       std::unordered_map<std::string, bool>& projListMap, bool storeOutput) {
@@ -619,6 +910,7 @@ public:
       std::swap(small, large);
       std::swap(rSmall, rLarge);
     }
+    OperatorScope scope(profiler, "cross join", rSmall + ", " + rLarge);
 
     Schema inputSchema;
     Schema outputSchema;
@@ -634,18 +926,32 @@ public:
 
     //create new relation
     std::string rIn = rSmall + "_" + rLarge + "_select";
-    Relation* inRelation = schema_manager.createRelation(rIn, inSchema);
+    Relation* inRelation = createTempRelation(rIn, inSchema);
 
     std::string rOut = rSmall + "_" + rLarge;
-    Relation* outRelation = schema_manager.createRelation(rOut, outSchema);
-
-    temp_relations.push_back(rIn);
-    temp_relations.push_back(rOut);
+    Relation* outRelation = createTempRelation(rOut, outSchema);
+    if (inRelation == nullptr || outRelation == nullptr) {
+      return nullptr;
+    }
 
-    int large_mem_block_index = mManager.getFreeBlockIndex();
-    if (large_mem_block_index == -1 ) {
+    // The plan of the join: an output block if the output is stored, the outer relation
+    // read in chunks of all the other free blocks but one, and the inner one in the blocks
+    // left over, once per chunk. The small relation is the outer one unless the large one
+    // takes less disk time under the disk profile, as it may when the memory holds neither:
+    // fewer chunks of the large one can outweigh its extra blocks.
+    // Only the inner one is prefetched: halving the chunks of the outer one would
+    // make the inner one read more times.
+    // The join is granted the blocks of its plan, and each side the blocks of its part
+    int output_blocks = storeOutput ? 1 : 0;
+    int free_blocks = mManager.numFreeBlocks() - output_blocks;
+    if (free_blocks < 2) {
       return nullptr;
     }
+    bool small_outer = estimateNestedLoopTime(small_n, large_n, free_blocks) <=
+        estimateNestedLoopTime(large_n, small_n, free_blocks);
+    int outer_blocks = std::max(1, std::min(small_outer ? small_n : large_n, free_blocks - 1));
+    int inner_blocks = std::max(1, std::min(small_outer ? large_n : small_n, free_blocks - outer_blocks));
+    MemoryGrant grant(mManager, output_blocks + outer_blocks + inner_blocks);
 
     int output_mem_block_index = -1;
     Block* output_mem_block_ptr = nullptr;
@@ -658,17 +964,20 @@ public:
       }
     }
 
-    std::vector<int> small_mem_block_indices;
-    if(!mManager.getAllFreeBlockIndices(small_mem_block_indices)) {
-      return nullptr;
+    TableScanner outerScanner(small_outer ? small : large, mem, mManager);
+    {
+      MemoryGrant outer_grant(mManager, outer_blocks);
+      if (!outerScanner.open(outer_blocks)) {
+        return nullptr;
+      }
     }
-
-    int num_small_in_mem = small_mem_block_indices.size();
-
-    if (num_small_in_mem <= 0) {
-      return nullptr;
+    TableScanner innerScanner(small_outer ? large : small, mem, mManager);
+    {
+      MemoryGrant inner_grant(mManager, inner_blocks);
+      if (!innerScanner.open(inner_blocks, nullptr, prefetch ? &prefetcher : nullptr)) {
+        return nullptr;
+      }
     }
-    // int num_small_in_mem = 0;
 
     //create condition evaluator with postfix expression and temp relation if not null postfix
     ConditionEvaluator eval;
@@ -679,83 +988,76 @@ public:
       printFieldNames(outSchema);
     }
 
-    int small_done = 0;
-    while (small_done < small_n) {
-      int cur_small_in_mem = 0;
-      for (int k = 0; small_done < small_n && k < num_small_in_mem; ++k) {
-        small->getBlock(small_done, small_mem_block_indices[k]);
-        small_done++;
-        cur_small_in_mem++;
-      }
+    while (outerScanner.nextBatch()) {
+      innerScanner.rewind();
+      while (innerScanner.nextBatch()) {
+        for (int i = 0; i < innerScanner.getBatchSize(); i++) {
+          Block* inner_mem_block = innerScanner.getBlock(i);
 
-      for(int i = 0; i < large_n; i++) {
-        large->getBlock(i, large_mem_block_index);
-        Block* large_mem_block = mem->getBlock(large_mem_block_index);
+          for (int j = 0; j < outerScanner.getBatchSize(); ++j) {
+            Block* outer_mem_block = outerScanner.getBlock(j);
+            Block* small_mem_block = small_outer ? outer_mem_block : inner_mem_block;
+            Block* large_mem_block = small_outer ? inner_mem_block : outer_mem_block;
 
-        for (int j = 0; j < cur_small_in_mem; ++j) {
-          Block* small_mem_block = mem->getBlock(small_mem_block_indices[j]);
-
-          std::vector<Tuple> large_tuples = large_mem_block->getTuples();
-          std::vector<Tuple> small_tuples = small_mem_block->getTuples();
-
-          for(int t1 = 0; t1 < large_tuples.size(); t1++) {
-            if (large_tuples[t1].isNull()) {
-              continue;
-            }
-
-            for(int t2 = 0; t2 < small_tuples.size(); t2++) {
-              if (small_tuples[t2].isNull()) {
+            for(const Tuple& large_tuple : *large_mem_block) {
+              if (large_tuple.isNull()) {
                 continue;
               }
 
-              Tuple inTuple = inRelation->createTuple();
-              for(unordered_map<int, int>::iterator it = smallToIn.begin(); it != smallToIn.end(); ++it) {
-                int old_off = (*it).first;
-                int new_off = (*it).second;
-                FIELD_TYPE f = inSchema.getFieldType(new_off);
-                if (f == INT) {
-                  inTuple.setField(new_off, small_tuples[t2].getField(old_off).integer);
-                } else {
-                  inTuple.setField(new_off, *(small_tuples[t2].getField(old_off).str));
+              for(const Tuple& small_tuple : *small_mem_block) {
+                if (small_tuple.isNull()) {
+                  continue;
                 }
-              }
 
-              for(unordered_map<int, int>::iterator it = largeToIn.begin(); it != largeToIn.end(); ++it) {
-                int old_off = (*it).first;
-                int new_off = (*it).second;
-                FIELD_TYPE f = inSchema.getFieldType(new_off);
-                if (f == INT) {
-                  inTuple.setField(new_off, large_tuples[t1].getField(old_off).integer);
-                } else {
-                  inTuple.setField(new_off, *(large_tuples[t1].getField(old_off).str));
+                Tuple inTuple = inRelation->createTuple();
+                for(unordered_map<int, int>::iterator it = smallToIn.begin(); it != smallToIn.end(); ++it) {
+                  int old_off = (*it).first;
+                  int new_off = (*it).second;
+                  FIELD_TYPE f = inSchema.getFieldType(new_off);
+                  if (f == INT) {
+                    inTuple.setField(new_off, small_tuple.getField(old_off).integer);
+                  } else {
+                    inTuple.setField(new_off, small_tuple.getField(old_off).str);
+                  }
                 }
-              }
 
-              bool ans = true;
-              if(postFixExpr != nullptr)
-                ans = eval.evaluate(inTuple);
-
-              if (ans) {
-                Tuple outTuple = outRelation->createTuple();
-                for (auto it = inToOut.begin(); it != inToOut.end(); ++it) {
-                  int in_off = (*it).first;
-                  int out_off = (*it).second;
-                  FIELD_TYPE f = outSchema.getFieldType(out_off);
+                for(unordered_map<int, int>::iterator it = largeToIn.begin(); it != largeToIn.end(); ++it) {
+                  int old_off = (*it).first;
+                  int new_off = (*it).second;
+                  FIELD_TYPE f = inSchema.getFieldType(new_off);
                   if (f == INT) {
-                    outTuple.setField(out_off, inTuple.getField(in_off).integer);
+                    inTuple.setField(new_off, large_tuple.getField(old_off).integer);
                   } else {
-                    outTuple.setField(out_off, *(inTuple.getField(in_off).str));
+                    inTuple.setField(new_off, large_tuple.getField(old_off).str);
                   }
                 }
-                if (storeOutput) {
-                  if (!appendTupleToMemBlock(output_mem_block_ptr, outTuple)) {
-                    outRelation->setBlock(outRelation->getNumOfBlocks(), output_mem_block_index);
-                    output_mem_block_ptr->clear();
-                    appendTupleToMemBlock(output_mem_block_ptr, outTuple);
+
+                bool ans = true;
+                if(postFixExpr != nullptr)
+                  ans = eval.evaluate(inTuple);
+
+                if (ans) {
+                  Tuple outTuple = outRelation->createTuple();
+                  for (auto it = inToOut.begin(); it != inToOut.end(); ++it) {
+                    int in_off = (*it).first;
+                    int out_off = (*it).second;
+                    FIELD_TYPE f = outSchema.getFieldType(out_off);
+                    if (f == INT) {
+                      outTuple.setField(out_off, inTuple.getField(in_off).integer);
+                    } else {
+                      outTuple.setField(out_off, inTuple.getField(in_off).str);
+                    }
+                  }
+                  if (storeOutput) {
+                    if (!appendTupleToMemBlock(output_mem_block_ptr, outTuple)) {
+                      outRelation->setBlock(outRelation->getNumOfBlocks(), output_mem_block_index);
+                      output_mem_block_ptr->clear();
+                      appendTupleToMemBlock(output_mem_block_ptr, outTuple);
+                    }
+                  } else {
+                    printAndLog(outTuple);
+                    printAndLog("\n");
                   }
-                } else {
-                  printAndLog(outTuple);
-                  printAndLog("\n");
                 }
               }
             }
@@ -770,9 +1072,9 @@ public:
     }
 
     //memblocks release
-    mManager.releaseBlock(large_mem_block_index);
+    innerScanner.close();
+    outerScanner.close();
     mManager.releaseBlock(output_mem_block_index);
-    mManager.releaseNBlocks(small_mem_block_indices);
 
     if(storeOutput) {
       return outRelation;
@@ -855,10 +1157,10 @@ public:
         int curStart = whereStart;
         for (int i = whereStart; i < whereEnd; ++i) {
           if (tokens[i] == "AND") {
-            whereConditions.push_back(Parser::getPostfixNodePublic(tokens, curStart, i));
+            whereConditions.push_back(Parser::getPostfixNodePublic(arena, tokens, curStart, i));
             curStart = i + 1;
           } else if (i == whereEnd - 1) {
-            whereConditions.push_back(Parser::getPostfixNodePublic(tokens, curStart, whereEnd));
+            whereConditions.push_back(Parser::getPostfixNodePublic(arena, tokens, curStart, whereEnd));
           }
         }
       }
@@ -947,7 +1249,7 @@ public:
             for (int k = 0; k < curRoot->children.size(); ++k) {
               curWhereConditionRoot->children.push_back(curRoot->children[k]);
             }
-            curWhereConditionRoot->children.push_back(new ParseTreeNode(NODE_TYPE::POSTFIX_OPERATOR, "AND"));
+            curWhereConditionRoot->children.push_back(arena.create<ParseTreeNode>(NODE_TYPE::POSTFIX_OPERATOR, "AND"));
           }
         }
         //        ParseTreeNode::printParseTree(curWhereConditionRoot);
@@ -1021,7 +1323,14 @@ public:
         }
         curProjListMap[selectList[j]] = true;
       }
-      returnPtr = tableScanWithCondition(rel1, whereConditionRoot, emptyMemBlocks, curProjListMap, storeOutput);
+      {
+        // The output the scan keeps in memory has its duplicates removed in place, which
+        // takes one more block for the output: the scan is granted the rest, but at least
+        // a block to read and one to write, and spills its output to a relation if it
+        // does not fit
+        MemoryGrant grant(mManager, std::max(2, mManager.numFreeBlocks() - (storeOutput && hasDistinct ? 1 : 0)));
+        returnPtr = tableScanWithCondition(rel1, whereConditionRoot, emptyMemBlocks, curProjListMap, storeOutput);
+      }
       if (returnPtr != nullptr) {
         rel1 = returnPtr->getRelationName();
       }
@@ -1047,17 +1356,16 @@ public:
   }
 
   //assuming tuples have same schema
-  bool equalTuples(Tuple tuple1, Tuple tuple2) {
-    Schema s = tuple1.getSchema();
-    std::vector<std::string> column_names = s.getFieldNames();
-    for(int i = 0; i < column_names.size(); i++) {
-      enum FIELD_TYPE f = s.getFieldType(column_names[i]);
+  bool equalTuples(const Tuple& tuple1, const Tuple& tuple2) {
+    const Schema& s = tuple1.getSchema();
+    for(int i = 0; i < s.getNumOfFields(); i++) {
+      enum FIELD_TYPE f = s.getFieldType(i);
       if(f == INT) {
         if(tuple1.getField(i).integer != tuple2.getField(i).integer)
           return false;
       }
       else {
-        if(*tuple1.getField(i).str != *tuple2.getField(i).str)
+        if(tuple1.getField(i).str != tuple2.getField(i).str)
           return false;
       }
     }
@@ -1070,23 +1378,27 @@ public:
         return false;
     }
     else {
-      if(*field1.str != *field2.str)
+      if(field1.str != field2.str)
         return false;
     }
     return true;
   }
 
-  std::string convertTupleToString(Tuple tuple) {
-    Schema s = tuple.getSchema();
+  std::string convertTupleToString(const Tuple& tuple) {
+    const Schema& s = tuple.getSchema();
     std::string result = "";
-    std::vector<std::string> column_names = s.getFieldNames();
-    for(int i = 0; i < column_names.size(); i++) {
-      enum FIELD_TYPE f = s.getFieldType(column_names[i]);
+    for(int i = 0; i < s.getNumOfFields(); i++) {
+      enum FIELD_TYPE f = s.getFieldType(i);
       if(f == INT) {
-        result += std::to_string(tuple.getField(column_names[i]).integer)+"_";
+        result += std::to_string(tuple.getField(i).integer)+"_";
       }
       else {
-        result += *(tuple.getField(column_names[i]).str)+"_";
+        // the values of a dictionary-encoded relation all have codes
+        Str20 str = tuple.getField(i).str;
+        if (str.code != 0)
+          result += std::to_string(str.code)+"#";
+        else
+          result += str.toString()+"_";
       }
     }
     return result;
@@ -1094,6 +1406,7 @@ public:
 
   //main removeDuplicates function
   Relation* removeDuplicates(std::string relation_name, std::string column_name, std::vector<int>& mem_block_indices, bool print) {
+    OperatorScope scope(profiler, "duplicate removal", relation_name);
     Relation* ret_rel;
     if(print)
       printFieldNames(schema_manager.getRelation(relation_name)->getSchema());
@@ -1113,17 +1426,28 @@ public:
 
   //removeDuplicates in memory function
   Relation* removeDuplicatesMemory(std::string relation_name, std::string column_name, std::vector<int>& mem_block_indices, bool print) {
-    Relation* ret_rel;
+    OperatorScope scope(profiler, "one-pass duplicate removal", relation_name);
+    if(mem_block_indices.empty())
+      return nullptr;
     sortMemory(relation_name, column_name, mem_block_indices, false);
     int output_block_index = mManager.getFreeBlockIndex();
     if(output_block_index == -1)
       return nullptr;
+    //the output that is not printed goes to a relation, block by block
+    Relation* ret_rel = nullptr;
+    if(!print) {
+      ret_rel = createTempRelation("distinct_rel", schema_manager.getRelation(relation_name)->getSchema());
+      if(ret_rel == nullptr) {
+        mManager.releaseBlock(output_block_index);
+        return nullptr;
+      }
+    }
     std::unordered_set<std::string> seen_distinct_tuples;
     Block* output = mem->getBlock(output_block_index);
     Block* mem_block_0 = mem->getBlock(mem_block_indices[0]);
     Tuple tuple = mem_block_0->getTuple(0);
     seen_distinct_tuples.insert(convertTupleToString(tuple));
-    Schema s = tuple.getSchema();
+    enum FIELD_TYPE f_type = tuple.getSchema().getFieldType(column_name);
     union Field cur_comparing_col = tuple.getField(column_name);
 
     if(!print) {
@@ -1135,16 +1459,19 @@ public:
     }
 
     {
-      std::vector<Tuple> tuples = mem_block_0->getTuples(); 
-      for(int j = 1; j < tuples.size(); j++) {
-        Tuple tuple2 = mem_block_0->getTuple(j);
+      // tuple 0 of the first block is already in the output
+      Block::const_iterator it = mem_block_0->begin();
+      if(it != mem_block_0->end())
+        ++it;
+      for(; it != mem_block_0->end(); ++it) {
+        const Tuple& tuple2 = *it;
         bool seen = false;
         std::string converted_tuple = convertTupleToString(tuple2);
         if(seen_distinct_tuples.find(converted_tuple) != seen_distinct_tuples.end())
           seen = true;
         if(!seen) {
           tuple = tuple2;
-          if(!equalFields(s.getFieldType(column_name), cur_comparing_col, tuple.getField(column_name))) {
+          if(!equalFields(f_type, cur_comparing_col, tuple.getField(column_name))) {
             cur_comparing_col = tuple.getField(column_name);
             seen_distinct_tuples.clear();
           }
@@ -1165,16 +1492,14 @@ public:
     }
     for(int i = 1; i < mem_block_indices.size(); i++) {
       Block* mem_block = mem->getBlock(mem_block_indices[i]);
-      std::vector<Tuple> tuples = mem_block->getTuples();
-      for(int j = 0; j < tuples.size(); j++) {
-        Tuple tuple2 = mem_block->getTuple(j);
+      for(const Tuple& tuple2 : *mem_block) {
         bool seen = false;
         std::string converted_tuple = convertTupleToString(tuple2);
         if(seen_distinct_tuples.find(converted_tuple) != seen_distinct_tuples.end())
           seen = true;
         if(!seen) {
           tuple = tuple2;
-          if(!equalFields(s.getFieldType(column_name), cur_comparing_col, tuple.getField(column_name))) {
+          if(!equalFields(f_type, cur_comparing_col, tuple.getField(column_name))) {
             cur_comparing_col = tuple.getField(column_name);
             seen_distinct_tuples.clear();
           }
@@ -1193,9 +1518,10 @@ public:
         }
       }
     }
-    if(!print)
-      return ret_rel;
-    return nullptr;
+    if(!print && !output->isEmpty())
+      ret_rel->setBlock(ret_rel->getNumOfBlocks(), output_block_index);
+    mManager.releaseBlock(output_block_index);
+    return ret_rel;
   }
 
   class HeapElement {
@@ -1220,84 +1546,94 @@ public:
       if(element1->field_type == INT) {
         return element1->field.integer > element2->field.integer;
       }
-      return *element1->field.str > *element2->field.str;
+      return element1->field.str > element2->field.str;
     }
   };
 
-  Relation* removeDuplicatesRelationTwoPass(std::string relation_name, std::string column_name, bool print) {
-    Relation* orig_rel = schema_manager.getRelation(relation_name);
-    Schema schema = orig_rel->getSchema();
-    Relation* sublist_rel = schema_manager.createRelation("sublist_rel", schema);
-    Relation* final_rel = schema_manager.createRelation("final_rel", schema);
-    temp_relations.push_back("sublist_rel");
-    temp_relations.push_back("final_rel");
-    int num_free_mem_blocks = mManager.numFreeBlocks();
-    int rel_num_blocks = orig_rel->getNumOfBlocks();
-    std::vector<std::queue<int>> sublists;
-    int field_offset = schema.getFieldOffset(column_name);
-    enum FIELD_TYPE f_type = schema.getFieldType(field_offset);
-
-    std::unordered_set<std::string> seen_distinct_tuples;
-    union Field cur_comparing_col;
-
-    //create sublists and sublist_rel
-    for(int i = 0; i < rel_num_blocks; i += num_free_mem_blocks) {
-      std::queue<int> curSublist;
-      std::vector<int> i_mem_block_indices;
-      for(int j = i; j < rel_num_blocks && j < i + num_free_mem_blocks; j++) {
-        int free_block_index = mManager.getFreeBlockIndex();
-        i_mem_block_indices.push_back(free_block_index);
-        orig_rel->getBlock(j, free_block_index);
-      }
-      //sort in memory
-      sortMemory(relation_name, column_name, i_mem_block_indices, false);
-      //write it to sublist_rel
-      int index = 0;
-      for(int j = i; j < rel_num_blocks && j < i + num_free_mem_blocks; j++) {
-        sublist_rel->setBlock(j, i_mem_block_indices[index++]);
-        curSublist.push(j);
+  // With prefetching, takes a spare block per sublist and starts reading the next block
+  // of every sublist into it; takes none if the memory is short
+  void startSublistPrefetch(Relation* sublist_rel, std::vector<std::queue<int>>& sublists,
+      std::vector<int>& spare_blocks, std::vector<unsigned long>& spare_tickets) {
+    if(!prefetch || mManager.numFreeBlocks() < sublists.size())
+      return;
+    for(int i = 0; i < sublists.size(); i++) {
+      spare_blocks.push_back(mManager.getFreeBlockIndex());
+      spare_tickets.push_back(0);
+      if(!sublists[i].empty()) {
+        spare_tickets[i] = prefetcher.request(sublist_rel, sublists[i].front(), spare_blocks[i], 1);
+        sublists[i].pop();
       }
-      sublists.push_back(curSublist);
-      //release
-      mManager.releaseNBlocks(i_mem_block_indices);
     }
+  }
 
-    //clear whole memory
-    for(int i = 0; i < mem->getMemorySize(); i++)
-      mem->getBlock(i)->clear();
-
-    int output_block_index = mManager.getFreeBlockIndex();
-    Block* output = mem->getBlock(output_block_index);
+  // Reads the next block of the sublist that holds tuples once its current block is merged,
+  // and returns the memory block holding it, or -1 at the end of the sublist. With
+  // prefetching the block comes from the spare block, and the current one becomes the
+  // spare of the sublist
+  int readNextSublistBlock(Relation* sublist_rel, std::vector<std::queue<int>>& sublists, int sublist_index,
+      int block_index, std::vector<int>& spare_blocks, std::vector<unsigned long>& spare_tickets) {
+    std::queue<int>& sublist = sublists[sublist_index];
+    while(true) {
+      int next_block_index = block_index;
+      if(spare_blocks.empty()) {
+        if(sublist.empty())
+          return -1;
+        mem->getBlock(block_index)->clear();
+        sublist_rel->getBlock(sublist.front(), block_index);
+        sublist.pop();
+      } else {
+        if(spare_tickets[sublist_index] == 0)
+          return -1;
+        prefetcher.wait(spare_tickets[sublist_index]);
+        next_block_index = spare_blocks[sublist_index];
+        spare_blocks[sublist_index] = block_index;
+        spare_tickets[sublist_index] = 0;
+        mem->getBlock(block_index)->clear();
+        if(!sublist.empty()) {
+          spare_tickets[sublist_index] = prefetcher.request(sublist_rel, sublist.front(), block_index, 1);
+          sublist.pop();
+        }
+      }
+      if(mem->getBlock(next_block_index)->getNumTuples() > 0)
+        return next_block_index;
+      block_index = next_block_index;
+    }
+  }
 
+  // Merges the sorted sublists with a heap of their smallest tuples, holding a block of
+  // every sublist (and a spare block of every sublist with prefetching, if the memory
+  // holds them), and hands every tuple to 'emit' in order. Gives the blocks back at the end
+  void mergeSortedSublists(Relation* sublist_rel, std::vector<std::queue<int>>& sublists,
+      int field_offset, enum FIELD_TYPE f_type, const std::function<void(const Tuple&)>& emit) {
     //memory block index to sublist index map
     std::unordered_map<int, int> mem_to_sublist;
 
     //vector for heap
     std::vector<HeapElement*> heap;
 
-    //vector of memory blocks used for sublist's block
+    //the memory block of each sublist; with prefetching, it changes places with the spare block
     std::vector<int> mem_blocks_sublist;
 
-    //bring 1 block from each sublist in memory
+    //bring the first block of each sublist in memory
+    std::vector<int> no_spare_blocks;
+    std::vector<unsigned long> no_spare_tickets;
     for(int i = 0; i < sublists.size(); i++) {
       int free_block_index = mManager.getFreeBlockIndex();
       mem_blocks_sublist.push_back(free_block_index);
-      sublist_rel->getBlock(sublists[i].front(), free_block_index);
-      sublists[i].pop();
-      mem_to_sublist[free_block_index] = i;
+      if(readNextSublistBlock(sublist_rel, sublists, i, free_block_index, no_spare_blocks, no_spare_tickets) != -1) {
+        mem_to_sublist[free_block_index] = i;
+        Tuple tuple = mem->getBlock(free_block_index)->getTuple(0);
+        heap.push_back(arena.create<HeapElement>(tuple.getField(field_offset), f_type, free_block_index, 0));
+      }
     }
 
-    //create heap of first tuples from each block
-    for(int i = 0; i < mem_blocks_sublist.size(); i++) {
-      Block* block = mem->getBlock(mem_blocks_sublist[i]);
-      Tuple tuple = block->getTuple(0);
-      heap.push_back(new HeapElement(tuple.getField(field_offset), f_type, mem_blocks_sublist[i], 0));
-    }
+    //with prefetching, the next block of each sublist is read while the merge goes on
+    std::vector<int> spare_blocks;
+    std::vector<unsigned long> spare_tickets;
+    startSublistPrefetch(sublist_rel, sublists, spare_blocks, spare_tickets);
 
     std::make_heap(heap.begin(), heap.end(), myCompare());
 
-    cur_comparing_col = heap.front()->field;
-
     while(heap.size() > 0) {
       HeapElement* current = heap.front();
       pop_heap(heap.begin(), heap.end(), myCompare());
@@ -1306,54 +1642,200 @@ public:
       int current_block_index = current->block_index;
       int current_tuple_index = current->tuple_index;
       Block* mem_block = mem->getBlock(current_block_index);
-      Tuple tuple = mem_block->getTuple(current_tuple_index);
-
-      int seen = false;
-      std::string converted_tuple = convertTupleToString(tuple);
-      if(!seen_distinct_tuples.empty() && seen_distinct_tuples.find(converted_tuple) != seen_distinct_tuples.end())
-        seen = true;
-      if(!seen) {
-        if(!equalFields(f_type, cur_comparing_col, tuple.getField(field_offset))) {
-          cur_comparing_col = tuple.getField(field_offset);
-          seen_distinct_tuples.clear();
-        }
-        output->appendTuple(tuple);
-        seen_distinct_tuples.insert(converted_tuple);
-      }
-      //output->appendTuple(tuple);
-      if(output->isFull()) {
-        if(!print) {
-          final_rel->setBlock(final_rel->getNumOfBlocks(), output_block_index);
-        }
-        else {
-          std::vector<Tuple> output_tuples = output->getTuples();
-          for(int i = 0; i < output_tuples.size(); i++) {
-            printAndLog(output_tuples[i]);
-            printAndLog("\n");
-          }
-        }
-        output->clear();
-      }
+      emit(mem_block->getTuple(current_tuple_index));
 
       //check block done
       if(current_tuple_index == mem_block->getNumTuples() - 1) {
         //if sublist not empty
         int sublist_index = mem_to_sublist[current_block_index];
-        if(!sublists[sublist_index].empty()) {
-          mem_block->clear();
-          sublist_rel->getBlock(sublists[sublist_index].front(), current_block_index);
-          sublists[sublist_index].pop();
-          mem_block = mem->getBlock(current_block_index);
-          heap.push_back(new HeapElement(mem_block->getTuple(0).getField(field_offset), f_type, current_block_index, 0));
+        int next_block_index = readNextSublistBlock(sublist_rel, sublists, sublist_index, current_block_index,
+            spare_blocks, spare_tickets);
+        if(next_block_index != -1) {
+          mem_to_sublist[next_block_index] = sublist_index;
+          mem_blocks_sublist[sublist_index] = next_block_index;
+          mem_block = mem->getBlock(next_block_index);
+          heap.push_back(arena.create<HeapElement>(mem_block->getTuple(0).getField(field_offset), f_type, next_block_index, 0));
           push_heap(heap.begin(), heap.end(), myCompare());
         }
       } else {
         //push another tuple in heap
-        heap.push_back(new HeapElement(mem_block->getTuple(current_tuple_index + 1).getField(field_offset), f_type, current_block_index, current_tuple_index + 1));
+        heap.push_back(arena.create<HeapElement>(mem_block->getTuple(current_tuple_index + 1).getField(field_offset), f_type, current_block_index, current_tuple_index + 1));
         push_heap(heap.begin(), heap.end(), myCompare());
       }
+    }
+
+    //every sublist is read through, so no spare block is being read
+    mManager.releaseNBlocks(mem_blocks_sublist);
+    mManager.releaseNBlocks(spare_blocks);
+  }
+
+  // Past two passes, merging takes two blocks of sublists and an output block
+  bool canMergeSublists(int rel_num_blocks) {
+    int num_free_mem_blocks = mManager.numFreeBlocks();
+    if (num_free_mem_blocks == 0) {
+      return false;
+    }
+    int num_sublists = (rel_num_blocks + num_free_mem_blocks - 1) / num_free_mem_blocks;
+    return num_sublists + 1 <= num_free_mem_blocks || num_free_mem_blocks >= 3;
+  }
+
+  // The blocks of the last merge: one per sublist and an output block, and a spare block
+  // per sublist to prefetch into
+  int getMergeBlocks(int num_sublists) {
+    return num_sublists + 1 + (prefetch ? num_sublists : 0);
+  }
+
+  // Sorts the relation on the column into sublists of run_blocks blocks, each sorted in
+  // memory and written to the relation "sublist_rel"; the operator is granted run_blocks
+  // blocks for it. Returns the relation of the sublists
+  Relation* createSortedSublists(std::string relation_name, std::string column_name, int run_blocks,
+      std::vector<std::queue<int>>& sublists) {
+    Relation* orig_rel = schema_manager.getRelation(relation_name);
+    Relation* sublist_rel = createTempRelation("sublist_rel", orig_rel->getSchema());
+    if (sublist_rel == nullptr) {
+      return nullptr;
+    }
+    int rel_num_blocks = orig_rel->getNumOfBlocks();
+    MemoryGrant grant(mManager, run_blocks);
+
+    for(int i = 0; i < rel_num_blocks; i += run_blocks) {
+      std::queue<int> curSublist;
+      std::vector<int> i_mem_block_indices;
+      for(int j = i; j < rel_num_blocks && j < i + run_blocks; j++) {
+        int free_block_index = mManager.getFreeBlockIndex();
+        i_mem_block_indices.push_back(free_block_index);
+        mManager.readBlock(orig_rel, j, free_block_index);
+      }
+      //sort in memory
+      sortMemory(relation_name, column_name, i_mem_block_indices, false);
+      //write it to sublist_rel
+      int index = 0;
+      for(int j = i; j < rel_num_blocks && j < i + run_blocks; j++) {
+        sublist_rel->setBlock(j, i_mem_block_indices[index++]);
+        curSublist.push(j);
+      }
+      sublists.push_back(curSublist);
+      //release
+      mManager.releaseNBlocks(i_mem_block_indices);
+    }
+    return sublist_rel;
+  }
+
+  // While the last merge cannot hold a block of every sublist and an output block in
+  // memory_blocks blocks, merges the sublists as many at a time as they hold besides the
+  // output block, into the longer sublists of a new relation: a relation too large for two
+  // passes spills to more passes instead of failing. Returns the relation of the sublists
+  Relation* mergeSublists(Relation* sublist_rel, std::vector<std::queue<int>>& sublists,
+      int field_offset, enum FIELD_TYPE f_type, int memory_blocks) {
+    int fan_in = memory_blocks - 1;
+    MemoryGrant grant(mManager, memory_blocks);
+    for(int pass = 1; sublists.size() + 1 > memory_blocks; pass++) {
+      std::string merged_name = "merged_rel_" + std::to_string(pass);
+      Relation* merged_rel = createTempRelation(merged_name, sublist_rel->getSchema());
+      if(merged_rel == nullptr)
+        return nullptr;
+      std::vector<std::queue<int>> merged_sublists;
+
+      for(int first = 0; first < sublists.size(); first += fan_in) {
+        std::vector<std::queue<int>> group(sublists.begin() + first,
+            sublists.begin() + std::min<int>(sublists.size(), first + fan_in));
+        std::queue<int> merged;
+        int output_block_index = mManager.getFreeBlockIndex();
+        Block* output = mem->getBlock(output_block_index);
+        mergeSortedSublists(sublist_rel, group, field_offset, f_type, [&](const Tuple& tuple) {
+          output->appendTuple(tuple);
+          if(output->isFull()) {
+            merged.push(merged_rel->getNumOfBlocks());
+            merged_rel->setBlock(merged_rel->getNumOfBlocks(), output_block_index);
+            output->clear();
+          }
+        });
 
+        if(!output->isEmpty()) {
+          merged.push(merged_rel->getNumOfBlocks());
+          merged_rel->setBlock(merged_rel->getNumOfBlocks(), output_block_index);
+        }
+        mManager.releaseBlock(output_block_index);
+        if(!merged.empty())
+          merged_sublists.push_back(merged);
+      }
+
+      sublist_rel = merged_rel;
+      sublists = merged_sublists;
     }
+    return sublist_rel;
+  }
+
+  // Writes the output block to the relation, or prints it, and empties it
+  void flushOutputBlock(Relation* final_rel, int output_block_index, bool print) {
+    Block* output = mem->getBlock(output_block_index);
+    if(!print) {
+      final_rel->setBlock(final_rel->getNumOfBlocks(), output_block_index);
+    }
+    else {
+      for(const Tuple& output_tuple : *output) {
+        printAndLog(output_tuple);
+        printAndLog("\n");
+      }
+    }
+    output->clear();
+  }
+
+  // The runs of a two-pass sort or duplicate removal are as long as the free memory, so
+  // that there are as few of them as can be; the last merge is then granted a block of
+  // every run, an output block and, with prefetching, a spare block of every run
+  Relation* removeDuplicatesRelationTwoPass(std::string relation_name, std::string column_name, bool print) {
+    OperatorScope scope(profiler, "two-pass duplicate removal", relation_name);
+    Relation* orig_rel = schema_manager.getRelation(relation_name);
+    Schema schema = orig_rel->getSchema();
+    if(!canMergeSublists(orig_rel->getNumOfBlocks()))
+      return nullptr;
+    int num_free_mem_blocks = mManager.numFreeBlocks();
+    int field_offset = schema.getFieldOffset(column_name);
+    enum FIELD_TYPE f_type = schema.getFieldType(field_offset);
+
+    //create sublists and sublist_rel
+    std::vector<std::queue<int>> sublists;
+    Relation* sublist_rel = createSortedSublists(relation_name, column_name, num_free_mem_blocks, sublists);
+    Relation* final_rel = createTempRelation("final_rel", schema);
+    if(sublist_rel == nullptr || final_rel == nullptr)
+      return nullptr;
+
+    //too many sublists to hold a block of each are merged into fewer first
+    sublist_rel = mergeSublists(sublist_rel, sublists, field_offset, f_type, num_free_mem_blocks);
+    if(sublist_rel == nullptr)
+      return nullptr;
+
+    MemoryGrant grant(mManager, getMergeBlocks(sublists.size()));
+    int output_block_index = mManager.getFreeBlockIndex();
+    Block* output = mem->getBlock(output_block_index);
+
+    //the tuples come in the order of the column: the ones seen are kept while it stays the same
+    std::unordered_set<std::string> seen_distinct_tuples;
+    union Field cur_comparing_col;
+    bool first_tuple = true;
+    mergeSortedSublists(sublist_rel, sublists, field_offset, f_type, [&](const Tuple& tuple) {
+      if(first_tuple) {
+        cur_comparing_col = tuple.getField(field_offset);
+        first_tuple = false;
+      }
+      std::string converted_tuple = convertTupleToString(tuple);
+      if(seen_distinct_tuples.find(converted_tuple) == seen_distinct_tuples.end()) {
+        if(!equalFields(f_type, cur_comparing_col, tuple.getField(field_offset))) {
+          cur_comparing_col = tuple.getField(field_offset);
+          seen_distinct_tuples.clear();
+        }
+        output->appendTuple(tuple);
+        seen_distinct_tuples.insert(converted_tuple);
+      }
+      if(output->isFull())
+        flushOutputBlock(final_rel, output_block_index, print);
+    });
+
+    //last partial output block
+    if(!output->isEmpty())
+      flushOutputBlock(final_rel, output_block_index, print);
+    mManager.releaseBlock(output_block_index);
 
     return final_rel;
   }
@@ -1365,10 +1847,11 @@ public:
     union Field cur_comparing_col;
     int rel_blocks = orig_rel->getNumOfBlocks();
     //if(false) {
-    if(rel_blocks <= mManager.numFreeBlocks()) {
+    //one pass holds the relation and an output block
+    if(rel_blocks + 1 <= mManager.numFreeBlocks()) {
       for(int i = 0; i < rel_blocks; i++) {
         int free_block_index = mManager.getFreeBlockIndex();
-        orig_rel->getBlock(i, free_block_index);
+        mManager.readBlock(orig_rel, i, free_block_index);
         mem_block_indices.push_back(free_block_index);
       }
       Relation* ret_rel = removeDuplicatesMemory(relation_name, column_name, mem_block_indices, print);
@@ -1383,6 +1866,7 @@ public:
 
   //main sort function
   Relation* ourSort(std::string relation_name, std::string column_name, std::vector<int>& mem_block_indices, bool print) {
+    OperatorScope scope(profiler, "sort", relation_name);
     Relation* ret_rel;
     if(print)
       printFieldNames(schema_manager.getRelation(relation_name)->getSchema());
@@ -1401,40 +1885,42 @@ public:
 
   //sortMemory function
   void sortMemory(std::string relation_name, std::string column_name, std::vector<int>& mem_block_indices, bool print) {
-    int blocks = mem_block_indices.size();
-    int tuples_per_block = (mem->getBlock(mem_block_indices[0]))->getNumTuples(); //max tuples per block
-    int j = 0;
-    int n = (blocks - 1) * tuples_per_block;
-    n = n + (mem->getBlock(mem_block_indices[mem_block_indices.size() - 1]))->getNumTuples();
-    bool swapped = true;
+    OperatorScope scope(profiler, "one-pass sort", relation_name);
+    // Gather the tuples, sort them stably and refill the same blocks in order,
+    // so that a large memory does not make the one-pass sort quadratic
+    std::vector<Tuple> tuples;
+    for(int i = 0; i < mem_block_indices.size(); i++) {
+      for(const Tuple& tuple : *mem->getBlock(mem_block_indices[i])) {
+        if(!tuple.isNull())
+          tuples.push_back(tuple);
+      }
+    }
+    if(tuples.empty())
+      return;
 
-    while(swapped) {
-      swapped = false;
-      for(int i =  0; i < n - 1 - j; i++) {
-        int block_num_1 = i / tuples_per_block;
-        int block_num_2 = (i + 1) / tuples_per_block;
-        Block* block1 = mem->getBlock(mem_block_indices[block_num_1]);
-        Block* block2 = mem->getBlock(mem_block_indices[block_num_2]);
-        int tuple1_offset = i % tuples_per_block;
-        int tuple2_offset = (i + 1) % tuples_per_block;
-        Field field1 = (block1->getTuple(tuple1_offset)).getField(column_name);
-        Field field2 = (block2->getTuple(tuple2_offset)).getField(column_name);
-        Schema s = (block1->getTuple(tuple1_offset)).getSchema();
-        if(compareFields(s.getFieldType(column_name), field1, field2) == 1) {
-          Tuple temp = block1->getTuple(tuple1_offset);
-          block1->setTuple(tuple1_offset, block2->getTuple(tuple2_offset));
-          block2->setTuple(tuple2_offset, temp);
-          swapped = true;
-        }
+    Schema s = tuples[0].getSchema();
+    int field_offset = s.getFieldOffset(column_name);
+    enum FIELD_TYPE f_type = s.getFieldType(field_offset);
+    std::stable_sort(tuples.begin(), tuples.end(), [&](const Tuple& tuple1, const Tuple& tuple2) {
+      Field field1 = tuple1.getField(field_offset);
+      Field field2 = tuple2.getField(field_offset);
+      return compareFields(f_type, field1, field2) < 0;
+    });
+
+    int tuples_per_block = s.getTuplesPerBlock();
+    int next = 0;
+    for(int i = 0; i < mem_block_indices.size(); i++) {
+      Block* block = mem->getBlock(mem_block_indices[i]);
+      block->clear();
+      for(int j = 0; j < tuples_per_block && next < tuples.size(); j++) {
+        block->appendTuple(tuples[next++]);
       }
-      j++;
     }
     if(print) {
       for(int i = 0; i < mem_block_indices.size(); i++) {
         Block* block = mem->getBlock(mem_block_indices[i]);
-        std::vector<Tuple> tuples = block->getTuples();
-        for(int j = 0; j < tuples.size(); j++) {
-          printAndLog(tuples[j]);
+        for(const Tuple& tuple : *block) {
+          printAndLog(tuple);
           printAndLog("\n");
         }
       }
@@ -1442,118 +1928,40 @@ public:
   }
 
   Relation* sortRelationTwoPass(std::string relation_name, std::string column_name, bool print) {
+    OperatorScope scope(profiler, "two-pass sort", relation_name);
     Relation* orig_rel = schema_manager.getRelation(relation_name);
     Schema schema = orig_rel->getSchema();
-    Relation* sublist_rel = schema_manager.createRelation("sublist_rel", schema);
-    Relation* final_rel = schema_manager.createRelation("final_rel", schema);
-    temp_relations.push_back("sublist_rel");
-    temp_relations.push_back("final_rel");
+    if(!canMergeSublists(orig_rel->getNumOfBlocks()))
+      return nullptr;
     int num_free_mem_blocks = mManager.numFreeBlocks();
-    int rel_num_blocks = orig_rel->getNumOfBlocks();
-    std::vector<std::queue<int>> sublists;
     int field_offset = schema.getFieldOffset(column_name);
     enum FIELD_TYPE f_type = schema.getFieldType(field_offset);
 
     //create sublists and sublist_rel
-    for(int i = 0; i < rel_num_blocks; i += num_free_mem_blocks) {
-      std::queue<int> curSublist;
-      std::vector<int> i_mem_block_indices;
-      for(int j = i; j < rel_num_blocks && j < i + num_free_mem_blocks; j++) {
-        int free_block_index = mManager.getFreeBlockIndex();
-        i_mem_block_indices.push_back(free_block_index);
-        orig_rel->getBlock(j, free_block_index);
-      }
-      //sort in memory
-      sortMemory(relation_name, column_name, i_mem_block_indices, false);
-      //write it to sublist_rel
-      int index = 0;
-      for(int j = i; j < rel_num_blocks && j < i + num_free_mem_blocks; j++) {
-        sublist_rel->setBlock(j, i_mem_block_indices[index++]);
-        curSublist.push(j);
-      }
-      sublists.push_back(curSublist);
-      //release
-      mManager.releaseNBlocks(i_mem_block_indices);
-    }
+    std::vector<std::queue<int>> sublists;
+    Relation* sublist_rel = createSortedSublists(relation_name, column_name, num_free_mem_blocks, sublists);
+    Relation* final_rel = createTempRelation("final_rel", schema);
+    if(sublist_rel == nullptr || final_rel == nullptr)
+      return nullptr;
 
-    //clear whole memory
-    for(int i = 0; i < mem->getMemorySize(); i++)
-      mem->getBlock(i)->clear();
+    //too many sublists to hold a block of each are merged into fewer first
+    sublist_rel = mergeSublists(sublist_rel, sublists, field_offset, f_type, num_free_mem_blocks);
+    if(sublist_rel == nullptr)
+      return nullptr;
 
+    MemoryGrant grant(mManager, getMergeBlocks(sublists.size()));
     int output_block_index = mManager.getFreeBlockIndex();
     Block* output = mem->getBlock(output_block_index);
-
-    //memory block index to sublist index map
-    std::unordered_map<int, int> mem_to_sublist;
-
-    //vector for heap
-    std::vector<HeapElement*> heap;
-
-    //vector of memory blocks used for sublist's block
-    std::vector<int> mem_blocks_sublist;
-
-    //bring 1 block from each sublist in memory
-    for(int i = 0; i < sublists.size(); i++) {
-      int free_block_index = mManager.getFreeBlockIndex();
-      mem_blocks_sublist.push_back(free_block_index);
-      sublist_rel->getBlock(sublists[i].front(), free_block_index);
-      sublists[i].pop();
-      mem_to_sublist[free_block_index] = i;
-    }
-
-    //create heap of first tuples from each block
-    for(int i = 0; i < mem_blocks_sublist.size(); i++) {
-      Block* block = mem->getBlock(mem_blocks_sublist[i]);
-      Tuple tuple = block->getTuple(0);
-      heap.push_back(new HeapElement(tuple.getField(field_offset), f_type, mem_blocks_sublist[i], 0));
-    }
-
-    std::make_heap(heap.begin(), heap.end(), myCompare());
-
-    while(heap.size() > 0) {
-      HeapElement* current = heap.front();
-      pop_heap(heap.begin(), heap.end(), myCompare());
-      heap.pop_back();
-
-      int current_block_index = current->block_index;
-      int current_tuple_index = current->tuple_index;
-      Block* mem_block = mem->getBlock(current_block_index);
-      Tuple tuple = mem_block->getTuple(current_tuple_index);
-
+    mergeSortedSublists(sublist_rel, sublists, field_offset, f_type, [&](const Tuple& tuple) {
       output->appendTuple(tuple);
-      if(output->isFull()) {
-        if(!print) {
-          final_rel->setBlock(final_rel->getNumOfBlocks(), output_block_index);
-        }
-        else {
-          std::vector<Tuple> output_tuples = output->getTuples();
-          for(int i = 0; i < output_tuples.size(); i++) {
-            printAndLog(output_tuples[i]);
-            printAndLog("\n");
-          }
-        }
-        output->clear();
-      }
+      if(output->isFull())
+        flushOutputBlock(final_rel, output_block_index, print);
+    });
 
-      //check block done
-      if(current_tuple_index == mem_block->getNumTuples() - 1) {
-        //if sublist not empty
-        int sublist_index = mem_to_sublist[current_block_index];
-        if(!sublists[sublist_index].empty()) {
-          mem_block->clear();
-          sublist_rel->getBlock(sublists[sublist_index].front(), current_block_index);
-          sublists[sublist_index].pop();
-          mem_block = mem->getBlock(current_block_index);
-          heap.push_back(new HeapElement(mem_block->getTuple(0).getField(field_offset), f_type, current_block_index, 0));
-          push_heap(heap.begin(), heap.end(), myCompare());
-        }
-      } else {
-        //push another tuple in heap
-        heap.push_back(new HeapElement(mem_block->getTuple(current_tuple_index + 1).getField(field_offset), f_type, current_block_index, current_tuple_index + 1));
-        push_heap(heap.begin(), heap.end(), myCompare());
-      }
-
-    }
+    //last partial output block
+    if(!output->isEmpty())
+      flushOutputBlock(final_rel, output_block_index, print);
+    mManager.releaseBlock(output_block_index);
 
     return final_rel;
   }
@@ -1567,7 +1975,7 @@ public:
     if(rel_blocks <= mManager.numFreeBlocks()) {
       for(int i = 0; i < rel_blocks; i++) {
         int free_block_index = mManager.getFreeBlockIndex();
-        orig_rel->getBlock(i, free_block_index);
+        mManager.readBlock(orig_rel, i, free_block_index);
         mem_block_indices.push_back(free_block_index);
       }
       sortMemory(relation_name, column_name, mem_block_indices, print);
@@ -1581,13 +1989,16 @@ public:
   bool processQuery(std::string& query) {
     disk->resetDiskIOs();
     disk->resetDiskTimer();
+    mManager.resetHitsAndMisses();
+    profiler.beginQuery();
 
     bool result = false;
 
     printAndLog("********************************************\n");
     printAndLog("Q>"+query+"\n");
-    ParseTreeNode* root = Parser::parseQuery(query, tokens);
+    ParseTreeNode* root = Parser::parseQuery(arena, query, tokens);
     if (root == nullptr) {
+      arena.reset();
       return false;
     }
 
@@ -1601,13 +2012,31 @@ public:
       result = processSelectStatement(root);
     } else if (root->type == NODE_TYPE::DELETE_STATEMENT) {
       result = processDeleteStatement(root);
+    } else if (root->type == NODE_TYPE::COPY_STATEMENT) {
+      result = processCopyStatement(root);
+    } else if (root->type == NODE_TYPE::SAVE_STATEMENT) {
+      result = processSaveStatement(root);
+    } else if (root->type == NODE_TYPE::LOAD_STATEMENT) {
+      result = processLoadStatement(root);
     }
 
+    // the changes of the statement go to the log, synced unless the commit is asynchronous
+    disk->commit();
+
     printAndLog("Disk I/O: " + std::to_string(disk->getDiskIOs()) + "\n");
+    printAndLog("Buffer Pool: " + std::to_string(mManager.getHits()) + " hits, " +
+        std::to_string(mManager.getMisses()) + " misses\n");
     printAndLog("Execution Time: " + std::to_string(disk->getDiskTimer()) + " ms\n");
+    profiler.endQuery(schema_manager, temp_relations);
+    if (print_profile) {
+      std::ostringstream profile;
+      profiler.print(profile);
+      printAndLog(profile.str());
+    }
 
     mManager.releaseAllBlocks();
     removeTempRelations();
+    arena.reset();
     return result;
   }
 };
@@ -1,7 +1,11 @@
 #ifndef __MEMORY_MANAGER_INCLUDED
 #define __MEMORY_MANAGER_INCLUDED
 
+#include <algorithm>
+#include <map>
 #include <stack>
+#include <utility>
+#include <vector>
 
 #include "./StorageManager/Block.h"
 #include "./StorageManager/Config.h"
@@ -12,38 +16,149 @@
 #include "./StorageManager/Schema.h"
 #include "./StorageManager/SchemaManager.h"
 
+// Hands out the memory blocks to the operators, and keeps a page cache in the
+// blocks nobody uses: a block released with unpinBlock() keeps the relation block
+// it holds, across operators and queries, until its frame is needed again.
+// Cached pages are evicted with the CLOCK policy, and are checked against the
+// block versions of the disk, so a page written since it was cached is never used.
+// numFreeBlocks() counts the evictable pages as free.
+// An operator can be granted a budget of blocks (refer to MemoryGrant): while the grant
+// lasts, numFreeBlocks() counts no more blocks than the budget has left, and no block is
+// handed out beyond it, so that the operator leaves the blocks the plan keeps for the next
+// operators. Grants nest; a block taken counts against every grant in force.
 class MemoryManager {
 private:
+  // What a memory block holds when it caches a relation block
+  struct Frame {
+    const Relation* relation; // nullptr if the memory block caches nothing
+    int block_index;
+    unsigned long version; // of the relation block when it was read
+    bool pinned; // cached and in use by an operator: not evictable
+    bool referenced; // the second chance of the CLOCK policy
+    Frame() : relation(nullptr), block_index(-1), version(0), pinned(false), referenced(false) {}
+  };
+
   MainMemory* mem;
-  stack<int> freeBlocks;
+  stack<int> freeBlocks; // blocks that are neither in use nor caching a page
   int memory_size;
+  std::vector<Frame> frames;
+  std::map<std::pair<const Relation*, int>, int> pages; // cached relation block -> memory block
+  int num_evictable;
+  int clock_hand;
+  unsigned long hits;
+  unsigned long misses;
+  // The grants in force, innermost last: the blocks granted, and the ones taken since
+  // (negative if the operator gave back more blocks than it took)
+  std::vector<std::pair<int, int> > grants;
+
+  void countTaken(int num_blocks) {
+    for (int i = 0; i < grants.size(); ++i) {
+      grants[i].second += num_blocks;
+    }
+  }
+
+  // Forgets the page of a memory block; the caller decides where the block goes
+  void dropPage(int i) {
+    Frame& frame = frames[i];
+    pages.erase(std::make_pair(frame.relation, frame.block_index));
+    if (!frame.pinned) {
+      num_evictable--;
+    }
+    frames[i] = Frame();
+  }
+
+  // Frees the unpinned page the clock hand finds first without its second chance
+  int evictBlock() {
+    for (int step = 0; step < 2 * memory_size; ++step) {
+      int i = clock_hand;
+      clock_hand = (clock_hand + 1) % memory_size;
+      Frame& frame = frames[i];
+      if (frame.relation == nullptr || frame.pinned) {
+        continue;
+      }
+      if (frame.referenced) {
+        frame.referenced = false;
+        continue;
+      }
+      dropPage(i);
+      return i;
+    }
+    return -1;
+  }
+
+  // Returns the memory block caching an up-to-date copy of the relation block, or -1
+  int findPage(const Relation* rel, int block_index) {
+    std::map<std::pair<const Relation*, int>, int>::iterator it = pages.find(std::make_pair(rel, block_index));
+    if (it == pages.end()) {
+      return -1;
+    }
+    int i = it->second;
+    if (block_index >= rel->getNumOfBlocks() || frames[i].version != rel->getBlockVersion(block_index)) {
+      // written since it was cached
+      bool pinned = frames[i].pinned;
+      dropPage(i);
+      if (!pinned) {
+        freeBlocks.push(i);
+      }
+      return -1;
+    }
+    return i;
+  }
 
 public:
   MemoryManager(MainMemory* m) {
     this->mem = m;
     memory_size = mem->getMemorySize();
+    frames.resize(memory_size);
+    num_evictable = 0;
+    clock_hand = 0;
+    hits = 0;
+    misses = 0;
     for (int i = memory_size - 1; i >= 0; --i) {
       freeBlocks.push(i);
     }
   }
 
   int numFreeBlocks() {
-    return freeBlocks.size();
+    int num_free = freeBlocks.size() + num_evictable;
+    for (int i = 0; i < grants.size(); ++i) {
+      num_free = std::min(num_free, grants[i].first - grants[i].second);
+    }
+    return std::max(num_free, 0);
+  }
+
+  // Grants the operator about to run at most num_blocks of the free blocks, until
+  // endGrant(); prefer a MemoryGrant
+  void beginGrant(int num_blocks) {
+    grants.push_back(std::make_pair(std::max(0, std::min(num_blocks, numFreeBlocks())), 0));
+  }
+
+  // The blocks the operator still holds count against the enclosing grants
+  void endGrant() {
+    grants.pop_back();
   }
 
   int getFreeBlockIndex() {
+    int top = -1;
+    if (numFreeBlocks() == 0) {
+      return -1;
+    }
     if (!freeBlocks.empty()) {
-      int top = freeBlocks.top();
+      top = freeBlocks.top();
       freeBlocks.pop();
+    } else {
+      top = evictBlock();
+    }
+    if (top != -1) {
       Block* top_block = mem->getBlock(top);
       top_block->clear();
-      return top;
+      countTaken(1);
     }
-    return -1;
+    return top;
   }
 
   bool getNFreeBlockIndices(vector<int>& ans, int n) {
-    if (freeBlocks.size() < n) {
+    if (numFreeBlocks() < n) {
       return false;
     }
 
@@ -62,11 +177,37 @@ public:
     return getNFreeBlockIndices(ans, numFreeBlocks());
   }
 
+  // Like getNFreeBlockIndices, but takes first the blocks caching pages of the relation,
+  // which stay cached: a scan of the relation then finds its pages in its own buffer
+  bool getNBlockIndicesFor(const Relation* rel, vector<int>& ans, int n) {
+    if (numFreeBlocks() < n) {
+      return false;
+    }
+    ans.clear();
+    for (int i = 0; i < memory_size && ans.size() < n; ++i) {
+      if (frames[i].relation == rel && !frames[i].pinned) {
+        frames[i].pinned = true;
+        num_evictable--;
+        countTaken(1);
+        ans.push_back(i);
+      }
+    }
+    while (ans.size() < n) {
+      ans.push_back(getFreeBlockIndex());
+    }
+    return true;
+  }
+
+  // Gives back a block the operator may have modified: whatever it caches is dropped
   void releaseBlock(int i) {
     if (i == -1) {
       return;
     }
+    if (frames[i].relation != nullptr) {
+      dropPage(i);
+    }
     freeBlocks.push(i);
+    countTaken(-1);
   }
 
   void releaseNBlocks(vector<int>& blocks) {
@@ -75,13 +216,148 @@ public:
     }
   }
 
+  // Gives back a block the operator has only read: the page it caches stays cached
+  void unpinBlock(int i) {
+    if (i == -1) {
+      return;
+    }
+    if (frames[i].relation == nullptr) {
+      releaseBlock(i);
+      return;
+    }
+    if (frames[i].pinned) {
+      frames[i].pinned = false;
+      num_evictable++;
+      countTaken(-1);
+    }
+  }
+
+  void unpinNBlocks(vector<int>& blocks) {
+    for (int i = 0; i < blocks.size(); ++i) {
+      unpinBlock(blocks[i]);
+    }
+  }
+
+  // At the end of a query every block is given back; the cached pages stay cached
   void releaseAllBlocks() {
+    grants.clear();
     while (!freeBlocks.empty()) {
       freeBlocks.pop();
     }
     for (int i = memory_size - 1; i >= 0; --i) {
-      freeBlocks.push(i);
+      if (frames[i].relation == nullptr) {
+        freeBlocks.push(i);
+      } else if (frames[i].pinned) {
+        frames[i].pinned = false;
+        num_evictable++;
+      }
+    }
+  }
+
+  // Copies the cached page of a relation block into a block of the operator.
+  // Returns false, and counts nothing, if the page is not cached
+  bool copyCachedBlock(const Relation* rel, int block_index, int memory_block_index) {
+    if (isCached(rel, block_index, memory_block_index)) {
+      hits++;
+      frames[memory_block_index].referenced = true;
+      return true;
     }
+    uncacheBlock(memory_block_index);
+    int i = findPage(rel, block_index);
+    if (i == -1) {
+      return false;
+    }
+    hits++;
+    frames[i].referenced = true;
+    return mem->setBlock(memory_block_index, *mem->getBlock(i));
+  }
+
+  // Reads a relation block into a block of the operator, copying the cached page
+  // instead of reading the disk when there is one
+  bool readBlock(const Relation* rel, int block_index, int memory_block_index) {
+    if (copyCachedBlock(rel, block_index, memory_block_index)) {
+      return true;
+    }
+    misses++;
+    return rel->getBlock(block_index, memory_block_index);
+  }
+
+  // Counts the relation blocks read from the disk into the memory block by the caller
+  void countMisses(int num_blocks) {
+    misses += num_blocks;
+  }
+
+  // Returns true if the memory block already caches the relation block, up to date
+  bool isCached(const Relation* rel, int block_index, int memory_block_index) {
+    const Frame& frame = frames[memory_block_index];
+    return frame.relation == rel && frame.block_index == block_index && findPage(rel, block_index) == memory_block_index;
+  }
+
+  // Records that the memory block, in use by the caller, holds the whole relation block
+  // as it is on the disk; ignored if another memory block caches it already
+  void cacheBlock(const Relation* rel, int block_index, int memory_block_index) {
+    if (frames[memory_block_index].relation != nullptr || findPage(rel, block_index) != -1) {
+      return;
+    }
+    Frame& frame = frames[memory_block_index];
+    frame.relation = rel;
+    frame.block_index = block_index;
+    frame.version = rel->getBlockVersion(block_index);
+    frame.pinned = true;
+    frame.referenced = true;
+    pages[std::make_pair(rel, block_index)] = memory_block_index;
+  }
+
+  // Forgets the page a memory block in use caches, before the caller overwrites it
+  void uncacheBlock(int memory_block_index) {
+    if (frames[memory_block_index].relation != nullptr) {
+      dropPage(memory_block_index);
+    }
+  }
+
+  // Drops the cached pages of a relation before it is deleted
+  void forgetRelation(const Relation* rel) {
+    for (int i = 0; i < memory_size; ++i) {
+      if (frames[i].relation == rel) {
+        bool pinned = frames[i].pinned;
+        dropPage(i);
+        if (!pinned) {
+          freeBlocks.push(i);
+        }
+      }
+    }
+  }
+
+  unsigned long getHits() const {
+    return hits;
+  }
+
+  unsigned long getMisses() const {
+    return misses;
+  }
+
+  void resetHitsAndMisses() {
+    hits = 0;
+    misses = 0;
+  }
+};
+
+// Grants an operator a budget of memory blocks for as long as it is in scope
+// (refer to MemoryManager::beginGrant)
+class MemoryGrant {
+private:
+  MemoryManager& mManager;
+
+  MemoryGrant(const MemoryGrant&);
+  MemoryGrant& operator=(const MemoryGrant&);
+
+public:
+  MemoryGrant(MemoryManager& m, int num_blocks) : mManager(m) {
+    mManager.beginGrant(num_blocks);
+  }
+
+  ~MemoryGrant() {
+    mManager.endGrant();
   }
 };
 
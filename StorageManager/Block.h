@@ -9,12 +9,12 @@ class Tuple;
 
 /* A disk or memory block contains a number of records/tuples that belong to the same relation. 
  * A tuple CANNOT be splitted and stored in more than one blocks. 
- * Each block is defined to hold as most FIELDS_PER_BLOCK fields. 
+ * Each block is defined to hold as most Config::getFieldsPerBlock() fields (FIELDS_PER_BLOCK by default). 
  * Therefore, the max number of tuples held in a block can be calculated from the size of a tuple, 
  *   which is the number of fields in a tuple.
  * You can get the number by calling Schema::getTuplesPerBlock().
  *
- * The max number of tuples held in a block = FIELDS_PER_BLOCK / num_of_fields_in_tuple
+ * The max number of tuples held in a block = Config::getFieldsPerBlock() / num_of_fields_in_tuple
  *
  * Usage: Blocks already reside in the memory and disk. You don't need to create blocks manually.
  *        Most time when you need to use the Block class is to access a block of the main memory
@@ -29,7 +29,7 @@ class Block {
 
   public:
     friend class MainMemory;  // allocates blocks
-    //friend class Relation; // allocates blocks
+    friend class Relation; // checks the tuples before writing them to the disk
     friend class Disk;
 
     bool isFull() const;
@@ -38,7 +38,13 @@ class Block {
     int getNumTuples() const; // returns current number of tuples inside this block
     Tuple getTuple(int tuple_offset) const; // gets the tuple value at tuple_index;
                                             //returns empty Tuple if tuple_index out of bound
-    vector<Tuple> getTuples() const; // returns all the tuples inside this block
+    vector<Tuple> getTuples() const; // returns a copy of all the tuples inside this block
+    // Iterate the tuples in place without copying them, invalid tuples included:
+    //   for (const Tuple& tuple : *block) ...
+    // The iterators are invalidated when the block is modified
+    typedef vector<Tuple>::const_iterator const_iterator;
+    const_iterator begin() const;
+    const_iterator end() const;
     bool setTuple(int tuple_offset, const Tuple& tuple); // sets new tuple value at tuple_offset;
                                                          //returns false if tuple_offset out of bound
     // remove all the tuples; sets new tuples for the block;
@@ -5,7 +5,26 @@
 #define MAX_NUM_OF_FIELDS_IN_RELATION 8
 #define NUM_OF_BLOCKS_IN_MEMORY 10 // Starts with small memory to test one-pass and two-pass algorithms
 //#define NUM_OF_BLOCKS_IN_MEMORY 300 // To measure algorithm performance on 1000 tuples, use this value
-#define SIMULATED_DISK_LATENCY_ON 1 // Setting to 1 turns on the simulated disk latency
+#define SIMULATED_DISK_LATENCY_ON 1 // Setting to 1 turns on the simulated disk latency by default (see Disk::setLatencyMode)
 #define DISK_I_O_DEBUG 0 // Setting to 1 turns on the debug message of disk I/O incrementation
 
+/* FIELDS_PER_BLOCK and NUM_OF_BLOCKS_IN_MEMORY above are only the defaults of the
+ * storage geometry. The geometry in effect is read from here at runtime, so it can be
+ * changed without recompiling. Set it before creating the MainMemory and the Disk:
+ *   Config::setFieldsPerBlock(16);
+ *   Config::setNumOfBlocksInMemory(300);
+ */
+class Config {
+  private:
+    static int fields_per_block;
+    static int num_of_blocks_in_memory;
+
+  public:
+    static int getFieldsPerBlock();
+    // returns false if a block could not hold a tuple of MAX_NUM_OF_FIELDS_IN_RELATION fields
+    static bool setFieldsPerBlock(int fields_per_block);
+    static int getNumOfBlocksInMemory();
+    static bool setNumOfBlocksInMemory(int num_of_blocks); // returns false if not positive
+};
+
 #endif
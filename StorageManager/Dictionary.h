@@ -0,0 +1,42 @@
+#ifndef _DICTIONARY_H
+#define _DICTIONARY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Field.h"
+
+using namespace std;
+
+/* A dictionary maps every distinct STR20 value to a small integer code, starting from 1.
+ * Codes are never reassigned, so two values encoded by the same dictionary are equal
+ * if and only if their codes are equal.
+ * Usage: The schema manager keeps one dictionary shared by all the relations created
+ *          with dictionary encoding; you don't need to access it directly.
+ *        A STR20 field of such a relation carries its code in Str20::code,
+ *          and is stored on the disk as the code only.
+ */
+class Dictionary {
+  private:
+    // Hashes and compares the characters of a value, whatever its code
+    struct Str20Hash {
+      size_t operator()(const Str20& s) const;
+    };
+    struct Str20Equal {
+      bool operator()(const Str20& s1, const Str20& s2) const;
+    };
+
+    vector<Str20> values; // values[code-1] is the value of the code
+    unordered_map<Str20,int,Str20Hash,Str20Equal> codes;
+
+  public:
+    // returns the code of s, adding s if it is new; returns 0 if the dictionary already
+    // holds MAX_DICTIONARY_CODE values
+    int encode(const Str20& s);
+    int getCode(const Str20& s) const; // returns 0 if s is not in the dictionary
+    Str20 decode(int code) const; // returns an empty value if the code is unknown
+    int size() const; // returns the number of values, which is also the highest code
+};
+
+#endif
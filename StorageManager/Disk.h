@@ -1,18 +1,126 @@
 #ifndef _DISK_H
 #define _DISK_H
 
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
 #include <vector>
+#include <sys/types.h>
+
+#include "WriteAheadLog.h"
+
 using namespace std;
 
-#define NUM_TRACKS 100
+class Block;
+class Dictionary;
+class Schema;
+class Tuple;
+
+/* How the simulated disk latency is spent on every disk access:
+ *   SPIN_LATENCY:    busy-waits until the simulated time has elapsed
+ *   VIRTUAL_LATENCY: only advances the disk timer and returns immediately
+ *   SLEEP_LATENCY:   sleeps for the simulated time multiplied by the latency scale,
+ *                    yielding the CPU to other threads in the meantime
+ * In every mode the disk timer advances by the same simulated time.
+ */
+enum DISK_LATENCY_MODE { SPIN_LATENCY, VIRTUAL_LATENCY, SLEEP_LATENCY };
+
+/* How the time to position the head is charged on every disk access:
+ *   FIXED_SEEK:         every access pays avg_seek_time + avg_rotation_latency, wherever
+ *                       the head is (the textbook model, and the default)
+ *   HEAD_POSITION_SEEK: the disk keeps the position of the head. An access starting at the
+ *                       block that follows the last one transferred pays no positioning time,
+ *                       another block of the same track pays avg_rotation_latency only, and a
+ *                       block of another track pays avg_seek_time + avg_rotation_latency.
+ *                       The order of the accesses then matters (refer to "prefetcher.cc")
+ */
+enum DISK_SEEK_MODEL { FIXED_SEEK, HEAD_POSITION_SEEK };
+
+/* How the fields of the tuples are laid out in a disk block of a relation:
+ *   ROW_LAYOUT: the fields of a tuple are stored together, tuple after tuple
+ *   PAX_LAYOUT: the values of a field are stored together, field after field,
+ *               so that reading a few fields of every tuple touches only their cells
+ *   COMPRESSED_LAYOUT: field after field like PAX_LAYOUT, with the INT fields stored as
+ *               offsets from the smallest value of the block and the STR20 fields
+ *               run-length encoded
+ * A compressed block holds no more tuples than in the other layouts, but the track stores
+ * only its compressed bytes, the blocks back to back (refer to Disk). The disk charges
+ * the compressed bytes transferred: a multi-block read or write costs the disk I/Os of the
+ * pages their compressed bytes fill, not one per block. A single-block access always costs
+ * one disk I/O.
+ */
+enum BLOCK_LAYOUT { ROW_LAYOUT, PAX_LAYOUT, COMPRESSED_LAYOUT };
+
+/* The timing of the device that a disk simulates. An access of n consecutive blocks takes
+ *   seek_time + rotation_latency + transfer_time_per_block * ceil(n / queue_depth)
+ * milliseconds: a device with a queue depth above 1 transfers that many blocks of an access
+ * in parallel. With HEAD_POSITION_SEEK, the seek and the rotation depend on the head.
+ * The profiles of Disk:
+ *   getHDDProfile():     the Megatron 747 (the default), whose transfer time only is
+ *                        scaled by 320 (refer to Disk)
+ *   getSataSSDProfile(): 0.1 ms to reach a block, 500 MB/s, 4 blocks in parallel
+ *   getNVMeProfile():    0.02 ms to reach a block, 3 GB/s, 16 blocks in parallel
+ *   The seek, rotation and transfer times of the solid-state drives are all scaled by 320.
+ * Any other timing can be set as well.
+ */
+struct DiskProfile {
+  string name;
+  double seek_time;
+  double rotation_latency;
+  double transfer_time_per_block;
+  int queue_depth;
+};
 
-/* Simplified assumptions are made for disks. A disk contains many tracks. 
- * We assume each relation reside on a single track of blocks on disk. 
+/* Simplified assumptions are made for disks. A disk contains many tracks.
+ * We assume each relation reside on a single track of blocks on disk.
+ * The number of tracks is not limited: the track of a relation is indexed by its schema index.
  * Everytime to read or write blocks of a relation takes time:
  *
  * (AVG_SEEK_TIME + AVG_ROTATION_LATENCY + AVG_TRANSFER_TIME_PER_BLOCK * num_of_consecutive_blocks)
  *
+ * With HEAD_POSITION_SEEK, the seek and the rotation depend on where the head is instead.
+ * These are the times of the Megatron 747; another DiskProfile, such as a solid-state
+ * drive, can be set instead.
+ * The disk can also stripe the blocks of every track round-robin over several devices of the
+ * profile, block i on device i % getNumOfDevices(). The devices serve their blocks of an
+ * access in parallel, each paying its own positioning time, so that the access takes the
+ * time of the busiest device; every device counts its disk I/Os and busy time.
+ * The pages of a track are still stored together: only the timing is striped.
  * The number of disk I/O is calculated by the number of blocks read or written.
+ *
+ * The disk keeps the number of tuple slots and valid tuples of every block up to date
+ * on every write, so that a relation is counted without reading its blocks, and keeps
+ * a free-space map of the blocks with holes (invalid tuples) that new tuples can reuse.
+ * Every block also has a version that changes whenever the block is written, so that
+ * a copy of the block kept in memory can be checked for staleness without any disk I/O.
+ * The disk serves one access at a time: the reads and writes of the relations may be
+ * issued from several threads, for instance to read blocks ahead on an I/O thread.
+ *
+ * Every block is read and written as a page of getPageSize() bytes, laid out for the
+ * Config::getFieldsPerBlock() in effect when the disk is created. A track of the in-memory
+ * disk stores the pages one after the other, except for a compressed relation: its track
+ * packs the blocks back to back, each as the bytes of its page up to the last non-zero one,
+ * so that a block takes the bytes of its compressed fields only.
+ * A disk is either simulated in memory (the default), or backed by a directory:
+ *   track i is then stored in the file "<directory>/track_<i>", which packs the blocks
+ *   of every layout back to back and is memory-mapped the first time the track is
+ *   accessed. The data survive the process, and the
+ *   SchemaManager keeps the relation catalog in "<directory>/catalog", and the dictionary
+ *   of the dictionary-encoded relations in "<directory>/dictionary".
+ *   The block geometry of the directory is kept in "<directory>/geometry"; an existing
+ *   directory sets Config::setFieldsPerBlock() to the geometry it was written with.
+ *   The changes to the blocks are logged in "<directory>/wal" (refer to "WriteAheadLog.h"):
+ *   call commit() at the end of every statement, and the statements committed before a
+ *   crash are recovered when the directory is opened again. The track files themselves
+ *   only change at a checkpoint: until then the pages written are kept in memory, so that
+ *   a statement cut short by a crash leaves nothing behind. checkpoint() syncs the log,
+ *   writes the pages to the track files, syncs them and empties the log; it runs when
+ *   the log grows past WAL_CHECKPOINT_BYTES and when the disk is destroyed.
+ * Either disk can be saved to and restored from a single image file (refer to
+ *   SchemaManager::saveImage()). The in-memory disk maps the pages of a restored image
+ *   copy-on-write, so that they are only read from the file when they are first accessed.
  * Usage: At the beginning of your program, you need to initialize a disk.
  *       You don't need to access Disk directly except for getting disk I/O counts
  *       When you need to access a relation, use the Relation class
@@ -20,7 +128,7 @@ using namespace std;
 class Disk {
   private:
     //Properties are defined based on the Megatron 747 disk sold in 2001.
-    
+
     //One block holds 16384 bytes (although a block only holds 8 fields in here)
     //Thus, a relation of 60 tuples/blocks occupies as much as 960K
     //If memory has 1/6 of the relation size, then the memory has only 160K space
@@ -30,31 +138,238 @@ class Disk {
     static constexpr double avg_rotation_latency=4.17;
     static constexpr double avg_transfer_time_per_block=0.20 * 320;
 
-    vector<Block> tracks[NUM_TRACKS];
+    // The pages of one track: in a vector for the in-memory disk,
+    // or in a mapping of the track file for the file-backed disk.
+    // A track of the in-memory disk restored from an image maps the pages of the image
+    // copy-on-write instead, until it grows past them.
+    // The track file, and the vector of a compressed track, hold packed blocks: each is
+    // [int length][the first 'length' bytes of the page], starting at its block offset.
+    // A packed block is read and written through the unpacked page of the track
+    struct Track {
+      vector<char> buffer;
+      int fd; // -1 until the track file is opened
+      char* mapping;
+      size_t mapped_bytes; // capacity of the mapping
+      int num_blocks;
+      // The file-backed disk reads the first clean_blocks blocks from the mapping of the
+      // track file, which holds file_blocks blocks in file_bytes bytes, unless they are in
+      // dirty_pages: the pages written since the last checkpoint. The other blocks are empty
+      int file_blocks;
+      size_t file_bytes;
+      int clean_blocks;
+      map<int,string> dirty_pages;
+      vector<size_t> block_offsets; // of the packed blocks
+      vector<char> page; // the unpacked page of block open_block, or -1
+      int open_block;
+      bool page_dirty; // the page was written, but not packed into the vector yet
+      vector<int> block_slots; // tuple slots of each block, valid or not
+      vector<int> block_tuples; // valid tuples of each block
+      vector<int> block_bytes; // bytes of each block that are transferred
+      set<int> blocks_with_holes; // the free-space map
+      vector<unsigned long> block_versions; // changed whenever the block is written
+      int num_slots; // totals of the track
+      int num_tuples;
+      enum BLOCK_LAYOUT layout;
+      unsigned long int reads; // disk I/Os on the track since the counters were reset
+      unsigned long int writes;
+      double timer;
+      Track() : fd(-1), mapping(NULL), mapped_bytes(0), num_blocks(0), file_blocks(0), file_bytes(0),
+                clean_blocks(0), open_block(-1), page_dirty(false), num_slots(0), num_tuples(0),
+                layout(ROW_LAYOUT), reads(0), writes(0), timer(0) {}
+    };
+
+    // indexed by the schema index; grows when a new index is used.
+    // A deque keeps the tracks in place as it grows, while another thread reads one
+    deque<Track> tracks;
+    mutable recursive_mutex access_mutex; // held by each access, its latency included
+    WriteAheadLog wal; // open only for a disk backed by a directory
+    string directory; // empty for the in-memory disk
+    set<int> removed_tracks; // the track files to remove at the next checkpoint
+    vector<char> empty_page; // the file-backed disk reads the new blocks from here
+    int fields_per_block; // the block geometry the pages are laid out for
+    unsigned long int last_version; // the last block version given out
     unsigned long int diskIOs;
+    unsigned long int diskReads; // the disk I/Os split by direction
+    unsigned long int diskWrites;
     double timer;
-    
-    // for internal use: extend the track to 'block_index'-1; no disk latency
+    enum DISK_LATENCY_MODE latency_mode;
+    double latency_scale;
+    DiskProfile profile;
+    enum DISK_SEEK_MODEL seek_model;
+    int head_track; // the last access stopped before this block of this track; -1 before any access
+    int head_block;
+
+    // One of the devices the blocks are striped over
+    struct Device {
+      int head_track; // the head stopped before this block of the device on this track
+      int head_block;
+      unsigned long int ios; // since the counters were reset
+      double timer; // busy time since the timer was reset
+      Device() : head_track(-1), head_block(0), ios(0), timer(0) {}
+    };
+    vector<Device> devices;
+
+    Disk(const Disk&); // a disk owns its track files: not copyable
+    Disk& operator=(const Disk&);
+
+    // for internal use: the track of the relation, adding empty tracks up to it if needed
+    Track& getTrack(int schema_index);
+    // for internal use: open and map the track file on first access
+    bool openTrack(int schema_index);
+    // for internal use: map the file_bytes bytes of the track file
+    bool mapTrackFile(int schema_index);
+    // for internal use: write the blocks of the track to a new track file, sync it and
+    // rename it over the old one, so that a crash leaves one of them whole
+    bool writeTrackFile(int schema_index);
+    // for internal use: set the number of blocks on the track; new pages are left empty
+    bool resizeTrack(int schema_index, int num_blocks);
+    // for internal use: the page of a block, valid until another block of the track is accessed
+    const char* getPage(int schema_index, int block_index);
+    // for internal use: the page to write; on the file-backed disk, a copy of it that
+    // the next checkpoint writes to the track file
+    char* getDirtyPage(int schema_index, int block_index);
+    // for internal use: unpack a packed block into the page of the track, packing the page
+    // open before back first
+    const char* unpackPage(int schema_index, int block_index);
+    // for internal use: pack the page written on a compressed track of the in-memory disk
+    // into its vector
+    void packPage(int schema_index);
+    // for internal use: the layout of the pages of a track, set by the schema manager
+    // before the track holds any block
+    void setTrackLayout(int schema_index, enum BLOCK_LAYOUT layout);
+    enum BLOCK_LAYOUT getTrackLayout(int schema_index);
+    // for internal use: the cell of field j of slot i is at i*slot_stride+j*field_stride
+    void getCellStrides(int schema_index, int num_fields, int& slot_stride, int& field_stride);
+    // for internal use: decode/encode the fields of the valid tuples of a compressed page
+    void readCompressedFields(const char* cells, const Schema& schema, const Dictionary* dictionary,
+                              const vector<bool>* fields, Block& b);
+    void writeCompressedFields(char* cells, const Schema& schema, Dictionary* dictionary, const Block& b);
+    // for internal use: the disk I/Os of transferring the blocks; no disk latency
+    int getNumOfTransferredPages(int schema_index, int block_index, int num_blocks);
+    // for internal use: recount the slots and tuples of a page after it is written
+    void updateBlockStats(int schema_index, int block_index);
+    // for internal use: decode/encode a page without disk latency;
+    // 't' is an empty tuple of the relation used to rebuild the tuples;
+    // the STR20 fields are stored as codes of 'dictionary' unless it is NULL
+    // the tuples are decoded into 'b', reusing its storage;
+    // only the fields flagged in 'fields' are decoded unless it is NULL
+    void readBlock(int schema_index, int block_index, const Tuple& t, const Dictionary* dictionary,
+                   const vector<bool>* fields, Block& b);
+    void writeBlock(int schema_index, int block_index, const Block& b, Dictionary* dictionary);
+
+    // for internal use: extend the track to 'block_index'-1 with invalid tuples of the
+    // relation of the empty tuple 't'; no disk latency
     bool extendTrack(int schema_index, int block_index, const Tuple& t);
     // for internal use: shrink the track to 'block_index'-1; no disk latency
     bool shrinkTrack(int schema_index, int block_index);
+    // for internal use: remove all blocks of a deleted relation; no disk latency
+    void clearTrack(int schema_index);
+    // for internal use: write the block counts of the track at 'counts_offset' of the image
+    // file, and its pages at 'pages_offset'; no disk latency
+    bool saveTrackImage(int schema_index, int fd, off_t counts_offset, off_t pages_offset);
+    // for internal use: restore an empty track from the image file. The in-memory disk maps
+    // the pages if 'pages_offset' is aligned to the system page size, the others copy them;
+    // the pages are not logged, so checkpoint() afterwards; no disk latency
+    bool loadTrackImage(int schema_index, int fd, off_t counts_offset, off_t pages_offset,
+                        int num_blocks);
+    int getTrackSize(int schema_index);
+    bool isPageEmpty(int schema_index, int block_index); // returns true if the page has no tuple slots
+    // for internal use: the counts of the track, or of one block of it; no disk latency
+    int getNumOfSlots(int schema_index);
+    int getNumOfTuples(int schema_index);
+    int getNumOfSlots(int schema_index, int block_index);
+    int getNumOfTuples(int schema_index, int block_index);
+    int getFirstBlockWithHoles(int schema_index); // returns -1 if no block has holes
+    unsigned long getBlockVersion(int schema_index, int block_index);
     // for internal use: increment Disk I/O count
     void incrementDiskIOs(int count);
-    void incrementDiskTimer(int num_blocks);
-    
-    Block getBlock(int schema_index, int block_index);
-    vector<Block> getBlocks(int schema_index, int block_index, int num_blocks);
-    bool setBlock(int schema_index, int block_index, const Block& b);
-    bool setBlocks(int schema_index, int block_index, const vector<Block>& vb);
-    
+    void incrementDiskTimer(double elapse);
+    // for internal use: the time of an access to the blocks, transferring num_pages pages,
+    // on the devices that hold them in parallel; the heads stop after the blocks
+    double accessDevices(int schema_index, int block_index, int num_blocks, int num_pages);
+    // for internal use: charge the disk I/Os and the time of reading or writing num_blocks
+    // blocks of a track, which transfer num_pages pages
+    void chargeTrack(int schema_index, int block_index, int num_blocks, int num_pages, bool write);
+    // for internal use: the counters of a track since they were last reset
+    unsigned long int getTrackReads(int schema_index);
+    unsigned long int getTrackWrites(int schema_index);
+    double getTrackTimer(int schema_index);
+
+    // The blocks are read into and written from the given blocks (of the memory) in place.
+    // getBlock returns false and leaves 'b' unchanged if the disk block holds no tuple slots
+    bool getBlock(int schema_index, int block_index, const Tuple& t, const Dictionary* dictionary,
+                  const vector<bool>* fields, Block& b);
+    bool getBlocks(int schema_index, int block_index, int num_blocks, const Tuple& t,
+                   const Dictionary* dictionary, const vector<bool>* fields, Block* blocks);
+    bool setBlock(int schema_index, int block_index, const Block& b, Dictionary* dictionary);
+    bool setBlocks(int schema_index, int block_index, const Block* blocks, int num_blocks,
+                   Dictionary* dictionary);
+
   public:
     friend class Relation;
-    Disk();
+    friend class SchemaManager; // clears the tracks of deleted relations
+    Disk(); // creates an in-memory disk
+    // Creates a disk backed by the files in 'directory', creating the directory if needed.
+    // An empty directory name creates an in-memory disk.
+    Disk(string directory);
+    ~Disk();
+    bool isPersistent() const; // returns true if the disk is backed by files
+    string getDirectory() const; // returns empty string for the in-memory disk
+    int getPageSize() const; // returns the number of bytes a block occupies on the disk
+    // Ends the changes of a statement: they are durable once the log is synced, before
+    // commit() returns, or at most getAsyncCommitDelay() milliseconds later with
+    // asynchronous commit. No effect on the in-memory disk
+    void commit();
+    void checkpoint(); // syncs the track files and empties the log
+    // Sets how long after an asynchronous commit the log is synced, with the commits made
+    // meanwhile; 0 syncs the log on every commit. Defaults to DEFAULT_ASYNC_COMMIT_DELAY
+    void setAsyncCommitDelay(double milliseconds);
+    double getAsyncCommitDelay() const;
+    unsigned long int getNumOfLogSyncs() const; // returns the number of times the log was synced
+    // The latency mode defaults to SPIN_LATENCY if SIMULATED_DISK_LATENCY_ON is 1,
+    // and to VIRTUAL_LATENCY otherwise
+    void setLatencyMode(enum DISK_LATENCY_MODE mode);
+    enum DISK_LATENCY_MODE getLatencyMode() const;
+    // Sets the factor applied to the simulated time in SLEEP_LATENCY mode; defaults to 1
+    void setLatencyScale(double scale);
+    double getLatencyScale() const;
+    // The timing of the simulated device; defaults to getHDDProfile().
+    // Returns false, leaving the profile unchanged, if a time is negative or the queue depth is below 1
+    bool setProfile(const DiskProfile& profile);
+    const DiskProfile& getProfile() const;
+    static DiskProfile getHDDProfile();
+    static DiskProfile getSataSSDProfile();
+    static DiskProfile getNVMeProfile();
+    // Returns the simulated time of an access of num_blocks consecutive blocks under the
+    // profile, striped over the devices, with a full seek and rotation; no disk latency.
+    // Operators compare the costs of their alternatives with it
+    double estimateAccessTime(int num_blocks) const;
+    // Stripes the blocks of every track over num_devices devices of the profile, and resets
+    // their counters; defaults to 1. Returns false if num_devices is below 1
+    bool setNumOfDevices(int num_devices);
+    int getNumOfDevices() const;
+    // The disk I/Os of a device, and the time it was busy, since resetDiskIOs() and
+    // resetDiskTimer(); getDiskTimer() is at most the sum of the busy times.
+    // Returns 0 if the device does not exist
+    unsigned long int getDeviceIOs(int device) const;
+    double getDeviceTimer(int device) const;
+    // Defaults to FIXED_SEEK
+    void setSeekModel(enum DISK_SEEK_MODEL model);
+    enum DISK_SEEK_MODEL getSeekModel() const;
+    // The last access stopped before block getHeadBlock() of track getHeadTrack() (the schema
+    // index of a relation); the track is -1 before the first access
+    int getHeadTrack() const;
+    int getHeadBlock() const;
     // Reset the disk I/O counter.
     // Every time before you do a SQL operation, reset the counter.
     void resetDiskIOs();
     // After the operation is done, get the accumulated number of disk I/Os
     unsigned long int getDiskIOs() const;
+    // The disk I/Os reading and writing blocks; they add up to getDiskIOs().
+    // The disk I/Os and time of each relation are kept too (refer to "Relation.h");
+    // resetDiskIOs() and resetDiskTimer() reset them as well
+    unsigned long int getDiskReads() const;
+    unsigned long int getDiskWrites() const;
     // Reset the disk timmer.
     // Every time before you do a SQL operation, reset the timmer.
     void resetDiskTimer();
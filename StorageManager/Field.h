@@ -1,8 +1,14 @@
 #ifndef _FIELD_H
 #define _FIELD_H
 
+#include <cstring>
+#include <string>
+
 using namespace std;
 
+#define STR20_LENGTH 20 // the maximum number of characters of a STR20 field
+#define MAX_DICTIONARY_CODE 0xFFFFFF // the codes fit the 24 bits left over after the characters
+
 /* A field type can either be INT or STR20
  * Usage: When you specify the schema, you need the following definition of field types.
  *        When you access a field, check the schema about the field type first,
@@ -11,12 +17,48 @@ using namespace std;
 
 enum FIELD_TYPE { INT, STR20 };
 
+/* A STR20 value is stored inline in the field: the characters are not null-terminated.
+ * Use toString() to get the value, and the comparison operators to compare values
+ * in the same order as strings.
+ * A value of a dictionary-encoded relation also carries its dictionary code;
+ * two values that both have codes are compared by the codes alone.
+ * The code takes the bytes that would otherwise pad the characters to the size of
+ * an int, so a field is no larger with the code than without it.
+ */
+struct Str20 {
+    unsigned char length;
+    char chars[STR20_LENGTH];
+    unsigned int code : 24; // the dictionary code of the value, or 0 if it is not encoded
+
+    string toString() const { return string(chars,length); }
+    bool assign(const string& s) { // returns false if s is longer than STR20_LENGTH
+        if (s.size()>STR20_LENGTH) return false;
+        length=s.size();
+        memcpy(chars,s.data(),length);
+        code=0;
+        return true;
+    }
+    int compare(const Str20& s) const {
+        if (code!=0 && code==s.code) return 0;
+        int result=memcmp(chars,s.chars,length<s.length?length:s.length);
+        if (result!=0) return result;
+        return (int)length-(int)s.length;
+    }
+    bool operator==(const Str20& s) const {
+        if (code!=0 && s.code!=0) return code==s.code;
+        return length==s.length && memcmp(chars,s.chars,length)==0;
+    }
+    bool operator!=(const Str20& s) const { return !(*this==s); }
+    bool operator<(const Str20& s) const { return compare(s)<0; }
+    bool operator>(const Str20& s) const { return compare(s)>0; }
+};
+
 union Field {
 public:
-    string* str;
+    Str20 str;
     int integer;
 
-    Field() {}
+    Field() : str() {}
 };
 
 #endif
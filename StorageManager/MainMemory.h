@@ -10,7 +10,7 @@ using namespace std;
 
 class Block;
 
-/* The simulated memory holds NUM_OF_BLOCKS_IN_MEMORY blocks numbered with 0,1,2,... 
+/* The simulated memory holds Config::getNumOfBlocksInMemory() blocks numbered with 0,1,2,... 
  * You can get total number of blocks in the memory by calling MainMemory::getMemorySize(). 
  * Before accessing data of a relation, you have to copy the disk blocks of a relation 
  * to the simulated main memory. 
@@ -27,13 +27,12 @@ class Block;
 
 class MainMemory {
   private:
-    Block blocks[NUM_OF_BLOCKS_IN_MEMORY]; // an array of blocks
-    bool setBlock(int memory_block_index, const vector<Block>::const_iterator first,
-                  const vector<Block>::const_iterator last);
+    vector<Block> blocks; // an array of blocks; the disk reads and writes them in place
   public:
-    friend class Relation;
+    friend class Relation; // transfers blocks from and to the disk
 
-    MainMemory();
+    MainMemory(); // holds Config::getNumOfBlocksInMemory() blocks
+    MainMemory(int num_of_blocks);
     int getMemorySize() const; // returns total number of blocks in the memory (including empty ones)
 
     Block* getBlock(int memory_block_index); //returns NULL if out of bound
@@ -3,14 +3,14 @@
 
 #include <vector>
 
-#define MAX_NUM_CREATING_RELATIONS 100
+#include "Disk.h"
 
 using namespace std;
 
 class SchemaManager;  //must do forward declaration
-class Disk;
 class MainMemory;  //must do forward declaration
 class Block;
+class Dictionary;
 
 /* Each relation is assumed to be stored in consecutive disk blocks on a single track of the disk 
  * (in clustered way). 
@@ -43,15 +43,40 @@ class Relation {
              MainMemory* mem, Disk* disk);
 
     void null();
+    Dictionary* getDictionary() const; // returns NULL if the relation is not dictionary-encoded
+    bool hasSchemaOf(const Tuple& t) const; // returns true if t has the schema of the relation
 
   public:
     friend class SchemaManager; // creates Relation; accesses clear()
 
     string getRelationName() const;
-    Schema getSchema() const; // returns the schema of the tuple    
+    const Schema& getSchema() const; // returns the schema of the relation without copying it
     int getNumOfBlocks() const;
-    int getNumOfTuples() const;
+    int getTrackIndex() const; // returns the track of the disk that holds the relation
+    //NOTE: The following counts are kept up to date by the disk and take no disk I/O
+    int getNumOfTuples() const; // returns the number of valid tuples
+    int getNumOfHoles() const; // returns the number of invalid tuples left by deletions
+    // returns the index of the first block with an invalid tuple that a new tuple can reuse,
+    // or -1 if there is none
+    int getFirstBlockWithHoles() const;
+    // returns the number of valid tuples in the block; returns -1 if the index is out of bound
+    int getNumOfTuples(int relation_block_index) const;
+    // returns the number of tuples in the block, valid or not: the block is full when it
+    // equals Schema::getTuplesPerBlock(); returns -1 if the index is out of bound
+    int getNumOfSlots(int relation_block_index) const;
+    // returns a version of the block that changes whenever the block is written, and is never
+    // reused, even by another relation; returns 0 if the index is out of bound
+    unsigned long getBlockVersion(int relation_block_index) const;
+    // returns the disk I/Os reading and writing the blocks of the relation, and their elapse
+    // disk time in milliseconds, since Disk::resetDiskIOs() and Disk::resetDiskTimer()
+    unsigned long int getDiskReads() const;
+    unsigned long int getDiskWrites() const;
+    double getDiskTimer() const;
     bool isNull() const;
+    bool isDictionaryEncoded() const; // returns true if the STR20 fields are dictionary-encoded
+    enum BLOCK_LAYOUT getBlockLayout() const; // returns how the fields are laid out on the disk
+    // returns the dictionary code of s, or 0 if s has no code or the relation is not encoded
+    int getDictionaryCode(string s) const;
     
     Tuple createTuple() const; //creates an empty tuple of the schema
 
@@ -60,7 +85,13 @@ class Relation {
     //reads one block from the relation (the disk) and stores in the memory
     //returns false if the index is out of bound
     bool getBlock(int relation_block_index, int memory_block_index) const;
+    // reads only the fields whose offsets are flagged in 'fields' (one flag per field of the schema);
+    // the other fields of the tuples are left empty, so do not write the block back
+    bool getBlock(int relation_block_index, int memory_block_index, const vector<bool>& fields) const;
     bool getBlocks(int relation_block_index, int memory_block_index, int num_blocks) const;
+    // reads only the flagged fields of [num_blocks] blocks, with a single disk delay
+    bool getBlocks(int relation_block_index, int memory_block_index, int num_blocks,
+                   const vector<bool>& fields) const;
 
     //reads one block from the memory and stores in the relation (on the disk)
     // returns false if the index is out of bound
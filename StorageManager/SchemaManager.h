@@ -1,10 +1,17 @@
 #ifndef _SCHEMA_MANAGER_H
 #define _SCHEMA_MANAGER_H
 
+#include <deque>
+#include <iostream>
 #include <map>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "Dictionary.h"
+#include "Disk.h"
+
 using namespace std;
 
 /* A schema manager maps a relation name to a relation and a corresponding schema. 
@@ -13,12 +20,21 @@ using namespace std;
  * You will also get access to relations and schemas starting from here.
  * Usage: At the beginning of your program, you need to initialize a schema manager.
  *        Initialize the schema manager by supplying the pointer to memory and to disk
+ *        If the disk is backed by files, the relations stored on it are restored
  *        Create a relation through here (and not elsewhere) by giving relation name and schema
+ *        A relation created with dictionary encoding stores its STR20 fields as codes of
+ *          a dictionary shared by all such relations of the schema manager
+ *        A relation created with PAX_LAYOUT stores its blocks field by field (refer to "Disk.h")
+ *        A temporary relation, such as the intermediate result of a query, is dropped
+ *          with its blocks when a file-backed disk is opened again: delete it before
+ *          the process ends, or a crash leaves it behind until then
  *        Every relation name must be unique.
+ *        All the relations can be saved to an image file and restored from it at once
  *        Once a relation is created, the schema cannot be changed
+ *        The number of relations is not limited; the slot of a deleted relation is reused
+ *        by the next created relation, so do not use a relation pointer after deleting it
  */
 class MainMemory;
-class Disk;
 class Relation;
 class Schema;
 
@@ -27,22 +43,75 @@ class SchemaManager {
     MainMemory* mem;
     Disk* disk;
     map<string,int> relation_name_to_index;
-    Relation relations[MAX_NUM_CREATING_RELATIONS];
-    Schema schemas[MAX_NUM_CREATING_RELATIONS];
-    int offset;
+    // indexed by the schema index; a deque keeps the relation pointers valid as it grows
+    deque<Relation> relations;
+    vector<int> schema_ids; // the id of the interned schema of each relation
+    deque<bool> dictionary_encoded;
+    deque<bool> temporary; // the relations dropped when a file-backed disk is opened again
+    vector<int> free_indexes; // slots of deleted relations, reused first
+    // indexed by the schema id: each distinct schema is stored once and shared by the relations
+    // using it, so that tuples compare schemas by id; a deque keeps the references valid as it grows
+    deque<Schema> schemas;
+    vector<int> schema_ref_counts; // the number of relations using each schema
+    vector<int> free_schema_ids; // ids of schemas no longer used, reused first
+    unordered_map<string,int> schema_id_of_key; // the id of each schema in use, by getSchemaKey()
+    Dictionary dictionary;
+    int num_saved_dictionary_values; // the values already in "<directory>/dictionary"
+
+    // for internal use: returns the index of a free slot, growing the catalog if needed
+    int allocateIndex();
+    // for internal use: the field types and names of the schema as a string, equal for equal schemas
+    static string getSchemaKey(const Schema& schema);
+    // for internal use: returns the id of the schema, interning it if it is new
+    int internSchema(const Schema& schema);
+    // for internal use: drops a relation's reference to the schema, freeing it if unused
+    void releaseSchema(int schema_id);
+
+    // for internal use: the catalog of a file-backed disk is kept in "<directory>/catalog"
+    void loadCatalog();
+    void saveCatalog() const;
+    bool readCatalog(istream& in); // returns false if an entry is bad
+    void writeCatalog(ostream& out) const;
+    // for internal use: drops the temporary relations left by a process that did not end
+    void dropTemporaryRelations();
+    // for internal use: the dictionary is appended to "<directory>/dictionary"
+    void loadDictionary();
+    void saveDictionary();
+    bool readDictionary(istream& in); // returns false if a value is bad or read twice
+    void writeDictionary(ostream& out, int first_code) const; // the values from first_code on
 
   public:
     friend class Tuple; // accesses schema
     friend class Relation; // accesses schema
     
     SchemaManager(MainMemory* mem, Disk* disk);
-    Schema getSchema(string relation_name) const; //returns empty schema if the relation is not found
+    //returns empty schema if the relation is not found
+    const Schema& getSchema(string relation_name) const;
     bool relationExists(string relation_name) const; //returns true if the relation exists
+    void getRelationNames(vector<string>& names) const; //returns the names of all relations, sorted
     
     // returns a pointer to the newly allocated relation; the relation name must not exist already
     Relation* createRelation(string relation_name,const Schema& schema);
+    Relation* createRelation(string relation_name,const Schema& schema,bool dictionary_encoded);
+    Relation* createRelation(string relation_name,const Schema& schema,bool dictionary_encoded,
+                             enum BLOCK_LAYOUT layout);
+    Relation* createRelation(string relation_name,const Schema& schema,bool dictionary_encoded,
+                             enum BLOCK_LAYOUT layout,bool temporary);
     Relation* getRelation(string relation_name); //returns NULL if the relation is not found
     bool deleteRelation(string relation_name); //returns false if the relation is not found
+
+    // Saves the relations, their blocks and the dictionary in the single file 'path',
+    // without disk latency; returns false if the file cannot be written.
+    // The file is written aside and renamed over 'path' once complete
+    bool saveImage(string path);
+    // Replaces all the relations with the ones saved in the image 'path', without disk
+    // latency; returns false if the image is not valid or was saved with other
+    // Config::getFieldsPerBlock(), leaving the relations unchanged: the whole image but
+    // the pages is checked before any relation is dropped.
+    // The relation pointers got before are no longer valid.
+    // The in-memory disk maps the pages of the image: do not modify the file in place
+    // while the disk is in use (saveImage() replaces it, which is safe)
+    bool loadImage(string path);
     
     void printSchemas() const; //print all relations and their schema
     void printSchemas(ostream &out) const;
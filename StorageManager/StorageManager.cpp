@@ -1,8 +1,22 @@
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
 #include <ctime>
+#include <chrono>
+#include <thread>
 #include <climits>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "Block.h"
 #include "Config.h"
+#include "Dictionary.h"
 #include "Disk.h"
 #include "Field.h"
 #include "MainMemory.h"
@@ -10,122 +24,856 @@
 #include "Schema.h"
 #include "SchemaManager.h"
 #include "Tuple.h"
+#include "WriteAheadLog.h"
 
 using namespace std;
 
-Disk::Disk() { resetDiskIOs(); resetDiskTimer(); }
+int Config::fields_per_block=FIELDS_PER_BLOCK;
+int Config::num_of_blocks_in_memory=NUM_OF_BLOCKS_IN_MEMORY;
 
-/*
-bool Disk::extendTrack(int schema_index, int block_index, const Tuple& t) {
-  if (block_index<0) {
-    cerr << "extendTrack ERROR: block index " << block_index << " out of disk bound" << endl;
+int Config::getFieldsPerBlock() {
+  return fields_per_block;
+}
+
+bool Config::setFieldsPerBlock(int fields_per_block) {
+  if (fields_per_block<MAX_NUM_OF_FIELDS_IN_RELATION) {
+    cerr << "setFieldsPerBlock ERROR: a block must hold at least "
+         << MAX_NUM_OF_FIELDS_IN_RELATION << " fields" << endl;
+    return false;
+  }
+  Config::fields_per_block=fields_per_block;
+  return true;
+}
+
+int Config::getNumOfBlocksInMemory() {
+  return num_of_blocks_in_memory;
+}
+
+bool Config::setNumOfBlocksInMemory(int num_of_blocks) {
+  if (num_of_blocks<=0) {
+    cerr << "setNumOfBlocksInMemory ERROR: " << num_of_blocks << " blocks are too few" << endl;
+    return false;
+  }
+  num_of_blocks_in_memory=num_of_blocks;
+  return true;
+}
+
+// Page layout: [int number of tuple slots][one null flag per slot][field cells]
+// A block holds at most fields_per_block fields, thus at most fields_per_block tuple slots.
+// ROW_LAYOUT: the fields of the tuple in slot i occupy cells i*num_of_fields ... (i+1)*num_of_fields-1.
+// PAX_LAYOUT: the values of field j occupy cells j*tuples_per_block ... (j+1)*tuples_per_block-1.
+// COMPRESSED_LAYOUT: the cells are replaced by [int length][field 0]...[field n-1], where each field
+//   holds the values of the valid tuples only:
+//   INT:   [int base][unsigned char width][value-base in 'width' little-endian bytes]*
+//   STR20: [unsigned char run length][dictionary code, or length byte and characters]*
+//   A value takes at most 22 bytes, so the compressed fields never outgrow the cells.
+// A packed block is [int length][the first 'length' bytes of its page]: the bytes past the
+// last non-zero byte of the page are left out, and are zero again when it is unpacked.
+static const int FIELD_CELL_SIZE=24; // an int, a dictionary code, or a length byte followed by STR20_LENGTH characters
+
+static string trackPath(const string& directory, int schema_index) {
+  ostringstream path;
+  path << directory << "/track_" << schema_index;
+  return path.str();
+}
+
+static void appendPackedBlock(const char* page, int page_size, string& blocks) {
+  int length=page_size;
+  while (length>0 && page[length-1]==0) length--;
+  blocks.append((const char*)&length,sizeof(int));
+  blocks.append(page,length);
+}
+
+// Finds the offsets of the packed blocks in 'size' bytes; returns false if they are corrupted
+static bool findPackedBlocks(const char* blocks, size_t size, int page_size, vector<size_t>& offsets) {
+  offsets.clear();
+  size_t offset=0;
+  while (offset<size) {
+    int length;
+    if (size-offset<sizeof(int)) return false;
+    memcpy(&length,blocks+offset,sizeof(int));
+    if (length<0 || length>page_size || (size_t)length>size-offset-sizeof(int)) return false;
+    offsets.push_back(offset);
+    offset+=sizeof(int)+length;
+  }
+  return true;
+}
+
+// Writes the packed blocks to a new file, syncs it and renames it over 'path'.
+// Returns the descriptor of the new file, or -1 if the old file is left in place
+static int replaceTrackFile(const string& path, const string& blocks) {
+  string temp_path=path+".tmp";
+  int fd=open(temp_path.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644);
+  bool written=fd!=-1 && write(fd,blocks.data(),blocks.size())==(ssize_t)blocks.size()
+      && fdatasync(fd)==0 && rename(temp_path.c_str(),path.c_str())==0;
+  if (!written) {
+    if (fd!=-1) close(fd);
+    unlink(temp_path.c_str());
+    return -1;
+  }
+  return fd;
+}
+
+// Syncs the entries of the directory, so that the files renamed into it survive a crash
+static void syncDirectory(const string& directory) {
+  int fd=open(directory.c_str(),O_RDONLY);
+  if (fd==-1) return;
+  fsync(fd);
+  close(fd);
+}
+
+// Marks the slots [current number of slots, num_slots) of the page as holes
+static void fillPageWithHoles(char* page, int num_slots) {
+  int n;
+  memcpy(&n,page,sizeof(int));
+  if (n>=num_slots) return;
+  memset(page+sizeof(int)+n,1,num_slots-n);
+  memcpy(page,&num_slots,sizeof(int));
+}
+
+Disk::Disk() {
+  last_version=0;
+  resetDiskIOs();
+  resetDiskTimer();
+  setLatencyMode(SIMULATED_DISK_LATENCY_ON==1?SPIN_LATENCY:VIRTUAL_LATENCY);
+  setLatencyScale(1);
+  profile=getHDDProfile();
+  seek_model=FIXED_SEEK;
+  head_track=-1;
+  head_block=0;
+  setNumOfDevices(1);
+  fields_per_block=Config::getFieldsPerBlock();
+}
+
+Disk::Disk(string directory) {
+  last_version=0;
+  resetDiskIOs();
+  resetDiskTimer();
+  setLatencyMode(SIMULATED_DISK_LATENCY_ON==1?SPIN_LATENCY:VIRTUAL_LATENCY);
+  setLatencyScale(1);
+  profile=getHDDProfile();
+  seek_model=FIXED_SEEK;
+  head_track=-1;
+  head_block=0;
+  setNumOfDevices(1);
+  fields_per_block=Config::getFieldsPerBlock();
+  if (directory=="") return;
+  if (mkdir(directory.c_str(),0755)!=0 && errno!=EEXIST) {
+    cerr << "Disk ERROR: cannot create directory " << directory << "; using an in-memory disk" << endl;
+    return;
+  }
+  this->directory=directory;
+
+  // the pages on an existing disk keep the geometry they were written with
+  string path=directory+"/geometry";
+  ifstream in(path.c_str());
+  int stored_fields_per_block;
+  if (in >> stored_fields_per_block) {
+    if (stored_fields_per_block!=fields_per_block) {
+      cerr << "Disk: " << directory << " holds blocks of " << stored_fields_per_block
+           << " fields; using that geometry" << endl;
+      Config::setFieldsPerBlock(stored_fields_per_block);
+      fields_per_block=stored_fields_per_block;
+    }
+  } else {
+    ofstream out(path.c_str());
+    out << fields_per_block << endl;
+  }
+  empty_page.assign(getPageSize(),0);
+  // the changes committed before a crash are replayed onto the track files
+  if (!wal.open(directory,getPageSize()))
+    cerr << "Disk ERROR: the changes to " << directory << " are not logged" << endl;
+}
+
+Disk::~Disk() {
+  if (isPersistent()) checkpoint();
+  for (int i=0;i<tracks.size();i++) {
+    if (tracks[i].mapping!=NULL) munmap(tracks[i].mapping,tracks[i].mapped_bytes);
+    if (tracks[i].fd!=-1) close(tracks[i].fd);
+  }
+}
+
+bool Disk::isPersistent() const {
+  return directory!="";
+}
+
+string Disk::getDirectory() const {
+  return directory;
+}
+
+int Disk::getPageSize() const {
+  int size=sizeof(int)+fields_per_block+fields_per_block*FIELD_CELL_SIZE;
+  return (size+7)/8*8;
+}
+
+Disk::Track& Disk::getTrack(int schema_index) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (schema_index>=tracks.size()) tracks.resize(schema_index+1);
+  return tracks[schema_index];
+}
+
+bool Disk::openTrack(int schema_index) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  Track& track=getTrack(schema_index);
+  // the file of a removed track stays until the next checkpoint, but is not the track's
+  if (!isPersistent() || track.fd!=-1 || removed_tracks.count(schema_index)) return true;
+  string path=trackPath(directory,schema_index);
+  track.fd=open(path.c_str(),O_RDWR|O_CREAT,0644);
+  if (track.fd==-1) {
+    cerr << "openTrack ERROR: cannot open " << path << endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(track.fd,&st)!=0) {
+    cerr << "openTrack ERROR: cannot read the size of " << path << endl;
+    return false;
+  }
+  // the pages are mapped now and faulted in when they are first touched;
+  // only the headers are read to count the tuples
+  track.file_bytes=st.st_size;
+  if (!mapTrackFile(schema_index)) return false;
+  if (!findPackedBlocks(track.mapping,track.file_bytes,getPageSize(),track.block_offsets)) {
+    cerr << "openTrack ERROR: " << path << " is corrupted" << endl;
+    return false;
+  }
+  track.file_blocks=track.block_offsets.size();
+  track.clean_blocks=track.file_blocks;
+  if (!resizeTrack(schema_index,track.file_blocks)) return false;
+  for (int i=0;i<track.num_blocks;i++) updateBlockStats(schema_index,i);
+  return true;
+}
+
+bool Disk::mapTrackFile(int schema_index) {
+  Track& track=getTrack(schema_index);
+  if (track.file_bytes<=track.mapped_bytes) return true;
+  // map more than needed so that a growing track is not remapped at every checkpoint.
+  // The mapping is read-only: the blocks are written to the file by checkpoint() only
+  size_t capacity=max(max(track.mapped_bytes*2,track.file_bytes),(size_t)16*getPageSize());
+  void* mapping=mmap(NULL,capacity,PROT_READ,MAP_SHARED,track.fd,0);
+  if (mapping==MAP_FAILED) {
+    cerr << "mapTrackFile ERROR: cannot map track " << schema_index << endl;
+    return false;
+  }
+  if (track.mapping!=NULL) munmap(track.mapping,track.mapped_bytes);
+  track.mapping=(char*)mapping;
+  track.mapped_bytes=capacity;
+  return true;
+}
+
+bool Disk::writeTrackFile(int schema_index) {
+  Track& track=getTrack(schema_index);
+  if (track.dirty_pages.empty() && track.num_blocks==track.file_blocks && track.clean_blocks==track.num_blocks)
+    return true;
+  string path=trackPath(directory,schema_index);
+  // the blocks move when one of them changes its length, so the whole file is written again
+  string blocks;
+  for (int i=0;i<track.num_blocks;i++) appendPackedBlock(getPage(schema_index,i),getPageSize(),blocks);
+  int fd=replaceTrackFile(path,blocks);
+  if (fd==-1) {
+    cerr << "writeTrackFile ERROR: cannot write " << path << endl;
     return false;
-  }   
-  vector<Block>& track=tracks[schema_index];
-  int j=track.size();
-  if (block_index>=j) {
-    if (j>0) {
-      while (!track[j-1].isFull()) { // first fill the last block with invalid tuples
-        track[j-1].appendTuple(t);
+  }
+  if (track.mapping!=NULL) munmap(track.mapping,track.mapped_bytes);
+  if (track.fd!=-1) close(track.fd);
+  track.fd=fd;
+  track.mapping=NULL;
+  track.mapped_bytes=0;
+  track.file_bytes=blocks.size();
+  track.open_block=-1;
+  if (!mapTrackFile(schema_index)) return false;
+  findPackedBlocks(track.mapping,track.file_bytes,getPageSize(),track.block_offsets);
+  track.file_blocks=track.num_blocks;
+  track.clean_blocks=track.num_blocks;
+  track.dirty_pages.clear();
+  return true;
+}
+
+bool Disk::resizeTrack(int schema_index, int num_blocks) {
+  Track& track=getTrack(schema_index);
+  size_t page_size=getPageSize();
+  for (int i=num_blocks;i<track.num_blocks;i++) {
+    track.num_slots-=track.block_slots[i];
+    track.num_tuples-=track.block_tuples[i];
+  }
+  track.blocks_with_holes.erase(track.blocks_with_holes.lower_bound(num_blocks),
+                                track.blocks_with_holes.end());
+  track.block_slots.resize(num_blocks,0); // new pages are empty
+  track.block_tuples.resize(num_blocks,0);
+  track.block_bytes.resize(num_blocks,0);
+  for (int i=track.block_versions.size();i<num_blocks;i++) track.block_versions.push_back(++last_version);
+  track.block_versions.resize(num_blocks);
+  if (track.open_block>=num_blocks) {
+    track.open_block=-1;
+    track.page_dirty=false;
+  }
+  if (isPersistent()) {
+    // the track file is resized by the next checkpoint
+    track.dirty_pages.erase(track.dirty_pages.lower_bound(num_blocks),track.dirty_pages.end());
+    track.clean_blocks=min(track.clean_blocks,num_blocks);
+    track.num_blocks=num_blocks;
+    return true;
+  }
+  if (track.layout==COMPRESSED_LAYOUT) {
+    packPage(schema_index);
+    if (num_blocks<track.num_blocks) track.buffer.resize(track.block_offsets[num_blocks]);
+    track.block_offsets.resize(num_blocks);
+    for (int i=track.num_blocks;i<num_blocks;i++) { // new blocks are empty
+      track.block_offsets[i]=track.buffer.size();
+      track.buffer.resize(track.buffer.size()+sizeof(int),0);
+    }
+    track.num_blocks=num_blocks;
+    return true;
+  }
+  if (track.mapping!=NULL && (size_t)num_blocks*page_size>track.mapped_bytes) {
+    // the track outgrows the pages mapped from an image: copy them
+    track.buffer.assign(track.mapping,track.mapping+(size_t)track.num_blocks*page_size);
+    munmap(track.mapping,track.mapped_bytes);
+    track.mapping=NULL;
+    track.mapped_bytes=0;
+  }
+  if (track.mapping!=NULL) {
+    if (num_blocks>track.num_blocks) // new pages are zero, as in the buffer
+      memset(track.mapping+(size_t)track.num_blocks*page_size,0,(size_t)(num_blocks-track.num_blocks)*page_size);
+  } else {
+    track.buffer.resize((size_t)num_blocks*page_size); // new pages are zero: no tuple slots
+  }
+  track.num_blocks=num_blocks;
+  return true;
+}
+
+const char* Disk::getPage(int schema_index, int block_index) {
+  Track& track=getTrack(schema_index);
+  if (!isPersistent()) {
+    if (track.layout==COMPRESSED_LAYOUT) return unpackPage(schema_index,block_index);
+    const char* pages=track.mapping!=NULL?track.mapping:&track.buffer[0];
+    return pages+(size_t)block_index*getPageSize();
+  }
+  map<int,string>::iterator it=track.dirty_pages.find(block_index);
+  if (it!=track.dirty_pages.end()) return it->second.data();
+  if (block_index>=track.clean_blocks) return &empty_page[0];
+  return unpackPage(schema_index,block_index);
+}
+
+char* Disk::getDirtyPage(int schema_index, int block_index) {
+  Track& track=getTrack(schema_index);
+  if (!isPersistent()) {
+    if (track.layout==COMPRESSED_LAYOUT) {
+      // packed into the vector once another block is accessed
+      char* page=(char*)unpackPage(schema_index,block_index);
+      track.page_dirty=true;
+      return page;
+    }
+    char* pages=track.mapping!=NULL?track.mapping:&track.buffer[0];
+    return pages+(size_t)block_index*getPageSize();
+  }
+  map<int,string>::iterator it=track.dirty_pages.find(block_index);
+  if (it==track.dirty_pages.end()) {
+    const char* page=getPage(schema_index,block_index);
+    it=track.dirty_pages.insert(make_pair(block_index,string(page,getPageSize()))).first;
+  }
+  return &it->second[0];
+}
+
+const char* Disk::unpackPage(int schema_index, int block_index) {
+  Track& track=getTrack(schema_index);
+  if (track.open_block!=block_index) {
+    packPage(schema_index);
+    const char* blocks=isPersistent()?track.mapping:&track.buffer[0];
+    const char* block=blocks+track.block_offsets[block_index];
+    int length;
+    memcpy(&length,block,sizeof(int));
+    track.page.assign(getPageSize(),0);
+    memcpy(&track.page[0],block+sizeof(int),length);
+    track.open_block=block_index;
+  }
+  return &track.page[0];
+}
+
+void Disk::packPage(int schema_index) {
+  Track& track=getTrack(schema_index);
+  if (!track.page_dirty) return;
+  track.page_dirty=false;
+  string block;
+  appendPackedBlock(&track.page[0],getPageSize(),block);
+  // the blocks after it move by the change of its length
+  size_t start=track.block_offsets[track.open_block];
+  int old_length;
+  memcpy(&old_length,&track.buffer[start],sizeof(int));
+  long change=(long)block.size()-(long)(sizeof(int)+old_length);
+  if (change>0) track.buffer.insert(track.buffer.begin()+start,change,0);
+  else track.buffer.erase(track.buffer.begin()+start,track.buffer.begin()+start-change);
+  memcpy(&track.buffer[start],block.data(),block.size());
+  for (int i=track.open_block+1;i<track.num_blocks;i++) track.block_offsets[i]+=change;
+}
+
+int Disk::getTrackSize(int schema_index) {
+  if (!openTrack(schema_index)) return 0;
+  return getTrack(schema_index).num_blocks;
+}
+
+void Disk::updateBlockStats(int schema_index, int block_index) {
+  Track& track=getTrack(schema_index);
+  const char* page=getPage(schema_index,block_index);
+  const char* null_flags=page+sizeof(int);
+  int num_slots;
+  memcpy(&num_slots,page,sizeof(int));
+  int num_tuples=num_slots-count(null_flags,null_flags+num_slots,1);
+  track.num_slots+=num_slots-track.block_slots[block_index];
+  track.num_tuples+=num_tuples-track.block_tuples[block_index];
+  track.block_slots[block_index]=num_slots;
+  track.block_tuples[block_index]=num_tuples;
+  if (num_tuples<num_slots) track.blocks_with_holes.insert(block_index);
+  else track.blocks_with_holes.erase(block_index);
+  int num_bytes=getPageSize();
+  if (track.layout==COMPRESSED_LAYOUT) {
+    int length;
+    memcpy(&length,null_flags+fields_per_block,sizeof(int));
+    num_bytes=sizeof(int)+fields_per_block+sizeof(int)+length;
+  }
+  track.block_bytes[block_index]=num_bytes;
+  track.block_versions[block_index]=++last_version;
+}
+
+int Disk::getNumOfTransferredPages(int schema_index, int block_index, int num_blocks) {
+  Track& track=getTrack(schema_index);
+  if (track.layout!=COMPRESSED_LAYOUT) return num_blocks;
+  // the compressed blocks are transferred back to back
+  long num_bytes=0;
+  for (int i=block_index;i<block_index+num_blocks;i++) num_bytes+=track.block_bytes[i];
+  int page_size=getPageSize();
+  return max(1,(int)((num_bytes+page_size-1)/page_size));
+}
+
+
+int Disk::getNumOfSlots(int schema_index) {
+  if (!openTrack(schema_index)) return 0;
+  return getTrack(schema_index).num_slots;
+}
+
+int Disk::getNumOfTuples(int schema_index) {
+  if (!openTrack(schema_index)) return 0;
+  return getTrack(schema_index).num_tuples;
+}
+
+int Disk::getNumOfSlots(int schema_index, int block_index) {
+  return getTrack(schema_index).block_slots[block_index];
+}
+
+int Disk::getNumOfTuples(int schema_index, int block_index) {
+  return getTrack(schema_index).block_tuples[block_index];
+}
+
+unsigned long Disk::getBlockVersion(int schema_index, int block_index) {
+  return getTrack(schema_index).block_versions[block_index];
+}
+
+int Disk::getFirstBlockWithHoles(int schema_index) {
+  if (!openTrack(schema_index)) return -1;
+  const set<int>& blocks=getTrack(schema_index).blocks_with_holes;
+  return blocks.empty()?-1:*blocks.begin();
+}
+
+bool Disk::isPageEmpty(int schema_index, int block_index) {
+  int num_slots;
+  memcpy(&num_slots,getPage(schema_index,block_index),sizeof(int));
+  return num_slots==0;
+}
+
+void Disk::getCellStrides(int schema_index, int num_fields, int& slot_stride, int& field_stride) {
+  if (getTrack(schema_index).layout==PAX_LAYOUT) {
+    slot_stride=1;
+    field_stride=fields_per_block/num_fields; // the tuples per block
+  } else {
+    slot_stride=num_fields;
+    field_stride=1;
+  }
+}
+
+void Disk::setTrackLayout(int schema_index, enum BLOCK_LAYOUT layout) {
+  getTrack(schema_index).layout=layout;
+}
+
+enum BLOCK_LAYOUT Disk::getTrackLayout(int schema_index) {
+  return getTrack(schema_index).layout;
+}
+
+void Disk::readBlock(int schema_index, int block_index, const Tuple& t, const Dictionary* dictionary,
+                     const vector<bool>* fields, Block& b) {
+  const char* page=getPage(schema_index,block_index);
+  const char* null_flags=page+sizeof(int);
+  const char* cells=null_flags+fields_per_block;
+  int num_slots;
+  memcpy(&num_slots,page,sizeof(int));
+  const Schema& schema=t.getSchema();
+  int num_fields=schema.getNumOfFields();
+  int slot_stride, field_stride;
+  getCellStrides(schema_index,num_fields,slot_stride,field_stride);
+  // the tuples are decoded in place, reusing the storage of the block
+  b.tuples.assign(num_slots,t);
+  for (int i=0;i<num_slots;i++) {
+    if (null_flags[i]) b.tuples[i].null();
+  }
+  if (getTrack(schema_index).layout==COMPRESSED_LAYOUT) {
+    readCompressedFields(cells,schema,dictionary,fields,b);
+    return;
+  }
+  // one field at a time, so that the cells of a PAX page are read sequentially
+  for (int j=0;j<num_fields;j++) {
+    if (fields!=NULL && !(*fields)[j]) continue;
+    enum FIELD_TYPE field_type=schema.getFieldType(j);
+    for (int i=0;i<num_slots;i++) {
+      if (null_flags[i]) continue;
+      const char* cell=cells+(i*slot_stride+j*field_stride)*FIELD_CELL_SIZE;
+      Field& field=b.tuples[i].fields[j];
+      if (field_type==INT) {
+        memcpy(&field.integer,cell,sizeof(int));
+      } else if (dictionary!=NULL) {
+        int code;
+        memcpy(&code,cell,sizeof(int));
+        field.str=dictionary->decode(code);
+      } else {
+        memcpy(&field.str,cell,1+STR20_LENGTH); // a length byte followed by the characters
+        field.str.code=0;
       }
     }
-    // fill the gap with invalid tuples
-    for (int i=j;i<block_index;i++) {
-      track.push_back(Block::getDummyBlock());
-      while (!track[i].isFull()) {
-        track[i].appendTuple(t);
+  }
+}
+
+void Disk::writeBlock(int schema_index, int block_index, const Block& b, Dictionary* dictionary) {
+  char* page=getDirtyPage(schema_index,block_index);
+  char* null_flags=page+sizeof(int);
+  char* cells=null_flags+fields_per_block;
+  int num_slots=b.tuples.size();
+  memset(page,0,getPageSize());
+  memcpy(page,&num_slots,sizeof(int));
+  if (num_slots==0) return;
+  const Schema& schema=b.tuples.front().getSchema();
+  int num_fields=schema.getNumOfFields();
+  enum FIELD_TYPE field_types[MAX_NUM_OF_FIELDS_IN_RELATION];
+  for (int j=0;j<num_fields;j++) field_types[j]=schema.getFieldType(j);
+  if (getTrack(schema_index).layout==COMPRESSED_LAYOUT) {
+    for (int i=0;i<num_slots;i++) {
+      if (b.tuples[i].isNull()) null_flags[i]=1;
+    }
+    writeCompressedFields(cells,schema,dictionary,b);
+    return;
+  }
+  int slot_stride, field_stride;
+  getCellStrides(schema_index,num_fields,slot_stride,field_stride);
+  for (int i=0;i<num_slots;i++) {
+    const Tuple& tuple=b.tuples[i];
+    if (tuple.isNull()) {
+      null_flags[i]=1;
+      continue;
+    }
+    for (int j=0;j<num_fields;j++) {
+      char* cell=cells+(i*slot_stride+j*field_stride)*FIELD_CELL_SIZE;
+      const Field& field=tuple.fields[j];
+      if (field_types[j]==INT) {
+        memcpy(cell,&field.integer,sizeof(int));
+      } else if (dictionary!=NULL) {
+        int code=field.str.code!=0?field.str.code:dictionary->encode(field.str);
+        memcpy(cell,&code,sizeof(int));
+      } else {
+        memcpy(cell,&field.str,1+STR20_LENGTH); // a length byte followed by the characters
       }
     }
   }
-  return true;
 }
-*/
+
+void Disk::readCompressedFields(const char* cells, const Schema& schema, const Dictionary* dictionary,
+                                const vector<bool>* fields, Block& b) {
+  vector<Tuple*> tuples; // the valid tuples, whose values are stored
+  for (int i=0;i<b.tuples.size();i++) {
+    if (!b.tuples[i].isNull()) tuples.push_back(&b.tuples[i]);
+  }
+  if (tuples.empty()) return;
+  const char* p=cells+sizeof(int);
+  for (int j=0;j<schema.getNumOfFields();j++) {
+    bool wanted=(fields==NULL || (*fields)[j]);
+    if (schema.getFieldType(j)==INT) {
+      int base;
+      memcpy(&base,p,sizeof(int));
+      int width=(unsigned char)p[sizeof(int)];
+      p+=sizeof(int)+1;
+      if (wanted) {
+        for (int i=0;i<tuples.size();i++) {
+          unsigned int delta=0;
+          for (int k=0;k<width;k++) delta|=(unsigned int)(unsigned char)p[i*width+k]<<(8*k);
+          tuples[i]->fields[j].integer=(int)((unsigned int)base+delta);
+        }
+      }
+      p+=tuples.size()*width;
+      continue;
+    }
+    for (int i=0;i<tuples.size();) {
+      int run=(unsigned char)*p++;
+      Str20 value=Str20();
+      if (dictionary!=NULL) {
+        int code;
+        memcpy(&code,p,sizeof(int));
+        p+=sizeof(int);
+        if (wanted) value=dictionary->decode(code);
+      } else {
+        int length=(unsigned char)*p;
+        if (wanted) {
+          memcpy(&value,p,1+length);
+          value.code=0;
+        }
+        p+=1+length;
+      }
+      for (int k=0;k<run;k++,i++) {
+        if (wanted) tuples[i]->fields[j].str=value;
+      }
+    }
+  }
+}
+
+void Disk::writeCompressedFields(char* cells, const Schema& schema, Dictionary* dictionary, const Block& b) {
+  vector<const Tuple*> tuples;
+  for (int i=0;i<b.tuples.size();i++) {
+    if (!b.tuples[i].isNull()) tuples.push_back(&b.tuples[i]);
+  }
+  char* p=cells+sizeof(int);
+  for (int j=0;j<schema.getNumOfFields() && !tuples.empty();j++) {
+    if (schema.getFieldType(j)==INT) {
+      // frame of reference: the offsets from the smallest value, in as few bytes as they need
+      int base=tuples[0]->fields[j].integer, top=base;
+      for (int i=1;i<tuples.size();i++) {
+        base=min(base,tuples[i]->fields[j].integer);
+        top=max(top,tuples[i]->fields[j].integer);
+      }
+      unsigned int range=(unsigned int)top-(unsigned int)base;
+      int width=range==0?0:range<=0xff?1:range<=0xffff?2:4;
+      memcpy(p,&base,sizeof(int));
+      p[sizeof(int)]=(char)width;
+      p+=sizeof(int)+1;
+      for (int i=0;i<tuples.size();i++) {
+        unsigned int delta=(unsigned int)tuples[i]->fields[j].integer-(unsigned int)base;
+        for (int k=0;k<width;k++) *p++=(char)(delta>>(8*k));
+      }
+      continue;
+    }
+    // run-length encoding of the consecutive equal values
+    for (int i=0;i<tuples.size();) {
+      const Str20& value=tuples[i]->fields[j].str;
+      int run=1;
+      while (i+run<tuples.size() && run<255 && tuples[i+run]->fields[j].str==value) run++;
+      *p++=(char)run;
+      if (dictionary!=NULL) {
+        int code=value.code!=0?value.code:dictionary->encode(value);
+        memcpy(p,&code,sizeof(int));
+        p+=sizeof(int);
+      } else {
+        memcpy(p,&value,1+value.length); // a length byte followed by the characters
+        p+=1+value.length;
+      }
+      i+=run;
+    }
+  }
+  int length=p-(cells+sizeof(int));
+  memcpy(cells,&length,sizeof(int));
+}
 
 bool Disk::extendTrack(int schema_index, int block_index, const Tuple& t) {
+  lock_guard<recursive_mutex> lock(access_mutex);
   if (block_index<0) {
     cerr << "extendTrack ERROR: block index " << block_index << " out of disk bound" << endl;
     return false;
-  }   
-  vector<Block>& track=tracks[schema_index];
-  int j=track.size();
+  }
+  int j=getTrackSize(schema_index);
   if (block_index>j) {
-    if (j>0) {
-      while (!track[j-1].isFull()) { // first fill the last block with invalid tuples
-        track[j-1].appendTuple(t);
-      }
+    int tuples_per_block=t.getTuplesPerBlock();
+    if (!resizeTrack(schema_index,block_index)) return false;
+    if (j>0) { // first fill the last block with invalid tuples
+      fillPageWithHoles(getDirtyPage(schema_index,j-1),tuples_per_block);
+      updateBlockStats(schema_index,j-1);
     }
     // fill the gap with invalid tuples
     for (int i=j;i<block_index-1;i++) {
-      track.push_back(Block::getDummyBlock());
-      while (!track[i].isFull()) {
-        track[i].appendTuple(t);
-      }
+      fillPageWithHoles(getDirtyPage(schema_index,i),tuples_per_block);
+      updateBlockStats(schema_index,i);
     }
     // fill the last block with only one invalid tuple
-    track.push_back(Block::getDummyBlock());
-    track[block_index-1].appendTuple(t);
+    fillPageWithHoles(getDirtyPage(schema_index,block_index-1),1);
+    updateBlockStats(schema_index,block_index-1);
+    if (wal.isOpen()) {
+      for (int i=max(j-1,0);i<block_index;i++) wal.logPage(schema_index,i,getPage(schema_index,i));
+    }
   }
   return true;
 }
 
 bool Disk::shrinkTrack(int schema_index, int block_index) {
-  if (block_index<0 || block_index >= tracks[schema_index].size()) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (block_index<0 || block_index >= getTrackSize(schema_index)) {
     cerr << "shrinkTrack ERROR: block index " << block_index << " out of disk bound" << endl;
     return false;
-  }  
-  tracks[schema_index].erase(tracks[schema_index].begin()+block_index,tracks[schema_index].end());
+  }
+  if (wal.isOpen()) wal.logTruncate(schema_index,block_index);
+  return resizeTrack(schema_index,block_index);
+}
+
+void Disk::clearTrack(int schema_index) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  Track& track=getTrack(schema_index);
+  if (track.mapping!=NULL) munmap(track.mapping,track.mapped_bytes);
+  if (isPersistent()) {
+    if (track.fd!=-1) close(track.fd);
+    // the file is removed by the next checkpoint, once the log holds the removal
+    removed_tracks.insert(schema_index);
+    if (wal.isOpen()) wal.logRemove(schema_index);
+  }
+  track=Track();
+}
+
+// The block counts of a track in an image: the slots of every block, then the tuples
+// of every block, then the bytes transferred for every block
+bool Disk::saveTrackImage(int schema_index, int fd, off_t counts_offset, off_t pages_offset) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  int num_blocks=getTrackSize(schema_index);
+  if (num_blocks==0) return true;
+  Track& track=getTrack(schema_index);
+  size_t counts_size=num_blocks*sizeof(int);
+  size_t page_size=getPageSize();
+  size_t pages_size=num_blocks*page_size;
+  bool written=pwrite(fd,&track.block_slots[0],counts_size,counts_offset)==(ssize_t)counts_size
+      && pwrite(fd,&track.block_tuples[0],counts_size,counts_offset+counts_size)==(ssize_t)counts_size
+      && pwrite(fd,&track.block_bytes[0],counts_size,counts_offset+2*counts_size)==(ssize_t)counts_size;
+  if (!isPersistent() && track.layout!=COMPRESSED_LAYOUT) {
+    written=written && pwrite(fd,getPage(schema_index,0),pages_size,pages_offset)==(ssize_t)pages_size;
+  } else {
+    // the packed blocks are unpacked one at a time
+    for (int i=0;written && i<num_blocks;i++)
+      written=pwrite(fd,getPage(schema_index,i),page_size,pages_offset+i*page_size)==(ssize_t)page_size;
+  }
+  if (!written) {
+    cerr << "saveTrackImage ERROR: cannot write track " << schema_index << endl;
+    return false;
+  }
   return true;
 }
 
-Block Disk::getBlock(int schema_index, int block_index) {
-  if (block_index<0 || block_index>=tracks[schema_index].size())  {
+bool Disk::loadTrackImage(int schema_index, int fd, off_t counts_offset, off_t pages_offset,
+                          int num_blocks) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (getTrackSize(schema_index)!=0) {
+    cerr << "loadTrackImage ERROR: track " << schema_index << " is not empty" << endl;
+    return false;
+  }
+  if (num_blocks==0) return true;
+  Track& track=getTrack(schema_index);
+  vector<int> counts((size_t)3*num_blocks);
+  size_t counts_size=counts.size()*sizeof(int);
+  if (pread(fd,&counts[0],counts_size,counts_offset)!=(ssize_t)counts_size) {
+    cerr << "loadTrackImage ERROR: cannot read the block counts of track " << schema_index << endl;
+    return false;
+  }
+  size_t pages_size=(size_t)num_blocks*getPageSize();
+  bool contiguous=!isPersistent() && track.layout!=COMPRESSED_LAYOUT;
+  if (contiguous && pages_offset%sysconf(_SC_PAGESIZE)==0) {
+    void* mapping=mmap(NULL,pages_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,pages_offset);
+    if (mapping==MAP_FAILED) {
+      cerr << "loadTrackImage ERROR: cannot map track " << schema_index << endl;
+      return false;
+    }
+    track.mapping=(char*)mapping;
+    track.mapped_bytes=pages_size;
+    track.num_blocks=num_blocks;
+    track.block_slots.resize(num_blocks);
+    track.block_tuples.resize(num_blocks);
+    track.block_bytes.resize(num_blocks);
+    for (int i=0;i<num_blocks;i++) track.block_versions.push_back(++last_version);
+  } else {
+    bool read=resizeTrack(schema_index,num_blocks);
+    if (contiguous) {
+      read=read && pread(fd,getDirtyPage(schema_index,0),pages_size,pages_offset)==(ssize_t)pages_size;
+    } else {
+      size_t page_size=getPageSize();
+      for (int i=0;read && i<num_blocks;i++)
+        read=pread(fd,getDirtyPage(schema_index,i),page_size,pages_offset+i*page_size)==(ssize_t)page_size;
+    }
+    if (!read) {
+      cerr << "loadTrackImage ERROR: cannot read the pages of track " << schema_index << endl;
+      resizeTrack(schema_index,0);
+      return false;
+    }
+  }
+  // the counts are restored without touching the pages
+  for (int i=0;i<num_blocks;i++) {
+    track.block_slots[i]=counts[i];
+    track.block_tuples[i]=counts[num_blocks+i];
+    track.block_bytes[i]=counts[2*num_blocks+i];
+    track.num_slots+=counts[i];
+    track.num_tuples+=counts[num_blocks+i];
+    if (counts[num_blocks+i]<counts[i]) track.blocks_with_holes.insert(i);
+  }
+  return true;
+}
+
+bool Disk::getBlock(int schema_index, int block_index, const Tuple& t, const Dictionary* dictionary,
+                    const vector<bool>* fields, Block& b) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (block_index<0 || block_index>=getTrackSize(schema_index))  {
     cerr << "getBlock ERROR: block index " << block_index << " out of disk bound" << endl;
-    return Block::getDummyBlock();
+    return false;
   }
-  incrementDiskIOs(1);
-  incrementDiskTimer(1);
-  
-  return tracks[schema_index][block_index];
+  chargeTrack(schema_index,block_index,1,1,false);
+
+  if (isPageEmpty(schema_index,block_index)) return false;
+  readBlock(schema_index,block_index,t,dictionary,fields,b);
+  return true;
 }
 
-vector<Block> Disk::getBlocks(int schema_index, int block_index, int num_blocks) {
-  if (block_index<0 || block_index>=tracks[schema_index].size())  {
+bool Disk::getBlocks(int schema_index, int block_index, int num_blocks, const Tuple& t,
+                     const Dictionary* dictionary, const vector<bool>* fields, Block* blocks) {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (block_index<0 || block_index>=getTrackSize(schema_index))  {
     cerr << "getBlocks ERROR: block index " << block_index << " out of disk bound" << endl;
-    return vector<Block>();
+    return false;
   }
   int i;
-  if ((i=block_index+num_blocks-1)>=tracks[schema_index].size()) {
+  if ((i=block_index+num_blocks-1)>=getTrackSize(schema_index)) {
     cerr << "getBlocks ERROR: num of blocks out of disk bound: " << i << endl;
-    return vector<Block>();
+    return false;
   }
-  incrementDiskIOs(num_blocks);
-  incrementDiskTimer(num_blocks);
+  int num_pages=getNumOfTransferredPages(schema_index,block_index,num_blocks);
+  chargeTrack(schema_index,block_index,num_blocks,num_pages,false);
 
-  vector<Block> v(tracks[schema_index].begin()+block_index,
-                  tracks[schema_index].begin()+block_index+num_blocks);
-  return v;
+  for (i=0;i<num_blocks;i++) {
+    readBlock(schema_index,block_index+i,t,dictionary,fields,blocks[i]);
+  }
+  return true;
 }
 
-bool Disk::setBlock(int schema_index, int block_index, const Block& b) {
+bool Disk::setBlock(int schema_index, int block_index, const Block& b, Dictionary* dictionary) {
+  lock_guard<recursive_mutex> lock(access_mutex);
   if (block_index<0)  {
     cerr << "setBlock ERROR: block index " << block_index << " out of disk bound" << endl;
     return false;
   }
-  incrementDiskIOs(1);
-  incrementDiskTimer(1);
-  tracks[schema_index][block_index]=b;
+  chargeTrack(schema_index,block_index,1,1,true);
+  writeBlock(schema_index,block_index,b,dictionary);
+  updateBlockStats(schema_index,block_index);
+  if (wal.isOpen()) wal.logPage(schema_index,block_index,getPage(schema_index,block_index));
   return true;
 }
 
-bool Disk::setBlocks(int schema_index, int block_index, const vector<Block>& vb) {
+bool Disk::setBlocks(int schema_index, int block_index, const Block* blocks, int num_blocks,
+                     Dictionary* dictionary) {
+  lock_guard<recursive_mutex> lock(access_mutex);
   if (block_index<0)  {
     cerr << "setBlocks ERROR: block index " << block_index << " out of disk bound" << endl;
     return false;
   }
-  incrementDiskIOs(vb.size());
-  incrementDiskTimer(vb.size());
-  copy< vector<Block>::const_iterator, vector<Block>::iterator >
-    (vb.begin(),vb.end(),tracks[schema_index].begin()+block_index);
+  for (int i=0;i<num_blocks;i++) {
+    writeBlock(schema_index,block_index+i,blocks[i],dictionary);
+    updateBlockStats(schema_index,block_index+i);
+    if (wal.isOpen()) wal.logPage(schema_index,block_index+i,getPage(schema_index,block_index+i));
+  }
+  // charged once the compressed sizes are known
+  int num_pages=getNumOfTransferredPages(schema_index,block_index,num_blocks);
+  chargeTrack(schema_index,block_index,num_blocks,num_pages,true);
   return true;
 }
 
@@ -135,33 +883,258 @@ void Disk::incrementDiskIOs(int count) {
   diskIOs+=count;
 }
 
-void Disk::incrementDiskTimer(int num_blocks) {
-  if (SIMULATED_DISK_LATENCY_ON==1) {
+void Disk::chargeTrack(int schema_index, int block_index, int num_blocks, int num_pages, bool write) {
+  Track& track=getTrack(schema_index);
+  if (write) {
+    diskWrites+=num_pages;
+    track.writes+=num_pages;
+  } else {
+    diskReads+=num_pages;
+    track.reads+=num_pages;
+  }
+  double start=timer;
+  incrementDiskIOs(num_pages);
+  incrementDiskTimer(accessDevices(schema_index,block_index,num_blocks,num_pages));
+  track.timer+=timer-start;
+}
+
+double Disk::accessDevices(int schema_index, int block_index, int num_blocks, int num_pages) {
+  int num_devices=devices.size();
+  double elapse=0;
+  for (int d=0;d<num_devices;d++) {
+    // the blocks of the access on device d, and the pages transferred for them,
+    // the pages being dealt out like the blocks
+    int first=block_index+(d-block_index%num_devices+num_devices)%num_devices;
+    int device_blocks=first<block_index+num_blocks?(block_index+num_blocks-1-first)/num_devices+1:0;
+    int first_page=(d-block_index%num_devices+num_devices)%num_devices;
+    int device_pages=first_page<num_pages?(num_pages-1-first_page)/num_devices+1:0;
+    if (device_blocks==0 && device_pages==0) continue;
+    Device& device=devices[d];
+    int device_block=first/num_devices;
+    double positioning_time=profile.seek_time+profile.rotation_latency;
+    if (seek_model==HEAD_POSITION_SEEK && schema_index==device.head_track) {
+      positioning_time=device_block==device.head_block?0:profile.rotation_latency;
+    }
+    device.head_track=schema_index;
+    device.head_block=device_block+device_blocks;
+    int num_transfers=(device_pages+profile.queue_depth-1)/profile.queue_depth;
+    double device_time=positioning_time+profile.transfer_time_per_block*num_transfers;
+    device.ios+=device_pages;
+    device.timer+=device_time;
+    elapse=max(elapse,device_time);
+  }
+  head_track=schema_index;
+  head_block=block_index+num_blocks;
+  return elapse;
+}
+
+unsigned long int Disk::getTrackReads(int schema_index) {
+  return getTrack(schema_index).reads;
+}
+
+unsigned long int Disk::getTrackWrites(int schema_index) {
+  return getTrack(schema_index).writes;
+}
+
+double Disk::getTrackTimer(int schema_index) {
+  return getTrack(schema_index).timer;
+}
+
+void Disk::incrementDiskTimer(double elapse) {
+  if (latency_mode==SPIN_LATENCY) {
     clock_t start_time;
     start_time=clock();
-    clock_t delay=(clock_t)(avg_seek_time+avg_rotation_latency+avg_transfer_time_per_block*num_blocks)
-                  *CLOCKS_PER_SEC/1000;
+    clock_t delay=(clock_t)(elapse)*CLOCKS_PER_SEC/1000;
     while (clock()-start_time < delay){
     ;
     }
+  } else if (latency_mode==SLEEP_LATENCY) {
+    this_thread::sleep_for(chrono::duration<double,milli>(elapse*latency_scale));
   }
 
-  timer+=avg_seek_time+avg_rotation_latency+avg_transfer_time_per_block*num_blocks;
+  timer+=elapse;
+}
+
+void Disk::commit() {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  wal.commit();
+  if (wal.getLogSize()>WAL_CHECKPOINT_BYTES) checkpoint();
+}
+
+void Disk::checkpoint() {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (!isPersistent()) return;
+  // the log is synced before the track files change, so that a crash meanwhile replays it
+  wal.flush();
+  for (set<int>::iterator it=removed_tracks.begin();it!=removed_tracks.end();it++)
+    unlink(trackPath(directory,*it).c_str());
+  removed_tracks.clear();
+  for (int i=0;i<tracks.size();i++) {
+    if (!writeTrackFile(i)) return; // the log is kept
+  }
+  // the new track files replace the old ones for good before the log is emptied
+  syncDirectory(directory);
+  wal.truncate();
+}
+
+void Disk::setAsyncCommitDelay(double milliseconds) {
+  wal.setAsyncCommitDelay(milliseconds);
+}
+
+double Disk::getAsyncCommitDelay() const {
+  return wal.getAsyncCommitDelay();
+}
+
+unsigned long int Disk::getNumOfLogSyncs() const {
+  return wal.getNumOfSyncs();
+}
+
+void Disk::setLatencyMode(enum DISK_LATENCY_MODE mode) {
+  latency_mode=mode;
+}
+
+enum DISK_LATENCY_MODE Disk::getLatencyMode() const {
+  return latency_mode;
+}
+
+void Disk::setLatencyScale(double scale) {
+  if (scale<0) {
+    cerr << "setLatencyScale ERROR: scale " << scale << " is negative" << endl;
+    return;
+  }
+  latency_scale=scale;
+}
+
+double Disk::getLatencyScale() const {
+  return latency_scale;
+}
+
+bool Disk::setProfile(const DiskProfile& profile) {
+  if (profile.seek_time<0 || profile.rotation_latency<0 || profile.transfer_time_per_block<0
+      || profile.queue_depth<1) {
+    cerr << "setProfile ERROR: bad disk profile " << profile.name << endl;
+    return false;
+  }
+  lock_guard<recursive_mutex> lock(access_mutex);
+  this->profile=profile;
+  return true;
+}
+
+const DiskProfile& Disk::getProfile() const {
+  return profile;
+}
+
+DiskProfile Disk::getHDDProfile() {
+  DiskProfile hdd={"hdd",avg_seek_time,avg_rotation_latency,avg_transfer_time_per_block,1};
+  return hdd;
+}
+
+// A 16K block takes 0.0328 ms at 500 MB/s, and 0.0055 ms at 3 GB/s. Every time of the
+// drive is scaled by 320, so that reaching a block keeps its cost against a transfer
+DiskProfile Disk::getSataSSDProfile() {
+  DiskProfile ssd={"sata-ssd",0.1*320,0,0.0328*320,4};
+  return ssd;
+}
+
+DiskProfile Disk::getNVMeProfile() {
+  DiskProfile nvme={"nvme",0.02*320,0,0.0055*320,16};
+  return nvme;
+}
+
+double Disk::estimateAccessTime(int num_blocks) const {
+  // the busiest device of the stripe takes ceil(num_blocks/N) of the blocks
+  int num_devices=devices.size();
+  int device_blocks=(num_blocks+num_devices-1)/num_devices;
+  int num_transfers=(device_blocks+profile.queue_depth-1)/profile.queue_depth;
+  return profile.seek_time+profile.rotation_latency+profile.transfer_time_per_block*num_transfers;
+}
+
+bool Disk::setNumOfDevices(int num_devices) {
+  if (num_devices<1) {
+    cerr << "setNumOfDevices ERROR: " << num_devices << " devices" << endl;
+    return false;
+  }
+  lock_guard<recursive_mutex> lock(access_mutex);
+  devices.assign(num_devices,Device());
+  return true;
+}
+
+int Disk::getNumOfDevices() const {
+  return devices.size();
+}
+
+unsigned long int Disk::getDeviceIOs(int device) const {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (device<0 || device>=devices.size()) {
+    cerr << "getDeviceIOs ERROR: device " << device << " out of bound" << endl;
+    return 0;
+  }
+  return devices[device].ios;
+}
+
+double Disk::getDeviceTimer(int device) const {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  if (device<0 || device>=devices.size()) {
+    cerr << "getDeviceTimer ERROR: device " << device << " out of bound" << endl;
+    return 0;
+  }
+  return devices[device].timer;
+}
+
+void Disk::setSeekModel(enum DISK_SEEK_MODEL model) {
+  seek_model=model;
+}
+
+enum DISK_SEEK_MODEL Disk::getSeekModel() const {
+  return seek_model;
+}
+
+int Disk::getHeadTrack() const {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  return head_track;
+}
+
+int Disk::getHeadBlock() const {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  return head_block;
 }
 
 void Disk::resetDiskIOs() {
+  lock_guard<recursive_mutex> lock(access_mutex);
   diskIOs=0;
+  diskReads=0;
+  diskWrites=0;
+  for (int i=0;i<tracks.size();i++) {
+    tracks[i].reads=0;
+    tracks[i].writes=0;
+  }
+  for (int i=0;i<devices.size();i++) devices[i].ios=0;
 }
 
 unsigned long int Disk::getDiskIOs() const {
+  lock_guard<recursive_mutex> lock(access_mutex);
   return diskIOs;
 }
 
+unsigned long int Disk::getDiskReads() const {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  return diskReads;
+}
+
+unsigned long int Disk::getDiskWrites() const {
+  lock_guard<recursive_mutex> lock(access_mutex);
+  return diskWrites;
+}
+
 void Disk::resetDiskTimer() {
+  lock_guard<recursive_mutex> lock(access_mutex);
   timer=0;
+  for (int i=0;i<tracks.size();i++) tracks[i].timer=0;
+  for (int i=0;i<devices.size();i++) devices[i].timer=0;
 }
 
 double Disk::getDiskTimer() const {
+  lock_guard<recursive_mutex> lock(access_mutex);
   return timer;
 }
     
@@ -287,7 +1260,7 @@ int Schema::getNumOfFields() const {
 }
 
 int Schema::getTuplesPerBlock() const {
-  return FIELDS_PER_BLOCK/field_names.size();
+  return Config::getFieldsPerBlock()/field_names.size();
 }
 
 void Schema::printSchema() const {
@@ -323,12 +1296,11 @@ ostream &operator<<(ostream &out, const Schema &s) {
 Tuple::Tuple(SchemaManager* schema_manager, int schema_index){
   this->schema_manager=schema_manager;
   this->schema_index=schema_index;
+  this->schema_id=-1;
+  this->num_fields=0;
   if (this->schema_manager!=NULL) {
-    Schema& schema=schema_manager->schemas[schema_index];
-    int numberOfFields=schema.getNumOfFields();
-    for (int i=0;i<numberOfFields;i++) {
-      fields.push_back(Field());
-    }
+    schema_id=schema_manager->schema_ids[schema_index];
+    num_fields=schema_manager->schemas[schema_id].getNumOfFields();
   }
 }
 
@@ -337,29 +1309,43 @@ Tuple Tuple::getDummyTuple() {
 }
 
 bool Tuple::isNull() const {
-  return fields.size()==0;
+  return num_fields==0;
+}
+
+const Schema& Tuple::getSchema() const {
+  return schema_manager->schemas[schema_id];
 }
 
-Schema Tuple::getSchema() const {
-  return schema_manager->schemas[schema_index];
+bool Tuple::hasSameSchema(const Tuple& t) const {
+  if (schema_manager==t.schema_manager) return schema_id==t.schema_id;
+  return getSchema()==t.getSchema();
 }
 
 int Tuple::getNumOfFields() const {
-  Schema& schema=schema_manager->schemas[schema_index];
+  const Schema& schema=schema_manager->schemas[schema_id];
   return schema.getNumOfFields();
 }
 
 int Tuple::getTuplesPerBlock() const {
-  Schema& schema=schema_manager->schemas[schema_index];
+  const Schema& schema=schema_manager->schemas[schema_id];
   return schema.getTuplesPerBlock();
 }
 
 void Tuple::null() {
-  fields.clear();
+  num_fields=0;
 }
 
 bool Tuple::setField(int offset,string s){
-  Schema& schema=schema_manager->schemas[schema_index];
+  Str20 str;
+  if (!str.assign(s)) {
+    cerr<<"setField ERROR: string "<<s<<" is longer than "<<STR20_LENGTH<<" characters!"<<endl;
+    return false;
+  }
+  return setField(offset,str);
+}
+
+bool Tuple::setField(int offset,const Str20& s){
+  const Schema& schema=schema_manager->schemas[schema_id];
   if (offset>=schema.getNumOfFields() || offset<0){
     cerr<<"setField ERROR: offset "<<offset<<" is out of bound!"<<endl;
     return false;
@@ -367,13 +1353,24 @@ bool Tuple::setField(int offset,string s){
     cerr<<"setField ERROR: field type not STR20!"<<endl;
     return false;
   } else {
-    fields[offset].str=new string(s);
+    setStr20(offset,s);
   }
   return true;
 }
 
+// A value keeps its code only in a dictionary-encoded relation,
+// so that the values of one relation either all have codes or none has
+void Tuple::setStr20(int offset,const Str20& s){
+  fields[offset].str=s;
+  if (!schema_manager->dictionary_encoded[schema_index]) {
+    fields[offset].str.code=0;
+  } else if (s.code==0) {
+    fields[offset].str.code=schema_manager->dictionary.encode(s);
+  }
+}
+
 bool Tuple::setField(int offset,int i){
-  Schema& schema=schema_manager->schemas[schema_index];
+  const Schema& schema=schema_manager->schemas[schema_id];
   if (offset>=schema.getNumOfFields() || offset<0){
     cerr<<"setField ERROR: offset "<<offset<<" is out of bound!"<<endl;
     return false;
@@ -387,7 +1384,16 @@ bool Tuple::setField(int offset,int i){
 }
 
 bool Tuple::setField(string field_name,string s){
-  Schema& schema=schema_manager->schemas[schema_index];
+  Str20 str;
+  if (!str.assign(s)) {
+    cerr<<"setField ERROR: string "<<s<<" is longer than "<<STR20_LENGTH<<" characters!"<<endl;
+    return false;
+  }
+  return setField(field_name,str);
+}
+
+bool Tuple::setField(string field_name,const Str20& s){
+  const Schema& schema=schema_manager->schemas[schema_id];
   if (!schema.fieldNameExists(field_name)) {
     cerr<<"setField ERROR: field name " << field_name << " not found"<<endl;
     return false;
@@ -397,13 +1403,13 @@ bool Tuple::setField(string field_name,string s){
     cerr<<"setField ERROR: field type not STR20!"<<endl;
     return false;
   } else {
-    fields[offset].str=new string(s);
+    setStr20(offset,s);
   }
   return true;
 }
 
 bool Tuple::setField(string field_name,int i){
-  Schema& schema=schema_manager->schemas[schema_index];
+  const Schema& schema=schema_manager->schemas[schema_id];
   if (!schema.fieldNameExists(field_name)) {
     cerr<<"setField ERROR: field name " << field_name << " not found"<<endl;
     return false;
@@ -419,7 +1425,7 @@ bool Tuple::setField(string field_name,int i){
 }
 
 union Field Tuple::getField(int offset) const{
-  if(offset<fields.size() && offset>=0){
+  if(offset<num_fields && offset>=0){
     return fields[offset];
   } else {
     cerr<<"getField ERROR: offset "<<offset<<" is out of bound!"<<endl;
@@ -428,9 +1434,9 @@ union Field Tuple::getField(int offset) const{
 }
 
 union Field Tuple::getField(string field_name) const{
-  Schema& schema=schema_manager->schemas[schema_index];
+  const Schema& schema=schema_manager->schemas[schema_id];
   int offset=schema.getFieldOffset(field_name);
-  if(offset<fields.size() && offset>=0){
+  if(offset<num_fields && offset>=0){
     return fields[offset];
   } else {
     cerr<<"getField ERROR: offset "<<offset<<" is out of bound!"<<endl;
@@ -452,16 +1458,16 @@ void Tuple::printTuple(bool print_field_names) const {
 }
 
 void Tuple::printTuple(bool print_field_names, ostream &out) const {
-  Schema& schema=schema_manager->schemas[schema_index];
+  const Schema& schema=schema_manager->schemas[schema_id];
   if (print_field_names) {
     schema.printFieldNames(out);
     out << endl;
   }
-  for (int i=0;i<fields.size();i++) {
+  for (int i=0;i<num_fields;i++) {
     if (schema.getFieldType(i)==INT)
       out << fields[i].integer << "\t";
     else
-      out << *(fields[i].str) << "\t";
+      out.write(fields[i].str.chars,fields[i].str.length) << "\t";
   }
 }
 
@@ -515,21 +1521,28 @@ vector<Tuple> Block::getTuples() const {
   return tuples;
 }
 
+Block::const_iterator Block::begin() const {
+  return tuples.begin();
+}
+
+Block::const_iterator Block::end() const {
+  return tuples.end();
+}
+
 bool Block::setTuple(int tuple_offset, const Tuple& tuple) { // sets new tuple value at tuple_index; returns false if tuple_index out of bound
-  Schema s = tuple.getSchema();
   if (!tuples.empty()) {
     if (tuple_offset>=tuples.front().getTuplesPerBlock()) {
       cerr << "setTuple ERROR: tuple offet " << tuple_offset << " out of bound of the block" << endl;
       return false;
     }
     for (int i=0;i<tuples.size();i++) {
-      if (s!=tuples[i].getSchema()) {
+      if (!tuple.hasSameSchema(tuples[i])) {
         cerr << "setTuple ERROR: tuples' schemas do not match" << endl;
         return false;
       }
     }
   }
-  if (tuple_offset<0 || tuple_offset>=s.getTuplesPerBlock()) {
+  if (tuple_offset<0 || tuple_offset>=tuple.getTuplesPerBlock()) {
     cerr << "setTuple ERROR: tuple offet " << tuple_offset << " out of bound" << endl;
     return false;
   }
@@ -647,33 +1660,99 @@ string Relation::getRelationName() const {
   return relation_name;
 }
 
-Schema Relation::getSchema() const {
-  return schema_manager->schemas[schema_index];
+const Schema& Relation::getSchema() const {
+  return schema_manager->schemas[schema_manager->schema_ids[schema_index]];
 }
 
 //NOTE: Because the operation should not have disk latency,
 //      it is implemented in Relation instead of in Disk
 int Relation::getNumOfBlocks() const {
-  vector<Block>& data=disk->tracks[schema_index];
-  return data.size();
+  return disk->getTrackSize(schema_index);
+}
+
+int Relation::getTrackIndex() const {
+  return schema_index;
 }
 
 // returns actual number of tuples in the relation
 //NOTE: Because the operation should not have disk latency,
 //      it is implemented in Relation instead of in Disk
 int Relation::getNumOfTuples() const {
-  vector<Block>& data=disk->tracks[schema_index];
-  int total_tuples=0;
-  for (vector<Block>::const_iterator vit=data.begin();vit!=data.end();vit++) {
-    total_tuples+=vit->getNumTuples();
+  return disk->getNumOfTuples(schema_index);
+}
+
+int Relation::getNumOfHoles() const {
+  return disk->getNumOfSlots(schema_index)-disk->getNumOfTuples(schema_index);
+}
+
+int Relation::getFirstBlockWithHoles() const {
+  return disk->getFirstBlockWithHoles(schema_index);
+}
+
+int Relation::getNumOfTuples(int relation_block_index) const {
+  if (relation_block_index<0 || relation_block_index>=getNumOfBlocks()) {
+    cerr << "getNumOfTuples ERROR: block index " << relation_block_index << " out of bound" << endl;
+    return -1;
   }
-  return total_tuples;
+  return disk->getNumOfTuples(schema_index,relation_block_index);
+}
+
+int Relation::getNumOfSlots(int relation_block_index) const {
+  if (relation_block_index<0 || relation_block_index>=getNumOfBlocks()) {
+    cerr << "getNumOfSlots ERROR: block index " << relation_block_index << " out of bound" << endl;
+    return -1;
+  }
+  return disk->getNumOfSlots(schema_index,relation_block_index);
+}
+
+unsigned long Relation::getBlockVersion(int relation_block_index) const {
+  if (relation_block_index<0 || relation_block_index>=getNumOfBlocks()) {
+    cerr << "getBlockVersion ERROR: block index " << relation_block_index << " out of bound" << endl;
+    return 0;
+  }
+  return disk->getBlockVersion(schema_index,relation_block_index);
+}
+
+unsigned long int Relation::getDiskReads() const {
+  return disk->getTrackReads(schema_index);
+}
+
+unsigned long int Relation::getDiskWrites() const {
+  return disk->getTrackWrites(schema_index);
+}
+
+double Relation::getDiskTimer() const {
+  return disk->getTrackTimer(schema_index);
 }
 
 bool Relation::isNull() const {
   return (schema_manager==NULL || schema_index==-1 || mem==NULL);
 }
 
+enum BLOCK_LAYOUT Relation::getBlockLayout() const {
+  return disk->getTrackLayout(schema_index);
+}
+
+Dictionary* Relation::getDictionary() const {
+  if (!schema_manager->dictionary_encoded[schema_index]) return NULL;
+  return &schema_manager->dictionary;
+}
+
+bool Relation::isDictionaryEncoded() const {
+  return schema_manager->dictionary_encoded[schema_index];
+}
+
+int Relation::getDictionaryCode(string s) const {
+  Str20 str;
+  if (!isDictionaryEncoded() || !str.assign(s)) return 0;
+  return schema_manager->dictionary.getCode(str);
+}
+
+bool Relation::hasSchemaOf(const Tuple& t) const {
+  if (t.schema_manager==schema_manager) return t.schema_id==schema_manager->schema_ids[schema_index];
+  return t.getSchema()==getSchema();
+}
+
 Tuple Relation::createTuple() const {
   return Tuple(schema_manager,schema_index);
 }
@@ -681,7 +1760,7 @@ Tuple Relation::createTuple() const {
 bool Relation::getBlock(int relation_block_index, int memory_block_index) const {
   //delay();
   //DIOs++;
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_index<0 || memory_block_index>=mem->getMemorySize()) {
     cerr << "getBlock ERROR: block index " << memory_block_index << " out of bound in memory" << endl;
     return false;
   }
@@ -692,12 +1771,23 @@ bool Relation::getBlock(int relation_block_index, int memory_block_index) const
   }
   */
   //mem->setBlock(memory_block_index,data[relation_block_index]);
-  Block b = disk->getBlock(schema_index,relation_block_index);
-  if (!b.isEmpty()) {
-    mem->setBlock(memory_block_index,b);
-    return true;
+  // decoded straight into the memory block; an empty disk block leaves it unchanged
+  return disk->getBlock(schema_index,relation_block_index,createTuple(),getDictionary(),NULL,
+                        mem->blocks[memory_block_index]);
+}
+
+bool Relation::getBlock(int relation_block_index, int memory_block_index, const vector<bool>& fields) const {
+  if (memory_block_index<0 || memory_block_index>=mem->getMemorySize()) {
+    cerr << "getBlock ERROR: block index " << memory_block_index << " out of bound in memory" << endl;
+    return false;
   }
-  return false;
+  if (fields.size()!=getSchema().getNumOfFields()) {
+    cerr << "getBlock ERROR: " << fields.size() << " field flags for "
+         << getSchema().getNumOfFields() << " fields" << endl;
+    return false;
+  }
+  return disk->getBlock(schema_index,relation_block_index,createTuple(),getDictionary(),&fields,
+                        mem->blocks[memory_block_index]);
 }
 
 bool Relation::getBlocks(int relation_block_index, int memory_block_index, int num_blocks) const {
@@ -707,12 +1797,12 @@ bool Relation::getBlocks(int relation_block_index, int memory_block_index, int n
     cerr << "getBlocks ERROR: num of blocks " << num_blocks << " too few" << endl;
     return false;
   }
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_index<0 || memory_block_index>=mem->getMemorySize()) {
     cerr << "getBlocks ERROR: block index " << memory_block_index << " out of bound in memory" << endl;
     return false;
   }
   int i;
-  if ((i=memory_block_index+num_blocks-1)>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if ((i=memory_block_index+num_blocks-1)>=mem->getMemorySize()) {
     cerr << "getBlocks ERROR: access to block out of memory bound" << i << endl;
     return false;
   }
@@ -728,15 +1818,34 @@ bool Relation::getBlocks(int relation_block_index, int memory_block_index, int n
   mem->setBlock(memory_block_index,data.begin()+relation_block_index,
                 data.begin()+relation_block_index+num_blocks);
   */
-  vector<Block> v=disk->getBlocks(schema_index,relation_block_index,num_blocks);
-  mem->setBlock(memory_block_index,v.begin(),v.end());
-  return true;  
+  // decoded straight into the memory blocks
+  return disk->getBlocks(schema_index,relation_block_index,num_blocks,createTuple(),getDictionary(),
+                         NULL,&mem->blocks[memory_block_index]);
+}
+
+bool Relation::getBlocks(int relation_block_index, int memory_block_index, int num_blocks,
+                         const vector<bool>& fields) const {
+  if (num_blocks<=0) {
+    cerr << "getBlocks ERROR: num of blocks " << num_blocks << " too few" << endl;
+    return false;
+  }
+  if (memory_block_index<0 || memory_block_index+num_blocks-1>=mem->getMemorySize()) {
+    cerr << "getBlocks ERROR: access to block out of memory bound " << memory_block_index << endl;
+    return false;
+  }
+  if (fields.size()!=getSchema().getNumOfFields()) {
+    cerr << "getBlocks ERROR: " << fields.size() << " field flags for "
+         << getSchema().getNumOfFields() << " fields" << endl;
+    return false;
+  }
+  return disk->getBlocks(schema_index,relation_block_index,num_blocks,createTuple(),getDictionary(),
+                         &fields,&mem->blocks[memory_block_index]);
 }
 
 bool Relation::setBlock(int relation_block_index, int memory_block_index) {
   //delay();
   //DIOs++;
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_index<0 || memory_block_index>=mem->getMemorySize()) {
     cerr << "setBlock ERROR: block index" << memory_block_index << " out of bound in memory" << endl;
     return false;
   }
@@ -745,10 +1854,9 @@ bool Relation::setBlock(int relation_block_index, int memory_block_index) {
     return false;
   }
   // check if the schema is correct
-  vector<Tuple> v = mem->getBlock(memory_block_index)->getTuples();
-  Schema s = getSchema();
+  const vector<Tuple>& v = mem->blocks[memory_block_index].tuples;
   for (int i=0;i<v.size();i++) {
-    if (v[i].getSchema() != s) {
+    if (!hasSchemaOf(v[i])) {
       cerr << "setBlock ERROR: The tuple at offest " << i << " of memory block "
            << memory_block_index << " has a different schema." << endl;
       return false;
@@ -758,10 +1866,12 @@ bool Relation::setBlock(int relation_block_index, int memory_block_index) {
   //data[relation_block_index]=*(mem->getBlock(memory_block_index));
 
   Tuple t(schema_manager,schema_index);
-  t.null(); //invalidates the tuple
   if (disk->extendTrack(schema_index,relation_block_index+1,t)) {
     //Actual writing on disk
-    return disk->setBlock(schema_index,relation_block_index,*(mem->getBlock(memory_block_index)));
+    if (!disk->setBlock(schema_index,relation_block_index,mem->blocks[memory_block_index],getDictionary()))
+      return false;
+    if (disk->isPersistent() && isDictionaryEncoded()) schema_manager->saveDictionary();
+    return true;
   }
   return false;
 }
@@ -773,12 +1883,12 @@ bool Relation::setBlocks(int relation_block_index, int memory_block_index, int n
     cerr << "setBlocks ERROR: num of blocks " << num_blocks << " too few" << endl;
     return false;
   }
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_index<0 || memory_block_index>=mem->getMemorySize()) {
     cerr << "setBlocks ERROR: block index " << memory_block_index << " out of bound in memory" << endl;
     return false;
   }
   int i;
-  if ((i=memory_block_index+num_blocks-1)>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if ((i=memory_block_index+num_blocks-1)>=mem->getMemorySize()) {
     cerr << "setBlocks ERROR: access to block out of memory bound: " << i << endl;
     return false;
   }
@@ -787,29 +1897,30 @@ bool Relation::setBlocks(int relation_block_index, int memory_block_index, int n
     return false;
   }
 
-  vector<Block> vb;
-  Schema s = getSchema();
   int j,k;
   //for (i=relation_block_index,j=memory_block_index;i<relation_block_index+num_blocks;i++,j++) {
   for (j=memory_block_index;j<memory_block_index+num_blocks;j++) {
     // check if the schema is correct
-    vector<Tuple> v = mem->getBlock(j)->getTuples();
+    const vector<Tuple>& v = mem->blocks[j].tuples;
     for (k=0;k<v.size();k++) {
-      if (v[k].getSchema() != s) {
+      if (!hasSchemaOf(v[k])) {
         cerr << "setBlocks ERROR: The tuple at offest " << k << " of memory block "
         << j << " has a different schema." << endl;
         return false;
       }
     }
     //data[i]=*(mem->getBlock(j));
-    vb.push_back(*(mem->getBlock(j)));
   }
 
   Tuple t(schema_manager,schema_index);
-  t.null(); //invalidates the tuple
   if (disk->extendTrack(schema_index,relation_block_index+num_blocks,t)) {
     //Actual writing on disk
-    return disk->setBlocks(schema_index,relation_block_index,vb);
+    // written straight from the memory blocks
+    if (!disk->setBlocks(schema_index,relation_block_index,&mem->blocks[memory_block_index],num_blocks,
+                         getDictionary()))
+      return false;
+    if (disk->isPersistent() && isDictionaryEncoded()) schema_manager->saveDictionary();
+    return true;
   }
   return false;
 }
@@ -827,16 +1938,18 @@ void Relation::printRelation() const {
 //NOTE: Because the operation should not have disk latency,
 //      it is implemented in Relation instead of in Disk
 void Relation::printRelation(ostream &out) const {
-  vector<Block>& data=disk->tracks[schema_index];
-  int i=0;
+  lock_guard<recursive_mutex> lock(disk->access_mutex); // the pages are read without Disk
+  int num_blocks=disk->getTrackSize(schema_index);
+  Tuple t=createTuple();
+  Block b=Block::getDummyBlock();
   out << "******RELATION DUMP BEGIN******" << endl;
-  schema_manager->schemas[schema_index].printFieldNames(out);
+  getSchema().printFieldNames(out);
   out << endl;
-  for (vector<Block>::const_iterator vit=data.begin();vit!=data.end();vit++) {
+  for (int i=0;i<num_blocks;i++) {
     out << i << ": ";
-    vit->printBlock(out);
+    disk->readBlock(schema_index,i,t,getDictionary(),NULL,b);
+    b.printBlock(out);
     out << endl;
-    i++;
   }
   out << "******RELATION DUMP END******";
 }
@@ -846,40 +1959,32 @@ ostream &operator<<(ostream &out, const Relation &r) {
   return out;
 }
 
-MainMemory::MainMemory() { }
+MainMemory::MainMemory() {
+  blocks.assign(Config::getNumOfBlocksInMemory(),Block::getDummyBlock());
+}
 
-bool MainMemory::setBlock(int memory_block_index, const vector<Block>::const_iterator first,
-              const vector<Block>::const_iterator last) {
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
-    cerr << "setBlock ERROR: block index " << memory_block_index << " out of memory bound" << endl;
-    return false;
+MainMemory::MainMemory(int num_of_blocks) {
+  if (num_of_blocks<=0) {
+    cerr << "MainMemory ERROR: " << num_of_blocks << " blocks are too few" << endl;
+    num_of_blocks=Config::getNumOfBlocksInMemory();
   }
-  int i=memory_block_index;
-  for (vector<Block>::const_iterator it=first;it!=last;it++) {
-    if (i>=NUM_OF_BLOCKS_IN_MEMORY) {
-      cerr << "setBlock ERROR: number of blocks reaches memory boundary" << endl;
-      return false;
-    }
-    blocks[i] = *it;
-    i++;
-  }
-  return true;
+  blocks.assign(num_of_blocks,Block::getDummyBlock());
 }
-              
+
 int MainMemory::getMemorySize() const { //returns max number of blocks
-  return NUM_OF_BLOCKS_IN_MEMORY;
+  return blocks.size();
 }
 
 Block* MainMemory::getBlock(int memory_block_index) {
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_index<0 || memory_block_index>=getMemorySize()) {
     cerr << "getBlock ERROR: block index " << memory_block_index << " out of memory bound" << endl;
     return NULL;
   }
-  return blocks+memory_block_index;
+  return &blocks[memory_block_index];
 }
 
 bool MainMemory::setBlock(int memory_block_index, const Block& b) {
-  if (memory_block_index<0 || memory_block_index>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_index<0 || memory_block_index>=getMemorySize()) {
     cerr << "setBlock ERROR: block index " << memory_block_index << " out of memory bound" << endl;
     return false;
   }  
@@ -888,7 +1993,7 @@ bool MainMemory::setBlock(int memory_block_index, const Block& b) {
 }
 
 vector<Tuple> MainMemory::getTuples(int memory_block_begin,int num_blocks) const { //gets tuples from a range of blocks
-  if (memory_block_begin<0 || memory_block_begin>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_begin<0 || memory_block_begin>=getMemorySize()) {
     cerr << "getTuples ERROR: block index " << memory_block_begin << " out of memory bound" << endl;
     return vector<Tuple>();
   }
@@ -897,15 +2002,15 @@ vector<Tuple> MainMemory::getTuples(int memory_block_begin,int num_blocks) const
     return vector<Tuple>();     
   }
   int i;
-  if ((i=memory_block_begin+num_blocks-1)>=NUM_OF_BLOCKS_IN_MEMORY ) {
+  if ((i=memory_block_begin+num_blocks-1)>=getMemorySize() ) {
     cerr << "getTuples ERROR: access to block out of memory bound: " << i << endl;
     return vector<Tuple>();    
   }
   vector<Tuple> tuples;
-  Schema s = blocks[memory_block_begin].getTuples()[0].getSchema();
+  const Tuple& first=blocks[memory_block_begin].tuples[0];
   for (int i=memory_block_begin;i<memory_block_begin+num_blocks;i++) {
-    vector<Tuple> tuples2=blocks[i].getTuples();
-    if (tuples2[0].getSchema() != s) {
+    const vector<Tuple>& tuples2=blocks[i].tuples;
+    if (!tuples2[0].hasSameSchema(first)) {
       cerr << "getTuples ERROR: schema at memory block " << i << " has a different schema" << endl;
       return vector<Tuple>();
     }
@@ -920,7 +2025,7 @@ vector<Tuple> MainMemory::getTuples(int memory_block_begin,int num_blocks) const
 //writes tuples consecutively starting from a particular memory block;
 //returns false if out of bound in memory
 bool MainMemory::setTuples(int memory_block_begin,const vector<Tuple>& tuples) {
-  if (memory_block_begin<0 || memory_block_begin>=NUM_OF_BLOCKS_IN_MEMORY) {
+  if (memory_block_begin<0 || memory_block_begin>=getMemorySize()) {
     cerr << "setTuples ERROR: block index " << memory_block_begin << " out of memory bound" << endl;
     return false;
   }
@@ -928,7 +2033,7 @@ bool MainMemory::setTuples(int memory_block_begin,const vector<Tuple>& tuples) {
   int num_blocks=tuples.size()/tuples_per_block;
   int num_additional_blocks=(tuples.size()%tuples_per_block>0?1:0);
   if (memory_block_begin + num_blocks + num_additional_blocks >
-       NUM_OF_BLOCKS_IN_MEMORY) {
+       getMemorySize()) {
     cerr << "setTuples ERROR: number of tuples exceed the memory space" << endl;
     return false;
   }
@@ -954,7 +2059,7 @@ void MainMemory::dumpMemory() const {
 
 void MainMemory::dumpMemory(ostream &out) const {
   out << "******MEMORY DUMP BEGIN******" << endl;
-  for (int i=0;i<NUM_OF_BLOCKS_IN_MEMORY;i++) {
+  for (int i=0;i<getMemorySize();i++) {
     out << i << ": ";
     blocks[i].printBlock(out);
     out << endl;
@@ -970,16 +2075,435 @@ ostream &operator<<(ostream &out, const MainMemory &m) {
 SchemaManager::SchemaManager(MainMemory* mem, Disk* disk) {
   this->mem=mem;
   this->disk=disk;
-  offset=0;
+  num_saved_dictionary_values=0;
+  if (disk->isPersistent()) {
+    loadCatalog();
+    loadDictionary();
+    dropTemporaryRelations();
+  }
+}
+
+int SchemaManager::allocateIndex() {
+  if (!free_indexes.empty()) {
+    int index=free_indexes.back();
+    free_indexes.pop_back();
+    return index;
+  }
+  relations.push_back(Relation());
+  schema_ids.push_back(-1);
+  dictionary_encoded.push_back(false);
+  temporary.push_back(false);
+  return relations.size()-1;
+}
+
+string SchemaManager::getSchemaKey(const Schema& schema) {
+  string key;
+  for (int i=0;i<schema.field_names.size();i++) {
+    key+=schema.field_types[i]==INT?'I':'S';
+    key+=schema.field_names[i];
+    key+='\0';
+  }
+  return key;
+}
+
+int SchemaManager::internSchema(const Schema& schema) {
+  string key=getSchemaKey(schema);
+  unordered_map<string,int>::iterator it=schema_id_of_key.find(key);
+  if (it!=schema_id_of_key.end()) {
+    schema_ref_counts[it->second]++;
+    return it->second;
+  }
+  int schema_id;
+  if (!free_schema_ids.empty()) {
+    schema_id=free_schema_ids.back();
+    free_schema_ids.pop_back();
+    schemas[schema_id]=schema;
+  } else {
+    schema_id=schemas.size();
+    schemas.push_back(schema);
+    schema_ref_counts.push_back(0);
+  }
+  schema_ref_counts[schema_id]=1;
+  schema_id_of_key[key]=schema_id;
+  return schema_id;
+}
+
+void SchemaManager::releaseSchema(int schema_id) {
+  if (--schema_ref_counts[schema_id]>0) return;
+  schema_id_of_key.erase(getSchemaKey(schemas[schema_id]));
+  schemas[schema_id].clear();
+  free_schema_ids.push_back(schema_id);
+}
+
+void SchemaManager::loadCatalog() {
+  ifstream in((disk->getDirectory()+"/catalog").c_str());
+  readCatalog(in);
+}
+
+// The catalog is synced, renamed and its directory synced before the statement that
+// changed it commits, so that a committed statement never refers to a relation a crash lost
+void SchemaManager::saveCatalog() const {
+  string path=disk->getDirectory()+"/catalog";
+  string temp_path=path+".tmp";
+  ostringstream entries;
+  writeCatalog(entries);
+  string text=entries.str();
+  int fd=open(temp_path.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+  bool written=fd!=-1 && write(fd,text.data(),text.size())==(ssize_t)text.size() && fsync(fd)==0;
+  if (fd!=-1) close(fd);
+  if (!written || rename(temp_path.c_str(),path.c_str())!=0) {
+    cerr << "saveCatalog ERROR: cannot write " << path << endl;
+    return;
+  }
+  syncDirectory(disk->getDirectory());
+}
+
+static const int MAX_CATALOG_INDEX=1<<20; // a larger relation index is taken for corruption
+
+// Each line of the catalog is:
+//   relation_index relation_name num_of_fields (field_name field_type)* [DICTIONARY] [PAX|COMPRESSED]
+//   [TEMPORARY]
+// A bad line is reported and skipped
+bool SchemaManager::readCatalog(istream& in) {
+  bool ok=true;
+  string line;
+  while (getline(in,line)) {
+    istringstream fields(line);
+    int index, num_fields;
+    string relation_name;
+    vector<string> field_names;
+    vector<enum FIELD_TYPE> field_types;
+    bool good=(fields >> index >> relation_name >> num_fields) && index>=0 && index<=MAX_CATALOG_INDEX
+              && num_fields>0 && num_fields<=MAX_NUM_OF_FIELDS_IN_RELATION
+              && relation_name_to_index.find(relation_name)==relation_name_to_index.end()
+              && (index>=relations.size() || relations[index].isNull());
+    for (int i=0;good && i<num_fields;i++) {
+      string field_name, field_type;
+      good=(fields >> field_name >> field_type) && (field_type=="INT" || field_type=="STR20");
+      field_names.push_back(field_name);
+      field_types.push_back(field_type=="INT"?INT:STR20);
+    }
+    bool encoded=false;
+    bool is_temporary=false;
+    enum BLOCK_LAYOUT layout=ROW_LAYOUT;
+    string flag;
+    while (good && fields >> flag) {
+      if (flag=="DICTIONARY") encoded=true;
+      else if (flag=="TEMPORARY") is_temporary=true;
+      else if (flag=="PAX") layout=PAX_LAYOUT;
+      else if (flag=="COMPRESSED") layout=COMPRESSED_LAYOUT;
+      else good=false;
+    }
+    Schema schema;
+    if (good) {
+      schema=Schema(field_names,field_types);
+      good=!schema.isEmpty();
+    }
+    if (!good) {
+      cerr << "loadCatalog ERROR: bad catalog entry: " << line << endl;
+      ok=false;
+      continue;
+    }
+    while (relations.size()<=index) {
+      relations.push_back(Relation());
+      schema_ids.push_back(-1);
+      dictionary_encoded.push_back(false);
+      temporary.push_back(false);
+    }
+    relation_name_to_index[relation_name]=index;
+    relations[index]=Relation(this,index,relation_name,mem,disk);
+    schema_ids[index]=internSchema(schema);
+    dictionary_encoded[index]=encoded;
+    temporary[index]=is_temporary;
+    disk->setTrackLayout(index,layout);
+  }
+  // the slots left free by deleted relations are reused, lowest index first
+  free_indexes.clear();
+  for (int i=relations.size()-1;i>=0;i--) {
+    if (relations[i].isNull()) free_indexes.push_back(i);
+  }
+  return ok;
+}
+
+void SchemaManager::writeCatalog(ostream& out) const {
+  for (map<string,int>::const_iterator it=relation_name_to_index.begin();
+       it!=relation_name_to_index.end();it++) {
+    const Schema& schema=schemas[schema_ids[it->second]];
+    out << it->second << " " << it->first << " " << schema.getNumOfFields();
+    for (int i=0;i<schema.getNumOfFields();i++) {
+      out << " " << schema.getFieldName(i) << " " << (schema.getFieldType(i)==INT?"INT":"STR20");
+    }
+    if (dictionary_encoded[it->second]) out << " DICTIONARY";
+    if (disk->getTrackLayout(it->second)==PAX_LAYOUT) out << " PAX";
+    if (disk->getTrackLayout(it->second)==COMPRESSED_LAYOUT) out << " COMPRESSED";
+    if (temporary[it->second]) out << " TEMPORARY";
+    out << endl;
+  }
+}
+
+// The temporary relations are in the catalog only so that their blocks can be found
+// and dropped here; the drop is committed at once
+void SchemaManager::dropTemporaryRelations() {
+  vector<string> names;
+  for (map<string,int>::const_iterator it=relation_name_to_index.begin();
+       it!=relation_name_to_index.end();it++) {
+    if (temporary[it->second]) names.push_back(it->first);
+  }
+  if (names.empty()) return;
+  for (int i=0;i<names.size();i++) deleteRelation(names[i]);
+  disk->commit();
+}
+
+void SchemaManager::loadDictionary() {
+  ifstream in((disk->getDirectory()+"/dictionary").c_str());
+  readDictionary(in);
+  num_saved_dictionary_values=dictionary.size();
+}
+
+void SchemaManager::saveDictionary() {
+  if (num_saved_dictionary_values==dictionary.size()) return;
+  string path=disk->getDirectory()+"/dictionary";
+  ostringstream values;
+  writeDictionary(values,num_saved_dictionary_values+1);
+  string text=values.str();
+  // synced before the statement commits: the pages it logged hold the new codes
+  int fd=open(path.c_str(),O_WRONLY|O_CREAT|O_APPEND,0644);
+  bool written=fd!=-1 && write(fd,text.data(),text.size())==(ssize_t)text.size() && fsync(fd)==0;
+  if (fd!=-1) close(fd);
+  if (!written) {
+    cerr << "saveDictionary ERROR: cannot write " << path << endl;
+    return;
+  }
+  num_saved_dictionary_values=dictionary.size();
+}
+
+// Each line of the dictionary is: length characters
+// The values are in the order of their codes, and are only appended
+bool SchemaManager::readDictionary(istream& in) {
+  int length;
+  while (in >> length) {
+    if (length<0 || length>STR20_LENGTH || in.get()!=' ') return false;
+    string value(length,' ');
+    if (!in.read(&value[0],length)) return false;
+    Str20 str;
+    str.assign(value);
+    // a value read twice would shift the codes of the values after it
+    if (dictionary.encode(str)!=dictionary.size()) return false;
+  }
+  return in.eof();
+}
+
+void SchemaManager::writeDictionary(ostream& out, int first_code) const {
+  for (int code=first_code;code<=dictionary.size();code++) {
+    Str20 value=dictionary.decode(code);
+    out << (int)value.length << " ";
+    out.write(value.chars,value.length) << endl;
+  }
+}
+
+// An image file holds, in order:
+//   an ImageHeader, and an ImageTrack for every relation
+//   the catalog and the dictionary, in the formats of their files
+//   the block counts of every track (refer to Disk::saveTrackImage())
+//   the pages of every track, starting at a multiple of IMAGE_ALIGNMENT so that they can be mapped
+static const char IMAGE_MAGIC[8]={'T','I','N','Y','S','Q','L','1'};
+static const off_t IMAGE_ALIGNMENT=4096;
+
+struct ImageHeader {
+  char magic[8];
+  int fields_per_block;
+  int page_size;
+  int num_tracks;
+  int catalog_size;
+  int dictionary_size;
+};
+
+struct ImageTrack {
+  int schema_index;
+  int num_blocks;
+  long long counts_offset;
+  long long pages_offset;
+};
+
+bool SchemaManager::saveImage(string path) {
+  ostringstream catalog_text, dictionary_text;
+  writeCatalog(catalog_text);
+  writeDictionary(dictionary_text,1);
+  string catalog=catalog_text.str();
+  string dictionary_values=dictionary_text.str();
+
+  ImageHeader header;
+  memcpy(header.magic,IMAGE_MAGIC,sizeof(header.magic));
+  header.fields_per_block=disk->fields_per_block;
+  header.page_size=disk->getPageSize();
+  header.num_tracks=relation_name_to_index.size();
+  header.catalog_size=catalog.size();
+  header.dictionary_size=dictionary_values.size();
+  vector<ImageTrack> tracks;
+  for (map<string,int>::const_iterator it=relation_name_to_index.begin();
+       it!=relation_name_to_index.end();it++) {
+    ImageTrack track;
+    track.schema_index=it->second;
+    track.num_blocks=disk->getTrackSize(it->second);
+    tracks.push_back(track);
+  }
+  off_t offset=sizeof(header)+tracks.size()*sizeof(ImageTrack)+catalog.size()+dictionary_values.size();
+  for (int i=0;i<tracks.size();i++) {
+    tracks[i].counts_offset=offset;
+    offset+=3*tracks[i].num_blocks*sizeof(int);
+  }
+  for (int i=0;i<tracks.size();i++) {
+    offset=(offset+IMAGE_ALIGNMENT-1)/IMAGE_ALIGNMENT*IMAGE_ALIGNMENT;
+    tracks[i].pages_offset=offset;
+    offset+=(off_t)tracks[i].num_blocks*header.page_size;
+  }
+
+  string text=catalog+dictionary_values;
+  string temp_path=path+".tmp";
+  int fd=open(temp_path.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+  if (fd==-1) {
+    cerr << "saveImage ERROR: cannot create " << temp_path << endl;
+    return false;
+  }
+  size_t tracks_size=tracks.size()*sizeof(ImageTrack);
+  bool ok=pwrite(fd,&header,sizeof(header),0)==sizeof(header)
+          && (tracks.empty() || pwrite(fd,&tracks[0],tracks_size,sizeof(header))==(ssize_t)tracks_size)
+          && pwrite(fd,text.data(),text.size(),sizeof(header)+tracks_size)==(ssize_t)text.size();
+  for (int i=0;ok && i<tracks.size();i++) {
+    ok=disk->saveTrackImage(tracks[i].schema_index,fd,tracks[i].counts_offset,tracks[i].pages_offset);
+  }
+  ok=ok && ftruncate(fd,offset)==0 && fsync(fd)==0;
+  close(fd);
+  if (!ok || rename(temp_path.c_str(),path.c_str())!=0) {
+    cerr << "saveImage ERROR: cannot write " << path << endl;
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Returns true if the block counts of the track in the image are possible
+static bool checkImageCounts(int fd, const ImageTrack& track, int tuples_per_block, int page_size) {
+  if (track.num_blocks==0) return true;
+  vector<int> counts((size_t)3*track.num_blocks);
+  size_t counts_size=counts.size()*sizeof(int);
+  if (pread(fd,&counts[0],counts_size,track.counts_offset)!=(ssize_t)counts_size) return false;
+  for (int i=0;i<track.num_blocks;i++) {
+    int slots=counts[i], tuples=counts[track.num_blocks+i], bytes=counts[2*track.num_blocks+i];
+    if (slots<0 || slots>tuples_per_block || tuples<0 || tuples>slots || bytes<0 || bytes>page_size)
+      return false;
+  }
+  return true;
 }
 
-Schema SchemaManager::getSchema(string relation_name) const {
+bool SchemaManager::loadImage(string path) {
+  int fd=open(path.c_str(),O_RDONLY);
+  if (fd==-1) {
+    cerr << "loadImage ERROR: cannot open " << path << endl;
+    return false;
+  }
+  struct stat st;
+  ImageHeader header;
+  if (fstat(fd,&st)!=0 || pread(fd,&header,sizeof(header),0)!=sizeof(header)
+      || memcmp(header.magic,IMAGE_MAGIC,sizeof(header.magic))!=0
+      || header.num_tracks<0 || header.catalog_size<0 || header.dictionary_size<0) {
+    cerr << "loadImage ERROR: " << path << " is not an image" << endl;
+    close(fd);
+    return false;
+  }
+  if (header.fields_per_block!=disk->fields_per_block || header.page_size!=disk->getPageSize()) {
+    cerr << "loadImage ERROR: " << path << " holds blocks of " << header.fields_per_block
+         << " fields, not " << disk->fields_per_block << endl;
+    close(fd);
+    return false;
+  }
+  // every part of the image must lie within the file; the sizes are checked in 64 bits
+  // before anything is allocated
+  long long tracks_size=(long long)header.num_tracks*sizeof(ImageTrack);
+  long long text_size=(long long)header.catalog_size+header.dictionary_size;
+  bool ok=(long long)sizeof(header)+tracks_size+text_size<=st.st_size;
+  vector<ImageTrack> tracks;
+  string text;
+  if (ok) {
+    tracks.resize(header.num_tracks);
+    text.assign(text_size,' ');
+    ok=(tracks.empty() || pread(fd,&tracks[0],tracks_size,sizeof(header))==(ssize_t)tracks_size)
+       && (text.empty() || pread(fd,&text[0],text.size(),sizeof(header)+tracks_size)==(ssize_t)text.size());
+  }
+  for (int i=0;ok && i<tracks.size();i++) {
+    ok=tracks[i].schema_index>=0 && tracks[i].num_blocks>=0
+       && tracks[i].counts_offset>=0 && tracks[i].counts_offset<=st.st_size
+       && 3LL*tracks[i].num_blocks*sizeof(int)<=st.st_size-tracks[i].counts_offset
+       && tracks[i].pages_offset>=0 && tracks[i].pages_offset<=st.st_size
+       && (long long)tracks[i].num_blocks*header.page_size<=st.st_size-tracks[i].pages_offset;
+  }
+  // the catalog and the dictionary are read into a scratch schema manager first, and every
+  // track must belong to one of its relations, with block counts that fit a block
+  Disk scratch_disk;
+  SchemaManager scratch(mem,&scratch_disk);
+  istringstream catalog(ok ? text.substr(0,header.catalog_size) : "");
+  istringstream dictionary_values(ok ? text.substr(header.catalog_size) : "");
+  ok=ok && scratch.readCatalog(catalog) && scratch.readDictionary(dictionary_values)
+     && scratch.relation_name_to_index.size()==tracks.size();
+  set<int> track_indexes;
+  for (int i=0;ok && i<tracks.size();i++) {
+    int index=tracks[i].schema_index;
+    ok=index<scratch.relations.size() && !scratch.relations[index].isNull()
+       && track_indexes.insert(index).second
+       && checkImageCounts(fd,tracks[i],scratch.schemas[scratch.schema_ids[index]].getTuplesPerBlock(),
+                           header.page_size);
+  }
+  if (!ok) {
+    cerr << "loadImage ERROR: " << path << " is truncated or corrupted" << endl;
+    close(fd);
+    return false;
+  }
+
+  // drop the current relations, then restore the catalog, the dictionary and the tracks
+  for (map<string,int>::iterator it=relation_name_to_index.begin();
+       it!=relation_name_to_index.end();it++)
+    disk->clearTrack(it->second);
+  relation_name_to_index.clear();
+  relations.clear();
+  schema_ids.clear();
+  dictionary_encoded.clear();
+  free_indexes.clear();
+  schemas.clear();
+  schema_ref_counts.clear();
+  free_schema_ids.clear();
+  schema_id_of_key.clear();
+  dictionary=Dictionary();
+  catalog.clear();
+  catalog.seekg(0);
+  readCatalog(catalog);
+  dictionary_values.clear();
+  dictionary_values.seekg(0);
+  readDictionary(dictionary_values);
+  for (int i=0;i<tracks.size();i++) {
+    ok=disk->loadTrackImage(tracks[i].schema_index,fd,tracks[i].counts_offset,
+                            tracks[i].pages_offset,tracks[i].num_blocks) && ok;
+  }
+  close(fd); // the mappings of the tracks stay valid
+
+  // the new catalog is written before the checkpoint removes the old track files
+  if (disk->isPersistent()) {
+    saveCatalog();
+    ofstream((disk->getDirectory()+"/dictionary").c_str(),ios::trunc).close();
+    num_saved_dictionary_values=0;
+    saveDictionary();
+    disk->checkpoint();
+  }
+  return ok;
+}
+
+const Schema& SchemaManager::getSchema(string relation_name) const {
+  static const Schema empty_schema;
   map<string,int>::const_iterator it=relation_name_to_index.find(relation_name);
   if (it==relation_name_to_index.end()) {
     cerr << "getSchema ERROR: relation " << relation_name << " does not exist" << endl;
-    return Schema();
+    return empty_schema;
   } else {
-    return schemas[it->second];
+    return schemas[schema_ids[it->second]];
   }
 }
 
@@ -990,7 +2514,28 @@ bool SchemaManager::relationExists(string relation_name) const {
   return true;
 }
 
+void SchemaManager::getRelationNames(vector<string>& names) const {
+  names.clear();
+  for (map<string,int>::const_iterator it=relation_name_to_index.begin();
+       it!=relation_name_to_index.end();it++)
+    names.push_back(it->first);
+}
+
 Relation* SchemaManager::createRelation(string relation_name,const Schema& schema){
+  return createRelation(relation_name,schema,false);
+}
+
+Relation* SchemaManager::createRelation(string relation_name,const Schema& schema,bool dictionary_encoded){
+  return createRelation(relation_name,schema,dictionary_encoded,ROW_LAYOUT);
+}
+
+Relation* SchemaManager::createRelation(string relation_name,const Schema& schema,bool dictionary_encoded,
+                                        enum BLOCK_LAYOUT layout){
+  return createRelation(relation_name,schema,dictionary_encoded,layout,false);
+}
+
+Relation* SchemaManager::createRelation(string relation_name,const Schema& schema,bool dictionary_encoded,
+                                        enum BLOCK_LAYOUT layout,bool temporary){
   if (relation_name=="") {
     cerr << "createRelation ERROR: empty relation name" << endl;
     return NULL;
@@ -1004,15 +2549,18 @@ Relation* SchemaManager::createRelation(string relation_name,const Schema& schem
     cerr << "createRelation ERROR: empty schema" << endl;
     return NULL;
   }
-  if (offset==MAX_NUM_CREATING_RELATIONS) {
-    cerr << "createRelation ERROR: no more relations can be created." << endl;
-    return NULL;
-  }
-  relation_name_to_index[relation_name]=offset;
-  relations[offset]=Relation(this,offset,relation_name,mem,disk);
-  schemas[offset]=schema;
-  offset++; // increase the boundary
-  return &relations[offset-1];
+  int index=allocateIndex();
+  // the blocks of a deleted relation whose removal a crash kept from committing are
+  // still on its track
+  if (disk->isPersistent() && disk->getTrackSize(index)>0) disk->clearTrack(index);
+  relation_name_to_index[relation_name]=index;
+  relations[index]=Relation(this,index,relation_name,mem,disk);
+  schema_ids[index]=internSchema(schema);
+  this->dictionary_encoded[index]=dictionary_encoded;
+  this->temporary[index]=temporary;
+  disk->setTrackLayout(index,layout);
+  if (disk->isPersistent()) saveCatalog();
+  return &relations[index];
 }
 
 Relation* SchemaManager::getRelation(string relation_name) {
@@ -1031,10 +2579,16 @@ bool SchemaManager::deleteRelation(string relation_name) {
     cerr << "deleteRelation ERROR: relation " << relation_name << " does not exist" << endl;
     return false;
   }
-  int offset=it->second;
-  relations[offset].null();
-  schemas[offset].clear();
+  int index=it->second;
+  relations[index].null();
+  releaseSchema(schema_ids[index]);
+  schema_ids[index]=-1;
+  dictionary_encoded[index]=false;
+  temporary[index]=false;
+  disk->clearTrack(index);
   relation_name_to_index.erase(it);
+  free_indexes.push_back(index);
+  if (disk->isPersistent()) saveCatalog();
   return true;
 }
 
@@ -1043,22 +2597,21 @@ void SchemaManager::printSchemas() const {
 }
 
 void SchemaManager::printSchemas(ostream &out) const {
-  if (offset>0) {
-    map<string,int>::const_iterator it;
+  if (!relations.empty()) {
     int i;
     
-    for (i=0;i<offset;i++) {
+    for (i=0;i<relations.size();i++) {
       if (!relations[i].isNull()) {
         out << relations[i].getRelationName() << endl;
-        schemas[i].printSchema(out);
+        relations[i].getSchema().printSchema(out);
         break;
       }
     }
-    for (i++;i<offset;i++) {
+    for (i++;i<relations.size();i++) {
       if (!relations[i].isNull()) {
         out << endl;
         out << relations[i].getRelationName() << endl;
-        schemas[i].printSchema(out);
+        relations[i].getSchema().printSchema(out);
       }
     }
   }
@@ -1068,3 +2621,298 @@ ostream &operator<<(ostream &out, const SchemaManager &sm) {
   sm.printSchemas(out);
   return out;
 }
+
+size_t Dictionary::Str20Hash::operator()(const Str20& s) const {
+  size_t hash=2166136261u; // FNV-1a
+  for (int i=0;i<s.length;i++) {
+    hash^=(unsigned char)s.chars[i];
+    hash*=16777619u;
+  }
+  return hash;
+}
+
+bool Dictionary::Str20Equal::operator()(const Str20& s1, const Str20& s2) const {
+  return s1.length==s2.length && memcmp(s1.chars,s2.chars,s1.length)==0;
+}
+
+int Dictionary::encode(const Str20& s) {
+  unordered_map<Str20,int,Str20Hash,Str20Equal>::iterator it=codes.find(s);
+  if (it!=codes.end()) return it->second;
+  if (values.size()>=MAX_DICTIONARY_CODE) {
+    cerr << "encode ERROR: the dictionary is full" << endl;
+    return 0;
+  }
+  int code=values.size()+1;
+  values.push_back(s);
+  values.back().code=code;
+  codes[values.back()]=code;
+  return code;
+}
+
+int Dictionary::getCode(const Str20& s) const {
+  unordered_map<Str20,int,Str20Hash,Str20Equal>::const_iterator it=codes.find(s);
+  if (it==codes.end()) return 0;
+  return it->second;
+}
+
+Str20 Dictionary::decode(int code) const {
+  if (code<1 || code>values.size()) {
+    cerr << "decode ERROR: unknown dictionary code " << code << endl;
+    Str20 empty=Str20();
+    return empty;
+  }
+  return values[code-1];
+}
+
+int Dictionary::size() const {
+  return values.size();
+}
+
+// The records of the write-ahead log: a header, followed by a page image for WAL_PAGE
+enum WAL_RECORD_TYPE { WAL_PAGE=1, WAL_TRUNCATE=2, WAL_REMOVE=3, WAL_COMMIT=4 };
+
+struct WalRecordHeader {
+  int type;
+  int schema_index;
+  int block_index; // the number of blocks left for WAL_TRUNCATE
+  unsigned int checksum; // of the other fields and the page image
+};
+
+static unsigned int walChecksum(const WalRecordHeader& header, const char* page, int page_size) {
+  unsigned int hash=2166136261u; // FNV-1a
+  const char* fields=(const char*)&header;
+  for (int i=0;i<(int)(3*sizeof(int));i++) hash=(hash^(unsigned char)fields[i])*16777619u;
+  for (int i=0;i<page_size;i++) hash=(hash^(unsigned char)page[i])*16777619u;
+  return hash;
+}
+
+// Applies the committed records of the log onto the track files, and syncs them
+static void replayLog(const string& directory, const string& log, int page_size) {
+  // the records after the last commit, or after a torn record, are left out
+  size_t end=0;
+  size_t pos=0;
+  while (pos+sizeof(WalRecordHeader)<=log.size()) {
+    WalRecordHeader header;
+    memcpy(&header,log.data()+pos,sizeof(header));
+    int length=header.type==WAL_PAGE?page_size:0;
+    if (header.type<WAL_PAGE || header.type>WAL_COMMIT || pos+sizeof(header)+length>log.size()) break;
+    if (walChecksum(header,log.data()+pos+sizeof(header),length)!=header.checksum) break;
+    pos+=sizeof(header)+length;
+    if (header.type==WAL_COMMIT) end=pos;
+  }
+
+  // the pages of the tracks the log changes, read from their files when first changed
+  map<int,vector<string> > tracks;
+  set<int> removed; // the tracks whose file is removed, unless they are written again
+  for (pos=0;pos<end;) {
+    WalRecordHeader header;
+    memcpy(&header,log.data()+pos,sizeof(header));
+    const char* page=log.data()+pos+sizeof(header);
+    pos+=sizeof(header)+(header.type==WAL_PAGE?page_size:0);
+    if (header.type==WAL_COMMIT) continue;
+    string path=trackPath(directory,header.schema_index);
+    map<int,vector<string> >::iterator track=tracks.find(header.schema_index);
+    bool first_change=track==tracks.end();
+    if (first_change) track=tracks.insert(make_pair(header.schema_index,vector<string>())).first;
+    vector<string>& pages=track->second;
+    if (header.type==WAL_REMOVE) {
+      unlink(path.c_str());
+      pages.clear();
+      removed.insert(header.schema_index);
+      continue;
+    }
+    removed.erase(header.schema_index);
+    if (first_change) {
+      ifstream in(path.c_str(),ios::binary);
+      string blocks((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+      vector<size_t> offsets;
+      if (!findPackedBlocks(blocks.data(),blocks.size(),page_size,offsets)) {
+        cerr << "WriteAheadLog ERROR: " << path << " is corrupted" << endl;
+        offsets.clear();
+      }
+      for (int i=0;i<offsets.size();i++) {
+        int length;
+        memcpy(&length,blocks.data()+offsets[i],sizeof(int));
+        pages.push_back(blocks.substr(offsets[i]+sizeof(int),length));
+        pages.back().resize(page_size,0);
+      }
+    }
+    if (header.type==WAL_PAGE) {
+      if (header.block_index>=pages.size()) pages.resize(header.block_index+1,string(page_size,0));
+      pages[header.block_index].assign(page,page_size);
+    } else {
+      pages.resize(header.block_index,string(page_size,0));
+    }
+  }
+  for (map<int,vector<string> >::iterator it=tracks.begin();it!=tracks.end();it++) {
+    if (removed.count(it->first)) continue;
+    string blocks;
+    for (int i=0;i<it->second.size();i++) appendPackedBlock(it->second[i].data(),page_size,blocks);
+    string path=trackPath(directory,it->first);
+    int fd=replaceTrackFile(path,blocks);
+    if (fd==-1) cerr << "WriteAheadLog ERROR: cannot write " << path << endl;
+    else close(fd);
+  }
+  syncDirectory(directory);
+}
+
+WriteAheadLog::WriteAheadLog() : fd(-1), page_size(0), commit_pending(false), file_size(0),
+    async_commit_delay(DEFAULT_ASYNC_COMMIT_DELAY), num_commits(0), num_syncs(0), stopping(false) {}
+
+WriteAheadLog::~WriteAheadLog() {
+  {
+    lock_guard<mutex> lock(log_mutex);
+    stopping=true;
+  }
+  committed.notify_all();
+  if (flusher.joinable()) flusher.join();
+  if (isOpen()) {
+    flush();
+    close(fd);
+  }
+}
+
+bool WriteAheadLog::open(string directory, int page_size) {
+  this->page_size=page_size;
+  string path=directory+"/wal";
+  ifstream in(path.c_str(),ios::binary);
+  if (in) {
+    string log((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+    replayLog(directory,log,page_size);
+  }
+  fd=::open(path.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_APPEND,0644);
+  if (fd==-1) {
+    cerr << "WriteAheadLog ERROR: cannot open " << path << endl;
+    return false;
+  }
+  fsync(fd);
+  this->directory=directory;
+  return true;
+}
+
+bool WriteAheadLog::isOpen() const {
+  return directory!="";
+}
+
+void WriteAheadLog::append(int type, int schema_index, int block_index, const char* page) {
+  WalRecordHeader header;
+  header.type=type;
+  header.schema_index=schema_index;
+  header.block_index=block_index;
+  int length=type==WAL_PAGE?page_size:0;
+  header.checksum=walChecksum(header,page,length);
+  lock_guard<mutex> lock(log_mutex);
+  buffer.append((const char*)&header,sizeof(header));
+  buffer.append(page,length);
+}
+
+void WriteAheadLog::logPage(int schema_index, int block_index, const char* page) {
+  append(WAL_PAGE,schema_index,block_index,page);
+}
+
+void WriteAheadLog::logTruncate(int schema_index, int num_blocks) {
+  append(WAL_TRUNCATE,schema_index,num_blocks,NULL);
+}
+
+void WriteAheadLog::logRemove(int schema_index) {
+  append(WAL_REMOVE,schema_index,0,NULL);
+}
+
+void WriteAheadLog::commit() {
+  if (!isOpen()) return;
+  append(WAL_COMMIT,0,0,NULL);
+  {
+    lock_guard<mutex> lock(log_mutex);
+    num_commits++;
+    if (async_commit_delay>0) {
+      if (!flusher.joinable()) flusher=thread(&WriteAheadLog::runFlusher,this);
+      // the first commit of a group starts the interval; the others join it
+      if (!commit_pending) committed.notify_all();
+      commit_pending=true;
+      return;
+    }
+  }
+  flush();
+}
+
+void WriteAheadLog::flush() {
+  if (!isOpen()) return;
+  // one flush at a time, so that the buffers are written in order
+  lock_guard<mutex> write_lock(write_mutex);
+  string pending;
+  {
+    lock_guard<mutex> lock(log_mutex);
+    pending.swap(buffer);
+    commit_pending=false;
+  }
+  if (pending.empty()) return;
+  size_t written=0;
+  while (written<pending.size()) {
+    ssize_t n=write(fd,pending.data()+written,pending.size()-written);
+    if (n<=0) {
+      cerr << "WriteAheadLog ERROR: cannot write " << directory << "/wal" << endl;
+      return;
+    }
+    written+=n;
+  }
+  fdatasync(fd);
+  lock_guard<mutex> lock(log_mutex);
+  file_size+=pending.size();
+  num_syncs++;
+}
+
+void WriteAheadLog::runFlusher() {
+  unique_lock<mutex> lock(log_mutex);
+  while (!stopping) {
+    if (!commit_pending) {
+      committed.wait(lock);
+      continue;
+    }
+    // the commits of the next interval join the group
+    chrono::steady_clock::time_point deadline=chrono::steady_clock::now()+
+        chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double,milli>(async_commit_delay));
+    while (!stopping && committed.wait_until(lock,deadline)!=cv_status::timeout) {}
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+
+void WriteAheadLog::truncate() {
+  if (!isOpen()) return;
+  flush();
+  lock_guard<mutex> write_lock(write_mutex);
+  if (ftruncate(fd,0)!=0) {
+    cerr << "WriteAheadLog ERROR: cannot truncate " << directory << "/wal" << endl;
+    return;
+  }
+  fdatasync(fd);
+  lock_guard<mutex> lock(log_mutex);
+  file_size=0;
+}
+
+size_t WriteAheadLog::getLogSize() {
+  lock_guard<mutex> lock(log_mutex);
+  return file_size+buffer.size();
+}
+
+void WriteAheadLog::setAsyncCommitDelay(double milliseconds) {
+  if (milliseconds<0) {
+    cerr << "setAsyncCommitDelay ERROR: delay " << milliseconds << " is negative" << endl;
+    return;
+  }
+  lock_guard<mutex> lock(log_mutex);
+  async_commit_delay=milliseconds;
+}
+
+double WriteAheadLog::getAsyncCommitDelay() const {
+  return async_commit_delay;
+}
+
+unsigned long int WriteAheadLog::getNumOfCommits() const {
+  return num_commits;
+}
+
+unsigned long int WriteAheadLog::getNumOfSyncs() const {
+  return num_syncs;
+}
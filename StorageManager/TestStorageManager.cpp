@@ -238,15 +238,15 @@ int main(){
     if (tuple_schema.getFieldType(i)==INT)
       cout << tuple.getField(i).integer << "\t";
     else
-      cout << *(tuple.getField(i).str) << "\t";
+      cout << tuple.getField(i).str.toString() << "\t";
   }
   cout << endl;
 
   cout << "The tuple has fields: " << endl;
-  cout << *(tuple.getField("f1").str) << "\t";
+  cout << tuple.getField("f1").str.toString() << "\t";
   cout << tuple.getField("f2").integer << "\t";
   cout << tuple.getField("f3").integer << "\t";
-  cout << *(tuple.getField("f4").str) << "\t";
+  cout << tuple.getField("f4").str.toString() << "\t";
   cout << endl << endl;
 
   //Error testing
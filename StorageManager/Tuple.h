@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "Config.h"
 #include "Field.h"
 #include "Schema.h"
 
@@ -14,6 +15,7 @@ class SchemaManager;
  * A tuple contains at most MAX_NUM_OF_FIELDS_IN_RELATION=8 fields. 
  * Each field in a tuple has offset 0,1,2,... respectively, according to the defined schema. 
  * You can access a field by its offset or its field name.
+ * The fields are stored inline, STR20 values included, so copying a tuple allocates nothing.
  * Usage: Most of cases you access the tuples in main memory,
  *          either through the MainMemory class,
  *          or through both the MainMemory and the Block class.
@@ -25,25 +27,37 @@ class SchemaManager;
 class Tuple {
   private:
   SchemaManager* schema_manager;
-  int schema_index; // points to the schema of the relation which the tuple belongs to
-  vector<union Field> fields;  // stores integer and string fields
+  int schema_index; // points to the relation which the tuple belongs to
+  int schema_id; // the interned schema of the relation: tuples of equal schemas have equal ids
+  int num_fields; // 0 for an invalid tuple
+  union Field fields[MAX_NUM_OF_FIELDS_IN_RELATION];  // stores integer and string fields
   // DO NOT use the constructor here. Create an empty tuple only through Schema
   Tuple(SchemaManager* schema_manager, int schema_index);
   static Tuple getDummyTuple(); // for internal use: returns an invalid tuple
+  // for internal use: sets the dictionary code if the relation is dictionary-encoded
+  void setStr20(int offset,const Str20& s);
 
   public:
   friend class Relation; // creates a tuple
   friend class Block; // clears the tuple
+  friend class Disk; // decodes and encodes the fields in place
 
   bool isNull() const; //returns true if the tuple is invalid
-  Schema getSchema() const; // returns the schema of the tuple
+  const Schema& getSchema() const; // returns the schema of the tuple without copying it
+  // returns true if both tuples have equal schemas; compares the interned schema ids,
+  // not the field names and types, if the tuples come from the same schema manager
+  bool hasSameSchema(const Tuple& t) const;
   int getNumOfFields() const; // returns the number of fields in the tuple
   int getTuplesPerBlock() const; // returns the number: tuples per block
 
   void null(); // invalidates the tuple
-  bool setField(int offset,string s); // returns false if the type is wrong or out of bound
+  // returns false if the type is wrong, out of bound, or s is longer than STR20_LENGTH
+  bool setField(int offset,string s);
+  bool setField(int offset,const Str20& s); // returns false if the type is wrong or out of bound
   bool setField(int offset,int i); // returns false if the type is wrong or out of bound
-  bool setField(string field_name, string s); // returns false if the type is wrong or the name is not found
+  // returns false if the type is wrong, the name is not found, or s is longer than STR20_LENGTH
+  bool setField(string field_name, string s);
+  bool setField(string field_name, const Str20& s); // returns false if the type is wrong or the name is not found
   bool setField(string field_name, int i); // returns false if the type is wrong or the name is not found
   union Field getField(int offset) const; // returns INT_MIN if out of bound
   union Field getField(string field_name) const; // returns INT_MIN if the name is not found
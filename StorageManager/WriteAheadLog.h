@@ -0,0 +1,81 @@
+#ifndef _WRITE_AHEAD_LOG_H
+#define _WRITE_AHEAD_LOG_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+#define WAL_CHECKPOINT_BYTES (4*1024*1024) // the log size that triggers a checkpoint
+#define DEFAULT_ASYNC_COMMIT_DELAY 0 // milliseconds: every commit syncs the log
+
+/* The write-ahead log of a disk backed by a directory, kept in "<directory>/wal".
+ * Every block written is logged as an image of its page, and every track that shrinks
+ * or is removed as a truncation record; a commit record ends the changes of a statement.
+ * The records are buffered in memory, and a commit writes and syncs them before it
+ * returns, so that a statement is durable once committed.
+ * Asynchronous commit: with a delay above 0, a commit returns at once instead, and a
+ * flusher thread writes and syncs the log getAsyncCommitDelay() milliseconds later,
+ * together with the commits that follow. A crash then loses the statements committed
+ * within the last delay, but never part of a statement.
+ * A checkpoint writes the pages to the track files, syncs them and empties the log
+ * (refer to Disk::checkpoint()); the track files change at no other time, so the log
+ * only needs to redo the statements committed since.
+ * Recovery: when the disk is opened, the committed records of the log are replayed
+ *   onto the track files in order, and the log is emptied. A torn record at the end of
+ *   the log ends the replay, and so do the records after the last commit.
+ * Usage: The disk keeps the log; you don't need to access it directly.
+ *        Call Disk::commit() at the end of every statement.
+ */
+class WriteAheadLog {
+  private:
+    string directory; // empty if the log is closed
+    int fd;
+    int page_size;
+    string buffer; // records not written yet
+    bool commit_pending; // the buffer ends with a commit not synced yet
+    size_t file_size; // bytes written to the log since the last checkpoint
+    double async_commit_delay;
+    unsigned long int num_commits;
+    unsigned long int num_syncs;
+    mutex log_mutex; // guards the buffer and the counters
+    mutex write_mutex; // held by a flush, so that the buffers are written in order
+    condition_variable committed;
+    thread flusher;
+    bool stopping;
+
+    WriteAheadLog(const WriteAheadLog&);
+    WriteAheadLog& operator=(const WriteAheadLog&);
+
+    // for internal use: appends a record to the buffer
+    void append(int type, int schema_index, int block_index, const char* page);
+    // for internal use: the flusher thread syncs the commits of every interval together
+    void runFlusher();
+
+  public:
+    WriteAheadLog();
+    ~WriteAheadLog(); // flushes the buffer
+
+    // Replays the committed records of "<directory>/wal" onto the track files of the
+    // directory, then opens the log empty. Returns false if the log cannot be opened
+    bool open(string directory, int page_size);
+    bool isOpen() const;
+
+    void logPage(int schema_index, int block_index, const char* page);
+    void logTruncate(int schema_index, int num_blocks); // the track keeps num_blocks blocks
+    void logRemove(int schema_index); // the track file is removed
+    void commit();
+    void flush(); // writes and syncs the buffer now
+    // Flushes the buffer and empties the log; the changes it holds must be synced already
+    void truncate();
+    size_t getLogSize(); // returns the bytes of the log, written or not
+
+    void setAsyncCommitDelay(double milliseconds);
+    double getAsyncCommitDelay() const;
+    unsigned long int getNumOfCommits() const;
+    unsigned long int getNumOfSyncs() const; // returns the number of times the log was synced
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef __ARENA_INCLUDED
+#define __ARENA_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for the objects that live as long as one query: parse tree
+// nodes, heap elements of the two-pass algorithms, etc.
+// Objects are carved out of large chunks and are never freed one by one;
+// reset() runs the pending destructors and rewinds the chunks for reuse.
+class Arena {
+private:
+  static const size_t CHUNK_SIZE = 64 * 1024;
+
+  struct Destructor {
+    void (*destroy)(void*);
+    void* object;
+  };
+
+  std::vector<char*> chunks; // kept across resets
+  std::vector<char*> large_allocations; // objects bigger than a chunk; freed on reset
+  std::vector<Destructor> destructors; // in creation order
+  size_t next_chunk;
+  char* cursor;
+  char* limit;
+
+  Arena(const Arena&);
+  Arena& operator=(const Arena&);
+
+  template <class T>
+  static void destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+public:
+  Arena() : next_chunk(0), cursor(nullptr), limit(nullptr) {}
+
+  ~Arena() {
+    reset();
+    for (int i = 0; i < chunks.size(); ++i) {
+      delete[] chunks[i];
+    }
+  }
+
+  void* allocate(size_t size, size_t alignment) {
+    if (size > CHUNK_SIZE) {
+      // operator new[] aligns for any fundamental type
+      char* p = new char[size];
+      large_allocations.push_back(p);
+      return p;
+    }
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+    if (cursor == nullptr || padding + size > (size_t)(limit - cursor)) {
+      if (next_chunk == chunks.size()) {
+        chunks.push_back(new char[CHUNK_SIZE]);
+      }
+      cursor = chunks[next_chunk++];
+      limit = cursor + CHUNK_SIZE;
+      padding = 0;
+    }
+    void* p = cursor + padding;
+    cursor += padding + size;
+    return p;
+  }
+
+  // Constructs a T in the arena; it is destroyed by the next reset()
+  template <class T, class... Args>
+  T* create(Args&&... args) {
+    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      Destructor d = { &destroy<T>, object };
+      destructors.push_back(d);
+    }
+    return object;
+  }
+
+  // Destroys every object created since the last reset, newest first
+  void reset() {
+    for (int i = (int)destructors.size() - 1; i >= 0; --i) {
+      destructors[i].destroy(destructors[i].object);
+    }
+    destructors.clear();
+    for (int i = 0; i < large_allocations.size(); ++i) {
+      delete[] large_allocations[i];
+    }
+    large_allocations.clear();
+    next_chunk = 0;
+    cursor = nullptr;
+    limit = nullptr;
+  }
+
+  // Number of chunks the arena holds; stays constant once queries stop growing
+  int getNumOfChunks() const {
+    return chunks.size();
+  }
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "arena.cc"
+
+struct Counted {
+  static int alive;
+  std::string name;
+
+  Counted(const std::string& n) : name(n) {
+    ++alive;
+  }
+
+  ~Counted() {
+    --alive;
+  }
+};
+
+int Counted::alive = 0;
+
+TEST(ArenaTest, resetDestroysObjects) {
+  Arena arena;
+  std::vector<Counted*> objects;
+  for (int i = 0; i < 1000; ++i) {
+    objects.push_back(arena.create<Counted>("object " + std::to_string(i)));
+  }
+  EXPECT_EQ(1000, Counted::alive);
+  EXPECT_EQ("object 999", objects[999]->name);
+
+  arena.reset();
+  EXPECT_EQ(0, Counted::alive);
+}
+
+TEST(ArenaTest, alignment) {
+  Arena arena;
+  arena.create<char>('a');
+  double* d = arena.create<double>(1.5);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(d) % alignof(double));
+  EXPECT_EQ(1.5, *d);
+}
+
+TEST(ArenaTest, chunksAreReused) {
+  Arena arena;
+  for (int i = 0; i < 10000; ++i) {
+    arena.create<int>(i);
+  }
+  int num_chunks = arena.getNumOfChunks();
+  for (int round = 0; round < 10; ++round) {
+    arena.reset();
+    for (int i = 0; i < 10000; ++i) {
+      arena.create<int>(i);
+    }
+  }
+  EXPECT_EQ(num_chunks, arena.getNumOfChunks());
+
+  // bigger than a chunk
+  std::vector<char>* big = arena.create<std::vector<char> >(100);
+  char* buffer = static_cast<char*>(arena.allocate(1 << 20, 1));
+  buffer[(1 << 20) - 1] = 'x';
+  EXPECT_EQ(100, big->size());
+  arena.reset();
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
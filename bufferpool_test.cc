@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "MemoryManager.cc"
+#include "test_helpers.cc"
+
+// A relation "t" of 4 blocks, block b holding the tuple (b), and a memory of 3 blocks
+class BufferPoolTest : public StorageTest {
+ protected:
+  BufferPoolTest() : StorageTest(3), mManager(&mem) {
+    rel = createIdRelation("t", 4);
+  }
+
+  // Reads the relation block into a free memory block, caches it and unpins it
+  void cache(int block_index) {
+    int i = mManager.getFreeBlockIndex();
+    mManager.readBlock(rel, block_index, i);
+    mManager.cacheBlock(rel, block_index, i);
+    mManager.unpinBlock(i);
+  }
+
+  MemoryManager mManager;
+  Relation* rel;
+};
+
+TEST_F(BufferPoolTest, cachedPagesAreReadWithoutDiskIO) {
+  cache(0);
+  EXPECT_EQ(3, mManager.numFreeBlocks());
+  disk.resetDiskIOs();
+  int i = mManager.getFreeBlockIndex();
+  EXPECT_TRUE(mManager.readBlock(rel, 0, i));
+  EXPECT_EQ(0UL, disk.getDiskIOs());
+  EXPECT_EQ(1UL, mManager.getHits());
+  EXPECT_EQ(1UL, mManager.getMisses());
+  EXPECT_EQ(0, readId(mem, i));
+}
+
+TEST_F(BufferPoolTest, writtenPagesAreReadAgain) {
+  cache(0);
+  int i = mManager.getFreeBlockIndex();
+  fillIdBlock(mem, rel, i, 42);
+  rel->setBlock(0, i);
+  mManager.releaseBlock(i);
+
+  disk.resetDiskIOs();
+  i = mManager.getFreeBlockIndex();
+  EXPECT_TRUE(mManager.readBlock(rel, 0, i));
+  EXPECT_EQ(1UL, disk.getDiskIOs());
+  EXPECT_EQ(42, readId(mem, i));
+}
+
+TEST_F(BufferPoolTest, clockGivesReferencedPagesASecondChance) {
+  cache(0);
+  cache(1);
+  cache(2);
+  // every page is referenced: the hand clears them all, then evicts page 0
+  int i = mManager.getFreeBlockIndex();
+  EXPECT_EQ(0, i);
+  EXPECT_FALSE(mManager.isCached(rel, 0, 0));
+  // page 1 is used again, so page 2 goes first
+  EXPECT_TRUE(mManager.readBlock(rel, 1, i));
+  EXPECT_EQ(2, mManager.getFreeBlockIndex());
+  EXPECT_TRUE(mManager.isCached(rel, 1, 1));
+}
+
+TEST_F(BufferPoolTest, deletedRelationsForgetTheirPages) {
+  cache(0);
+  cache(1);
+  mManager.forgetRelation(rel);
+  std::vector<int> blocks;
+  EXPECT_TRUE(mManager.getNBlockIndicesFor(rel, blocks, 3));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FALSE(mManager.isCached(rel, i, blocks[i]));
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,63 @@
+#ifndef __DB_TEST_HELPERS_INCLUDED
+#define __DB_TEST_HELPERS_INCLUDED
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "DatabaseManager.cc"
+
+// A database on an in-memory disk without latency, run in a fresh directory, which
+// takes its log.txt and the files the tests write
+class DatabaseTest : public ::testing::Test {
+ protected:
+  explicit DatabaseTest(int memory_blocks) : mem(memory_blocks), succeeded(false) {
+    char path[] = "/tmp/database_test_XXXXXX";
+    directory = mkdtemp(path);
+    char cwd[4096];
+    old_directory = getcwd(cwd, sizeof(cwd));
+    chdir(directory.c_str());
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+    db_manager = new DatabaseManager(&mem, &disk);
+  }
+
+  ~DatabaseTest() {
+    delete db_manager;
+    chdir(old_directory.c_str());
+    system(("rm -rf " + directory).c_str());
+  }
+
+  // Runs the query and sets succeeded; returns the rows it prints, as their fields
+  // separated by single spaces
+  std::vector<std::string> run(std::string query) {
+    std::ostringstream out;
+    std::streambuf* printed = std::cout.rdbuf(out.rdbuf());
+    succeeded = db_manager->processQuery(query);
+    std::cout.rdbuf(printed);
+    std::vector<std::string> rows;
+    std::istringstream lines(out.str());
+    std::string line;
+    while (std::getline(lines, line)) {
+      if (!line.empty() && (isdigit(line[0]) || line[0] == '-')) {
+        std::replace(line.begin(), line.end(), '\t', ' ');
+        rows.push_back(line.substr(0, line.find_last_not_of(' ') + 1));
+      }
+    }
+    return rows;
+  }
+
+  std::string directory;
+  std::string old_directory;
+  MainMemory mem;
+  Disk disk;
+  DatabaseManager* db_manager;
+  bool succeeded; // by the last query run
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "db_test_helpers.cc"
+
+// A table "t" (a INT, b INT) of 40 tuples (a, 0), a = 0 ... 39, in 10 blocks of 4 tuples
+class FreeSpaceTest : public DatabaseTest {
+ protected:
+  FreeSpaceTest() : DatabaseTest(10) {
+    run("CREATE TABLE t (a INT, b INT)");
+    std::string values;
+    for (int a = 0; a < 40; ++a) {
+      values += (a > 0 ? ", (" : "(") + std::to_string(a) + ", 0)";
+    }
+    run("INSERT INTO t (a, b) VALUES " + values);
+  }
+
+  // The a values of the table, in the order of its blocks
+  std::vector<int> scan() {
+    std::vector<int> values;
+    for (const std::string& row : run("SELECT a FROM t")) {
+      values.push_back(std::stoi(row));
+    }
+    return values;
+  }
+};
+
+TEST_F(FreeSpaceTest, deletesWriteOnlyTheBlocksThatLoseATuple) {
+  run("DELETE FROM t WHERE a = 5");
+  EXPECT_TRUE(succeeded);
+  EXPECT_EQ(1UL, disk.getDiskWrites());
+  EXPECT_EQ(39UL, scan().size());
+}
+
+TEST_F(FreeSpaceTest, insertsFillTheHoles) {
+  run("DELETE FROM t WHERE a = 5");
+  run("INSERT INTO t (a, b) VALUES (100, 1)");
+  EXPECT_EQ(1UL, disk.getDiskWrites());
+  std::vector<int> values = scan();
+  ASSERT_EQ(40UL, values.size());
+  EXPECT_EQ(100, values[5]);
+}
+
+TEST_F(FreeSpaceTest, emptiedBlocksAtTheEndAreDroppedWithoutWrites) {
+  run("DELETE FROM t WHERE a > 27");
+  EXPECT_TRUE(succeeded);
+  EXPECT_EQ(0UL, disk.getDiskWrites());
+  EXPECT_EQ(28UL, scan().size());
+  // the table ends with a full block again: a new tuple starts a new one
+  run("INSERT INTO t (a, b) VALUES (100, 1)");
+  EXPECT_EQ(1UL, disk.getDiskWrites());
+  EXPECT_EQ(0UL, disk.getDiskReads());
+}
+
+TEST_F(FreeSpaceTest, emptiedBlocksBeforeTheEndAreWrittenAsHoles) {
+  run("DELETE FROM t WHERE a > 3 AND a < 8 OR a > 35");
+  EXPECT_TRUE(succeeded);
+  // block 1 is written, block 9 dropped
+  EXPECT_EQ(1UL, disk.getDiskWrites());
+  std::vector<int> values = scan();
+  ASSERT_EQ(32UL, values.size());
+  EXPECT_EQ(8, values[4]);
+  run("INSERT INTO t (a, b) VALUES (100, 1)");
+  values = scan();
+  ASSERT_EQ(33UL, values.size());
+  EXPECT_EQ(100, values[4]);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
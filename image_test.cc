@@ -0,0 +1,205 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "StorageManager/Block.h"
+#include "StorageManager/Disk.h"
+#include "StorageManager/MainMemory.h"
+#include "StorageManager/Relation.h"
+#include "StorageManager/Schema.h"
+#include "StorageManager/SchemaManager.h"
+#include "StorageManager/Tuple.h"
+
+// The offsets of the fields of an image that the corruptions overwrite
+// (refer to ImageHeader and ImageTrack in StorageManager.cpp)
+static const int NUM_TRACKS_OFFSET = 16;
+static const int CATALOG_SIZE_OFFSET = 20;
+static const int DICTIONARY_SIZE_OFFSET = 24;
+static const int FIRST_TRACK_OFFSET = 28;
+static const int NUM_BLOCKS_OFFSET = FIRST_TRACK_OFFSET + 4;
+static const int COUNTS_OFFSET_OFFSET = FIRST_TRACK_OFFSET + 8;
+
+class ImageTest : public ::testing::Test {
+ protected:
+  ImageTest() : mem(4) {
+    char path[] = "/tmp/image_test_XXXXXX";
+    directory = mkdtemp(path);
+    image = directory + "/image";
+  }
+
+  ~ImageTest() {
+    system(("rm -rf " + directory).c_str());
+  }
+
+  // Creates the relation "t" with the tuples (i, "value i % 3") for i in [0, num_tuples)
+  void fill(SchemaManager& schema_manager, int num_tuples) {
+    std::vector<std::string> names = {"id", "name"};
+    std::vector<enum FIELD_TYPE> types = {INT, STR20};
+    Relation* relation = schema_manager.createRelation("t", Schema(names, types), true);
+    Tuple tuple = relation->createTuple();
+    for (int i = 0; i < num_tuples; ++i) {
+      tuple.setField(0, i);
+      tuple.setField(1, "value " + std::to_string(i % 3));
+      Block* block = mem.getBlock(0);
+      block->clear();
+      block->appendTuple(tuple);
+      relation->setBlock(i, 0);
+    }
+  }
+
+  // Returns "id:name " for every tuple of "t"
+  std::string dump(SchemaManager& schema_manager) {
+    std::string text;
+    Relation* relation = schema_manager.getRelation("t");
+    for (int i = 0; relation != nullptr && i < relation->getNumOfBlocks(); ++i) {
+      relation->getBlock(i, 0);
+      for (const Tuple& tuple : mem.getBlock(0)->getTuples()) {
+        if (tuple.isNull()) {
+          continue;
+        }
+        text += std::to_string(tuple.getField(0).integer) + ":" + tuple.getField(1).str.toString() + " ";
+      }
+    }
+    return text;
+  }
+
+  std::string readImage() {
+    std::ifstream in(image.c_str(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  }
+
+  void writeImage(const std::string& bytes) {
+    std::ofstream out(image.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+  }
+
+  void setInt(std::string& bytes, int offset, int value) {
+    memcpy(&bytes[offset], &value, sizeof(int));
+  }
+
+  void setLong(std::string& bytes, int offset, long long value) {
+    memcpy(&bytes[offset], &value, sizeof(long long));
+  }
+
+  std::string directory;
+  std::string image;
+  MainMemory mem;
+};
+
+TEST_F(ImageTest, imagesRoundTrip) {
+  Disk disk;
+  disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager schema_manager(&mem, &disk);
+  fill(schema_manager, 10);
+  std::string before = dump(schema_manager);
+  ASSERT_TRUE(schema_manager.saveImage(image));
+
+  Disk other_disk;
+  other_disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager other(&mem, &other_disk);
+  ASSERT_TRUE(other.loadImage(image));
+  EXPECT_EQ(before, dump(other));
+}
+
+TEST_F(ImageTest, imagesRoundTripThroughADataDirectory) {
+  Disk disk;
+  disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager schema_manager(&mem, &disk);
+  fill(schema_manager, 10);
+  std::string before = dump(schema_manager);
+  ASSERT_TRUE(schema_manager.saveImage(image));
+
+  std::string data = directory + "/data";
+  {
+    Disk data_disk(data);
+    data_disk.setLatencyMode(VIRTUAL_LATENCY);
+    SchemaManager loaded(&mem, &data_disk);
+    ASSERT_TRUE(loaded.loadImage(image));
+    EXPECT_EQ(before, dump(loaded));
+  }
+  Disk data_disk(data);
+  data_disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager reopened(&mem, &data_disk);
+  EXPECT_EQ(before, dump(reopened));
+}
+
+TEST_F(ImageTest, corruptedImagesLeaveTheRelationsUnchanged) {
+  {
+    Disk disk;
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+    SchemaManager schema_manager(&mem, &disk);
+    fill(schema_manager, 10);
+    ASSERT_TRUE(schema_manager.saveImage(image));
+  }
+  std::string valid = readImage();
+  std::vector<std::string> corrupted;
+  corrupted.push_back(valid.substr(0, 20));
+  corrupted.push_back(valid.substr(0, valid.size() - 1));
+  std::string bytes = valid;
+  setInt(bytes, NUM_TRACKS_OFFSET, 0x7fffffff);
+  corrupted.push_back(bytes);
+  bytes = valid;
+  setInt(bytes, CATALOG_SIZE_OFFSET, 0x7fffffff);
+  setInt(bytes, DICTIONARY_SIZE_OFFSET, 0x7fffffff);
+  corrupted.push_back(bytes);
+  bytes = valid;
+  setInt(bytes, NUM_BLOCKS_OFFSET, 0x7fffffff);
+  corrupted.push_back(bytes);
+  bytes = valid;
+  setLong(bytes, COUNTS_OFFSET_OFFSET, 0x7fffffffffffffffLL);
+  corrupted.push_back(bytes);
+
+  std::string data = directory + "/data";
+  Disk disk(data);
+  disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager schema_manager(&mem, &disk);
+  fill(schema_manager, 4);
+  std::string before = dump(schema_manager);
+  for (int i = 0; i < corrupted.size(); ++i) {
+    writeImage(corrupted[i]);
+    EXPECT_FALSE(schema_manager.loadImage(image)) << "corruption " << i;
+    EXPECT_EQ(before, dump(schema_manager)) << "corruption " << i;
+  }
+  disk.checkpoint();
+  Disk reopened_disk(data);
+  reopened_disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager reopened(&mem, &reopened_disk);
+  EXPECT_EQ(before, dump(reopened));
+}
+
+TEST_F(ImageTest, everyCorruptedByteOfTheMetadataIsSurvived) {
+  {
+    Disk disk;
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+    SchemaManager schema_manager(&mem, &disk);
+    fill(schema_manager, 3);
+    ASSERT_TRUE(schema_manager.saveImage(image));
+  }
+  std::string valid = readImage();
+  // the header, the tracks, the catalog, the dictionary and the block counts all come
+  // before the pages, which start at the first multiple of 4096
+  std::streambuf* errors = std::cerr.rdbuf(nullptr);
+  for (int i = 0; i < 4096 && i < valid.size(); ++i) {
+    std::string bytes = valid;
+    bytes[i] ^= 0xff;
+    writeImage(bytes);
+    Disk disk;
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+    SchemaManager schema_manager(&mem, &disk);
+    if (!schema_manager.loadImage(image)) {
+      EXPECT_FALSE(schema_manager.relationExists("t")) << "byte " << i;
+    }
+  }
+  std::cerr.rdbuf(errors);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test_helpers.cc"
+
+// Fills memory blocks 0 ... num_blocks-1 with tuples (i, i % 3, "name i % 3")
+// and writes them to the relation with a single setBlocks
+static void writeBlocks(Relation* relation, MainMemory& mem, int num_blocks) {
+  Tuple tuple = relation->createTuple();
+  int tuples_per_block = tuple.getTuplesPerBlock();
+  int i = 0;
+  for (int b = 0; b < num_blocks; ++b) {
+    Block* block = mem.getBlock(b);
+    block->clear();
+    for (int t = 0; t < tuples_per_block; ++t, ++i) {
+      tuple.setField(0, i);
+      tuple.setField(1, i % 3);
+      tuple.setField(2, "name " + std::to_string(i % 3));
+      block->appendTuple(tuple);
+    }
+  }
+  relation->setBlocks(0, 0, num_blocks);
+}
+
+static Schema getSchema() {
+  std::vector<std::string> names = {"id", "grade", "name"};
+  std::vector<enum FIELD_TYPE> types = {INT, INT, STR20};
+  return Schema(names, types);
+}
+
+class LayoutTest : public StorageTest {
+ protected:
+  LayoutTest() : StorageTest(10) {}
+
+  // returns the disk I/Os of writing and then reading back 8 blocks
+  unsigned long int roundTrip(enum BLOCK_LAYOUT layout) {
+    Relation* relation = schema_manager.createRelation(
+        "t" + std::to_string(layout), getSchema(), false, layout);
+    disk.resetDiskIOs();
+    writeBlocks(relation, mem, 8);
+    relation->getBlocks(0, 0, 8);
+    return disk.getDiskIOs();
+  }
+};
+
+TEST_F(LayoutTest, layoutsKeepTheTuples) {
+  enum BLOCK_LAYOUT layouts[] = {ROW_LAYOUT, PAX_LAYOUT, COMPRESSED_LAYOUT};
+  for (enum BLOCK_LAYOUT layout : layouts) {
+    roundTrip(layout);
+    int i = 0;
+    for (int b = 0; b < 8; ++b) {
+      std::vector<Tuple> tuples = mem.getBlock(b)->getTuples();
+      for (const Tuple& tuple : tuples) {
+        EXPECT_EQ(i, tuple.getField(0).integer);
+        EXPECT_EQ(i % 3, tuple.getField(1).integer);
+        EXPECT_EQ("name " + std::to_string(i % 3), tuple.getField(2).str.toString());
+        ++i;
+      }
+    }
+    EXPECT_EQ(8 * getSchema().getTuplesPerBlock(), i);
+  }
+}
+
+TEST_F(LayoutTest, rowAndPaxTransferOnePagePerBlock) {
+  EXPECT_EQ(16UL, roundTrip(ROW_LAYOUT));
+  EXPECT_EQ(16UL, roundTrip(PAX_LAYOUT));
+}
+
+TEST_F(LayoutTest, compressedBlocksAreChargedByTheirBytes) {
+  // 8 blocks of 2 tuples compress into 2 pages, read and written once each
+  EXPECT_EQ(4UL, roundTrip(COMPRESSED_LAYOUT));
+  Relation* relation = schema_manager.getRelation("t" + std::to_string(COMPRESSED_LAYOUT));
+  disk.resetDiskIOs();
+  for (int b = 0; b < 8; ++b) relation->getBlock(b, b);
+  EXPECT_EQ(8UL, disk.getDiskIOs());
+}
+
+TEST(LayoutFileTest, compressedTracksStoreTheCompressedBytes) {
+  char path[] = "/tmp/layout_test_XXXXXX";
+  std::string directory = mkdtemp(path);
+  MainMemory mem(10);
+  {
+    Disk disk(directory);
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+    SchemaManager schema_manager(&mem, &disk);
+    writeBlocks(schema_manager.createRelation("r", getSchema(), false, ROW_LAYOUT), mem, 8);
+    writeBlocks(schema_manager.createRelation("c", getSchema(), false, COMPRESSED_LAYOUT), mem, 8);
+    disk.checkpoint();
+  }
+  struct stat row_file, compressed_file;
+  ASSERT_EQ(0, stat((directory + "/track_0").c_str(), &row_file));
+  ASSERT_EQ(0, stat((directory + "/track_1").c_str(), &compressed_file));
+  EXPECT_LT(compressed_file.st_size * 2, row_file.st_size);
+
+  Disk disk(directory);
+  disk.setLatencyMode(VIRTUAL_LATENCY);
+  SchemaManager schema_manager(&mem, &disk);
+  Relation* relation = schema_manager.getRelation("c");
+  ASSERT_EQ(8, relation->getNumOfBlocks());
+  relation->getBlocks(0, 0, 8);
+  int i = 0;
+  for (int b = 0; b < 8; ++b) {
+    for (const Tuple& tuple : mem.getBlock(b)->getTuples()) {
+      EXPECT_EQ(i, tuple.getField(0).integer);
+      EXPECT_EQ("name " + std::to_string(i % 3), tuple.getField(2).str.toString());
+      ++i;
+    }
+  }
+  EXPECT_EQ(8 * getSchema().getTuplesPerBlock(), i);
+  system(("rm -rf " + directory).c_str());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
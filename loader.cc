@@ -0,0 +1,158 @@
+#ifndef __LOADER_INCLUDED
+#define __LOADER_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+#include "./StorageManager/Block.h"
+#include "./StorageManager/MainMemory.h"
+#include "./StorageManager/Relation.h"
+#include "./StorageManager/Tuple.h"
+#include "MemoryManager.cc"
+
+// Appends tuples to a relation through a buffer of memory blocks: the holes left
+// by deletions are filled first, one block read and write per block with holes,
+// then the last block is topped up and the new blocks are written with one
+// setBlocks call per run of consecutive memory blocks.
+// Loading N tuples costs about N / tuples-per-block disk writes.
+// Usage:
+//   TableLoader loader(rel, mem, mManager);
+//   loader.open(max_blocks);
+//   loader.append(tuple); ...
+//   loader.close(); // writes what is left in the buffer
+class TableLoader {
+private:
+  Relation* rel;
+  MainMemory* mem;
+  MemoryManager& mManager;
+  std::vector<int> buffer; // memory block indices, sorted
+  int tuples_per_block;
+  int hole_block; // relation block index of the block with holes in buffer[0], or -1
+  bool appending; // the holes are all filled and the tuples go to the end
+  int first_block; // relation block index that buffer[0] is written to when appending
+  int num_filled; // buffer blocks holding appended tuples
+
+  TableLoader(const TableLoader&);
+  TableLoader& operator=(const TableLoader&);
+
+  bool flush() {
+    bool result = true;
+    int run_start = 0;
+    for (int k = 1; k <= num_filled; ++k) {
+      if (k == num_filled || buffer[k] != buffer[k - 1] + 1) {
+        result = rel->setBlocks(first_block + run_start, buffer[run_start], k - run_start) && result;
+        run_start = k;
+      }
+    }
+    for (int k = 0; k < num_filled; ++k) {
+      mem->getBlock(buffer[k])->clear();
+    }
+    first_block += num_filled;
+    num_filled = 0;
+    return result;
+  }
+
+  bool fillHole(const Tuple& tuple) {
+    Block* block = mem->getBlock(buffer[0]);
+    if (hole_block == -1) {
+      hole_block = rel->getFirstBlockWithHoles();
+      if (hole_block == -1) {
+        return false;
+      }
+      rel->getBlock(hole_block, buffer[0]);
+    }
+    int offset = 0;
+    for (Block::const_iterator it = block->begin(); it != block->end() && !it->isNull(); ++it) {
+      offset++;
+    }
+    block->setTuple(offset, tuple);
+    bool hasHoles = false;
+    for (Block::const_iterator it = block->begin(); it != block->end(); ++it) {
+      if (it->isNull()) {
+        hasHoles = true;
+        break;
+      }
+    }
+    if (!hasHoles) {
+      rel->setBlock(hole_block, buffer[0]);
+      block->clear();
+      hole_block = -1;
+    }
+    return true;
+  }
+
+  void startAppending() {
+    appending = true;
+    first_block = rel->getNumOfBlocks();
+    num_filled = 0;
+    if (first_block > 0 && rel->getNumOfSlots(first_block - 1) < tuples_per_block) {
+      // the last block has room left: it is read once and topped up
+      first_block--;
+      rel->getBlock(first_block, buffer[0]);
+      num_filled = 1;
+    }
+  }
+
+public:
+  TableLoader(Relation* r, MainMemory* m, MemoryManager& mm)
+      : rel(r), mem(m), mManager(mm), tuples_per_block(1), hole_block(-1), appending(false),
+        first_block(0), num_filled(0) {}
+
+  ~TableLoader() {
+    close();
+  }
+
+  // Takes a buffer of at most max_blocks free blocks.
+  // Returns false if no block is free
+  bool open(int max_blocks) {
+    close();
+    tuples_per_block = rel->getSchema().getTuplesPerBlock();
+    int n = std::max(1, std::min(max_blocks, mManager.numFreeBlocks()));
+    if (!mManager.getNFreeBlockIndices(buffer, n)) {
+      buffer.clear();
+      return false;
+    }
+    std::sort(buffer.begin(), buffer.end());
+    hole_block = -1;
+    appending = false;
+    num_filled = 0;
+    return true;
+  }
+
+  bool append(const Tuple& tuple) {
+    if (buffer.empty()) {
+      return false;
+    }
+    if (!appending) {
+      if (fillHole(tuple)) {
+        return true;
+      }
+      startAppending();
+    }
+    if (num_filled == 0 || mem->getBlock(buffer[num_filled - 1])->isFull()) {
+      if (num_filled == buffer.size() && !flush()) {
+        return false;
+      }
+      num_filled++;
+    }
+    return mem->getBlock(buffer[num_filled - 1])->appendTuple(tuple);
+  }
+
+  // Writes the buffered blocks and gives the buffer back to the memory manager
+  bool close() {
+    bool result = true;
+    if (hole_block != -1) {
+      result = rel->setBlock(hole_block, buffer[0]);
+      hole_block = -1;
+    }
+    if (num_filled > 0) {
+      result = flush() && result;
+    }
+    appending = false;
+    mManager.releaseNBlocks(buffer);
+    buffer.clear();
+    return result;
+  }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "db_test_helpers.cc"
+#include "test_helpers.cc"
+
+// A relation "t" (id INT) of 2 blocks holding a tuple each, in blocks of 8 tuples,
+// and a memory of 10 blocks
+class LoaderTest : public StorageTest {
+ protected:
+  LoaderTest() : StorageTest(10), mManager(&mem) {
+    rel = createIdRelation("t", 2);
+    disk.resetDiskIOs();
+  }
+
+  // Appends the tuples (first) ... (first+n-1) through a buffer of max_blocks blocks
+  void load(int first, int n, int max_blocks) {
+    TableLoader loader(rel, &mem, mManager);
+    ASSERT_TRUE(loader.open(max_blocks));
+    Tuple tuple = rel->createTuple();
+    for (int i = first; i < first + n; ++i) {
+      tuple.setField(0, i);
+      ASSERT_TRUE(loader.append(tuple));
+    }
+    ASSERT_TRUE(loader.close());
+  }
+
+  MemoryManager mManager;
+  Relation* rel;
+};
+
+TEST_F(LoaderTest, theBlocksWithHolesAreToppedUpAndTheNewBlocksWrittenTogether) {
+  // 14 tuples fill blocks 0 and 1, and the 25 others blocks 2 to 5
+  load(2, 39, 4);
+  EXPECT_EQ(2UL, disk.getDiskReads());
+  EXPECT_EQ(6UL, disk.getDiskWrites());
+  EXPECT_EQ(6, rel->getNumOfBlocks());
+  EXPECT_EQ(41, rel->getNumOfTuples());
+  EXPECT_EQ(10, mManager.numFreeBlocks());
+}
+
+TEST_F(LoaderTest, theHolesAreFilledFirst) {
+  load(2, 14, 4);
+  rel->getBlock(0, 0);
+  mem.getBlock(0)->nullTuple(3);
+  rel->setBlock(0, 0);
+  ASSERT_EQ(0, rel->getFirstBlockWithHoles());
+  disk.resetDiskIOs();
+  load(100, 1, 4);
+  EXPECT_EQ(1UL, disk.getDiskReads());
+  EXPECT_EQ(1UL, disk.getDiskWrites());
+  EXPECT_EQ(-1, rel->getFirstBlockWithHoles());
+  rel->getBlock(0, 0);
+  EXPECT_EQ(100, mem.getBlock(0)->getTuple(3).getField(0).integer);
+}
+
+// A table "t" (a INT, s STR20) in blocks of 4 tuples, and a memory of 10 blocks
+class CopyTest : public DatabaseTest {
+ protected:
+  CopyTest() : DatabaseTest(10) {
+    run("CREATE TABLE t (a INT, s STR20)");
+  }
+
+  void writeFile(const std::string& name, const std::string& text) {
+    std::ofstream out(name.c_str());
+    out << text;
+  }
+};
+
+TEST_F(CopyTest, copyLoadsTheRowsInBlockWrites) {
+  std::string text;
+  for (int a = 0; a < 40; ++a) {
+    text += std::to_string(a) + ",\"x, " + std::to_string(a % 3) + "\"\n";
+  }
+  writeFile("t.csv", text);
+  run("COPY t FROM \"t.csv\"");
+  EXPECT_TRUE(succeeded);
+  EXPECT_EQ(10UL, disk.getDiskWrites());
+  std::vector<std::string> rows = run("SELECT * FROM t");
+  ASSERT_EQ(40UL, rows.size());
+  EXPECT_EQ("5 x, 2", rows[5]);
+}
+
+TEST_F(CopyTest, tsvFilesAreSplitOnTabs) {
+  writeFile("t.tsv", "1\tone\n\n2\ttwo, three\n");
+  run("COPY t FROM \"t.tsv\"");
+  EXPECT_TRUE(succeeded);
+  EXPECT_EQ(std::vector<std::string>({"1 one", "2 two, three"}), run("SELECT * FROM t"));
+}
+
+TEST_F(CopyTest, aBadLineLoadsNothing) {
+  std::streambuf* errors = std::cerr.rdbuf(nullptr);
+  writeFile("fields.csv", "1,one\n2\n");
+  run("COPY t FROM \"fields.csv\"");
+  EXPECT_FALSE(succeeded);
+  writeFile("int.csv", "1,one\n99999999999,two\n");
+  run("COPY t FROM \"int.csv\"");
+  EXPECT_FALSE(succeeded);
+  writeFile("str.csv", "1,one\n2,a string longer than twenty\n");
+  run("COPY t FROM \"str.csv\"");
+  EXPECT_FALSE(succeeded);
+  run("COPY t FROM \"missing.csv\"");
+  EXPECT_FALSE(succeeded);
+  std::cerr.rdbuf(errors);
+  EXPECT_EQ(0UL, disk.getDiskWrites());
+  EXPECT_TRUE(run("SELECT * FROM t").empty());
+}
+
+TEST_F(CopyTest, aRejectedFileAddsNothingToTheDictionary) {
+  std::string data_directory = directory + "/data";
+  writeFile("bad.csv", "1,rejected\nx,value\n");
+  {
+    MainMemory data_mem(10);
+    Disk data_disk(data_directory);
+    data_disk.setLatencyMode(VIRTUAL_LATENCY);
+    DatabaseManager data_manager(&data_mem, &data_disk);
+    data_manager.setDictionaryEncoding(true);
+    std::ostringstream out;
+    std::streambuf* printed = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* errors = std::cerr.rdbuf(nullptr);
+    std::vector<std::string> queries = {"CREATE TABLE d (a INT, s STR20)", "COPY d FROM \"bad.csv\"",
+                                        "INSERT INTO d (a, s) VALUES (1, \"kept\")"};
+    EXPECT_TRUE(data_manager.processQuery(queries[0]));
+    EXPECT_FALSE(data_manager.processQuery(queries[1]));
+    EXPECT_TRUE(data_manager.processQuery(queries[2]));
+    std::cerr.rdbuf(errors);
+    std::cout.rdbuf(printed);
+  }
+  std::ifstream in((data_directory + "/dictionary").c_str());
+  std::stringstream dictionary;
+  dictionary << in.rdbuf();
+  EXPECT_EQ("4 kept\n", dictionary.str());
+}
+
+TEST_F(CopyTest, insertSelectOfTheTargetInsertsEveryRowOnce) {
+  run("INSERT INTO t (a, s) VALUES (1, \"one\"), (2, \"two\"), (3, \"three\")");
+  run("INSERT INTO t (a, s) SELECT * FROM t");
+  EXPECT_TRUE(succeeded);
+  EXPECT_EQ(6UL, run("SELECT * FROM t").size());
+  run("INSERT INTO t (a, s) SELECT * FROM t WHERE a = 2");
+  std::vector<std::string> rows = run("SELECT * FROM t WHERE a = 2");
+  EXPECT_EQ(std::vector<std::string>({"2 two", "2 two", "2 two", "2 two"}), rows);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
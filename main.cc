@@ -1,11 +1,202 @@
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include "DatabaseManager.cc"
 
-int main() {
+// Returns true and sets value if arg is "--<name>=<value>"
+static bool getOptionValue(const std::string& arg, const std::string& name, std::string& value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+// Returns false unless the whole value is an int
+static bool parseInt(const std::string& value, int& result) {
+  char* end;
+  errno = 0;
+  long parsed = std::strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) {
+    return false;
+  }
+  result = parsed;
+  return true;
+}
+
+// Returns false unless the whole value is a number
+static bool parseDouble(const std::string& value, double& result) {
+  char* end;
+  errno = 0;
+  double parsed = std::strtod(value.c_str(), &end);
+  if (value.empty() || *end != '\0' || errno == ERANGE) {
+    return false;
+  }
+  result = parsed;
+  return true;
+}
+
+// Returns false if the profile is neither a known one nor custom:SEEK,ROTATION,TRANSFER,QUEUE_DEPTH
+static bool getDiskProfile(const std::string& name, DiskProfile& profile) {
+  if (name == "hdd") {
+    profile = Disk::getHDDProfile();
+  } else if (name == "sata-ssd") {
+    profile = Disk::getSataSSDProfile();
+  } else if (name == "nvme") {
+    profile = Disk::getNVMeProfile();
+  } else {
+    profile.name = "custom";
+    char separator[3];
+    std::istringstream values(name.substr(name.find(':') + 1));
+    return name.compare(0, 7, "custom:") == 0 &&
+        values >> profile.seek_time >> separator[0] >> profile.rotation_latency >> separator[1] >>
+        profile.transfer_time_per_block >> separator[2] >> profile.queue_depth &&
+        separator[0] == ',' && separator[1] == ',' && separator[2] == ',' && values.peek() == EOF;
+  }
+  return true;
+}
+
+// Usage: ./a.out [--data-dir=DIR] [--latency=spin|virtual|sleep] [--latency-scale=X]
+//                [--memory-blocks=N] [--fields-per-block=N] [--dictionary-encoding]
+//                [--block-layout=row|pax|compressed] [--profile] [--prefetch]
+//                [--async-commit=MS] [--io-scheduler=fifo|scan] [--disk-profile=PROFILE]
+//                [--disks=N]
+//   --data-dir=DIR       store the simulated disk in DIR, so that tables survive across runs
+//   --latency=MODE       spin: busy-wait for the simulated disk latency
+//                        virtual: only account the simulated time
+//                        sleep: sleep for the simulated time times the latency scale
+//                        (default: spin if SIMULATED_DISK_LATENCY_ON is 1, virtual otherwise)
+//   --latency-scale=X    scale of the sleep in the sleep mode (default 1)
+//   --memory-blocks=N    number of blocks in the main memory (default NUM_OF_BLOCKS_IN_MEMORY)
+//   --fields-per-block=N number of fields a block holds (default FIELDS_PER_BLOCK);
+//                        an existing data directory keeps the value it was created with
+//   --dictionary-encoding store the STR20 fields of the new tables as dictionary codes
+//   --block-layout=LAYOUT how the disk blocks of the new tables are laid out
+//                        row: tuple by tuple (default)
+//                        pax: field by field
+//                        compressed: field by field and compressed
+//   --pax-layout         same as --block-layout=pax
+//   --profile            print the disk I/Os and times of every query by operator and by relation
+//   --prefetch           read the next blocks of joins and merges on an I/O thread
+//   --async-commit=MS    with a data directory, return from every statement before its log
+//                        is synced, and sync the log MS milliseconds later; a crash loses
+//                        the statements of the last MS milliseconds
+//                        (default DEFAULT_ASYNC_COMMIT_DELAY: sync every statement)
+//   --io-scheduler=ORDER charge the disk seeks by the position of the head (HEAD_POSITION_SEEK),
+//                        and serve the reads queued by --prefetch in this order
+//                        fifo: in the order they are requested
+//                        scan: sorted by track and block, sweeping back and forth
+//   --disk-profile=PROFILE the timing of the simulated device (refer to DiskProfile)
+//                        hdd: the Megatron 747 (default)
+//                        sata-ssd, nvme: solid-state drives
+//                        custom:SEEK,ROTATION,TRANSFER,QUEUE_DEPTH: the times in ms, and the
+//                        number of blocks transferred in parallel
+//   --disks=N            stripe the blocks of the tables over N devices of the profile (default 1)
+int main(int argc, char* argv[]) {
+  std::string data_dir;
+  std::string latency; // the disk's default
+  double latency_scale = 1;
+  int memory_blocks = NUM_OF_BLOCKS_IN_MEMORY;
+  int fields_per_block = FIELDS_PER_BLOCK;
+  bool dictionary_encoding = false;
+  std::string block_layout = "row";
+  bool profile = false;
+  bool prefetch = false;
+  double async_commit_delay = DEFAULT_ASYNC_COMMIT_DELAY;
+  std::string io_scheduler;
+  std::string disk_profile = "hdd";
+  int disks = 1;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    bool known = true;
+    if (arg == "--dictionary-encoding") {
+      dictionary_encoding = true;
+    } else if (arg == "--pax-layout") {
+      block_layout = "pax";
+    } else if (arg == "--profile") {
+      profile = true;
+    } else if (arg == "--prefetch") {
+      prefetch = true;
+    } else if (getOptionValue(arg, "latency-scale", value)) {
+      known = parseDouble(value, latency_scale);
+    } else if (getOptionValue(arg, "memory-blocks", value)) {
+      known = parseInt(value, memory_blocks);
+    } else if (getOptionValue(arg, "fields-per-block", value)) {
+      known = parseInt(value, fields_per_block);
+    } else if (getOptionValue(arg, "async-commit", value)) {
+      known = parseDouble(value, async_commit_delay);
+    } else if (getOptionValue(arg, "disks", value)) {
+      known = parseInt(value, disks);
+    } else {
+      known = getOptionValue(arg, "data-dir", data_dir) ||
+              getOptionValue(arg, "latency", latency) ||
+              getOptionValue(arg, "block-layout", block_layout) ||
+              getOptionValue(arg, "io-scheduler", io_scheduler) ||
+              getOptionValue(arg, "disk-profile", disk_profile);
+    }
+    if (!known) {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  if (!Config::setNumOfBlocksInMemory(memory_blocks) ||
+      !Config::setFieldsPerBlock(fields_per_block)) {
+    return 1;
+  }
+
 	// Initialize the memory, disk, the database manager
 	MainMemory mem;
-	Disk disk;
+	Disk disk(data_dir);
+  if (latency == "spin") {
+    disk.setLatencyMode(SPIN_LATENCY);
+  } else if (latency == "virtual") {
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+  } else if (latency == "sleep") {
+    disk.setLatencyMode(SLEEP_LATENCY);
+  } else if (latency != "") {
+    std::cerr << "Unknown latency mode: " << latency << std::endl;
+    return 1;
+  }
+  disk.setLatencyScale(latency_scale);
+  DiskProfile device_profile;
+  if (!getDiskProfile(disk_profile, device_profile)) {
+    std::cerr << "Unknown disk profile: " << disk_profile << std::endl;
+    return 1;
+  }
+  if (!disk.setProfile(device_profile) || !disk.setNumOfDevices(disks)) {
+    return 1;
+  }
+  disk.setAsyncCommitDelay(async_commit_delay);
 	DatabaseManager db_manager(&mem, &disk);
+  db_manager.setDictionaryEncoding(dictionary_encoding);
+  db_manager.setPrintProfile(profile);
+  db_manager.setPrefetch(prefetch);
+  if (block_layout == "row") {
+    db_manager.setBlockLayout(ROW_LAYOUT);
+  } else if (block_layout == "pax") {
+    db_manager.setBlockLayout(PAX_LAYOUT);
+  } else if (block_layout == "compressed") {
+    db_manager.setBlockLayout(COMPRESSED_LAYOUT);
+  } else {
+    std::cerr << "Unknown block layout: " << block_layout << std::endl;
+    return 1;
+  }
+  if (io_scheduler == "fifo") {
+    disk.setSeekModel(HEAD_POSITION_SEEK);
+    db_manager.setIOScheduling(FIFO_SCHEDULING);
+  } else if (io_scheduler == "scan") {
+    disk.setSeekModel(HEAD_POSITION_SEEK);
+    db_manager.setIOScheduling(SCAN_SCHEDULING);
+  } else if (io_scheduler != "") {
+    std::cerr << "Unknown I/O scheduler: " << io_scheduler << std::endl;
+    return 1;
+  }
 
   std::string query;
 	while (std::getline(std::cin, query)) {
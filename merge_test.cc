@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "db_test_helpers.cc"
+
+// A table "t" (a INT, b INT) of 64 tuples, 4 a block: its 16 blocks make 4 sorted sublists
+// in a memory of 4 blocks, one too many to merge with an output block, so that its sorts
+// merge the sublists once more before the last merge. That merge leaves a block to
+// prefetch the last sublist into
+class MergeTest : public DatabaseTest {
+ protected:
+  MergeTest() : DatabaseTest(4) {
+    run("CREATE TABLE t (a INT, b INT)");
+    for (int i = 0; i < 64; ++i) {
+      int a = i % 32;
+      run("INSERT INTO t (a, b) VALUES (" + std::to_string(a) + ", " + std::to_string(a * 7 % 32) + ")");
+    }
+  }
+
+  bool mergedMorePasses() {
+    for (const RelationProfile& relation : db_manager->getLastQueryProfile().getRelations()) {
+      if (relation.relation == "merged_rel_1") {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The b value of a row "a b"
+  static int getB(const std::string& row) {
+    return std::stoi(row.substr(row.find(' ') + 1));
+  }
+};
+
+TEST_F(MergeTest, sortsMergeTheSublistsInMorePasses) {
+  std::vector<std::string> rows = run("SELECT * FROM t ORDER BY b");
+  EXPECT_TRUE(mergedMorePasses());
+  ASSERT_EQ(64UL, rows.size());
+  for (int i = 0; i < rows.size(); ++i) {
+    // every b value comes twice, from the two tuples of each a
+    EXPECT_EQ(i / 2, getB(rows[i])) << rows[i];
+  }
+}
+
+TEST_F(MergeTest, duplicatesAreRemovedInMorePasses) {
+  std::vector<std::string> rows = run("SELECT DISTINCT * FROM t");
+  EXPECT_TRUE(mergedMorePasses());
+  ASSERT_EQ(32UL, rows.size());
+  std::sort(rows.begin(), rows.end());
+  EXPECT_EQ(rows.end(), std::unique(rows.begin(), rows.end()));
+}
+
+TEST_F(MergeTest, prefetchedMergesGiveTheSameRows) {
+  std::vector<std::string> sorted = run("SELECT * FROM t ORDER BY b");
+  std::vector<std::string> distinct = run("SELECT DISTINCT * FROM t");
+  db_manager->setPrefetch(true);
+  EXPECT_EQ(sorted, run("SELECT * FROM t ORDER BY b"));
+  EXPECT_EQ(distinct, run("SELECT DISTINCT * FROM t"));
+  EXPECT_EQ(sorted, run("SELECT * FROM t ORDER BY b"));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,6 +1,7 @@
 #ifndef __PARSE_TREE_INCLUDED
 #define __PARSE_TREE_INCLUDED
 
+#include <iostream>
 #include <string>
 #include <vector>
 
@@ -44,7 +45,15 @@ enum NODE_TYPE {
   ORDER_LITERAL,
   BY_LITERAL,
   DELETE_STATEMENT,
-  DELETE_LITERAL
+  DELETE_LITERAL,
+  COPY_STATEMENT,
+  COPY_LITERAL,
+  FILE_NAME,
+  SAVE_STATEMENT,
+  SAVE_LITERAL,
+  TO_LITERAL,
+  LOAD_STATEMENT,
+  LOAD_LITERAL
 };
 
 class ParseTreeNode {
@@ -54,16 +63,12 @@ public:
   std::string value;
   std::vector<ParseTreeNode *> children;
 
+  // Nodes are created with Arena::create and are owned by the arena,
+  // so a node does not delete its children
   ParseTreeNode(enum NODE_TYPE t, std::string v) : value(v) {
     type = t;
   }
 
-  ~ParseTreeNode() {
-    for (int i = 0; i < children.size(); ++i) {
-      delete children[i];
-    }
-  }
-
   static void printParseTree(ParseTreeNode* root, int level = 0) {
     if (root == NULL) {
       return;
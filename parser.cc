@@ -5,7 +5,9 @@
 #include <string>
 #include <stack>
 #include <algorithm>
+#include <cctype>
 
+#include "arena.cc"
 #include "parse_tree.cc"
 #include "tokenizer.cc"
 
@@ -69,87 +71,136 @@ private:
     return false;
     }
 
+  static bool isCopyFromQuery(std::vector<std::string>& tokens) {
+    if (tokens.size() != 4) {
+      return false;
+    }
+    if (tokens[0] == "COPY") {
+      if (tokens[2] == "FROM") {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool isSaveQuery(std::vector<std::string>& tokens) {
+    if (tokens.size() != 3) {
+      return false;
+    }
+    if (tokens[0] == "SAVE") {
+      if (tokens[1] == "TO") {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool isLoadQuery(std::vector<std::string>& tokens) {
+    if (tokens.size() != 3) {
+      return false;
+    }
+    if (tokens[0] == "LOAD") {
+      if (tokens[1] == "FROM") {
+        return true;
+      }
+    }
+    return false;
+  }
+
   static ParseTreeNode* getAttributeTypeList(
-      std::vector<std::string>& tokens, int start_index) {
+      Arena& arena, std::vector<std::string>& tokens, int start_index) {
     std::string att_name = tokens[start_index];
     std::string att_type = tokens[start_index + 1];
 
-    ParseTreeNode* att_type_list = new ParseTreeNode(NODE_TYPE::ATTRIBUTE_TYPE_LIST, "attribute_type_list");
-    (att_type_list->children).push_back(new ParseTreeNode(NODE_TYPE::ATTRIBUTE_NAME, att_name));
-    (att_type_list->children).push_back(new ParseTreeNode(NODE_TYPE::ATTRIBUTE_DATA_TYPE, att_type));
+    ParseTreeNode* att_type_list = arena.create<ParseTreeNode>(NODE_TYPE::ATTRIBUTE_TYPE_LIST, "attribute_type_list");
+    (att_type_list->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::ATTRIBUTE_NAME, att_name));
+    (att_type_list->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::ATTRIBUTE_DATA_TYPE, att_type));
 
     if (tokens[start_index + 2] == ",") {
-      (att_type_list->children).push_back(getAttributeTypeList(tokens, start_index + 3));
+      (att_type_list->children).push_back(getAttributeTypeList(arena, tokens, start_index + 3));
     }
 
     return att_type_list;
   }
 
   static ParseTreeNode* getAttributeList(
-      std::vector<std::string>& tokens, int start_index) {
+      Arena& arena, std::vector<std::string>& tokens, int start_index) {
     std::string att_name = tokens[start_index];
 
-    ParseTreeNode* att_list = new ParseTreeNode(NODE_TYPE::ATTRIBUTE_LIST, "attribute_list");
-    (att_list->children).push_back(new ParseTreeNode(NODE_TYPE::ATTRIBUTE_NAME, att_name));
+    ParseTreeNode* att_list = arena.create<ParseTreeNode>(NODE_TYPE::ATTRIBUTE_LIST, "attribute_list");
+    (att_list->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::ATTRIBUTE_NAME, att_name));
 
     if (tokens[start_index + 1] == ",") {
-      (att_list->children).push_back(getAttributeList(tokens, start_index + 2));
+      (att_list->children).push_back(getAttributeList(arena, tokens, start_index + 2));
     }
 
     return att_list;
   }
 
   static ParseTreeNode* getValueList(
-      std::vector<std::string>& tokens, int start_index) {
-    ParseTreeNode* value_list = new ParseTreeNode(NODE_TYPE::VALUE_LIST, "value_list");
+      Arena& arena, std::vector<std::string>& tokens, int start_index) {
+    ParseTreeNode* value_list = arena.create<ParseTreeNode>(NODE_TYPE::VALUE_LIST, "value_list");
 
     std::string value = tokens[start_index];
-    (value_list->children).push_back(new ParseTreeNode(NODE_TYPE::VALUE, value));
+    (value_list->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::VALUE, value));
 
     if (tokens[start_index + 1] == ",") {
-      (value_list->children).push_back(getValueList(tokens, start_index + 2));
+      (value_list->children).push_back(getValueList(arena, tokens, start_index + 2));
     }
 
     return value_list;
   }
 
   static ParseTreeNode* getInsertTuples(
-      std::vector<std::string>& tokens, int start_index) {
-    ParseTreeNode* insert_tuples = new ParseTreeNode(NODE_TYPE::INSERT_TUPLES, "insert_tuples");
+      Arena& arena, std::vector<std::string>& tokens, int start_index) {
+    ParseTreeNode* insert_tuples = arena.create<ParseTreeNode>(NODE_TYPE::INSERT_TUPLES, "insert_tuples");
 
     if(tokens[start_index] == "VALUES") {
-      (insert_tuples->children).push_back(new ParseTreeNode(NODE_TYPE::VALUES_LITERAL, "VALUES"));
-      (insert_tuples->children).push_back(getValueList(tokens, start_index + 2));
+      (insert_tuples->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::VALUES_LITERAL, "VALUES"));
+      // VALUES (...), (...), ...: one value list per tuple
+      int list_start = start_index + 1;
+      while (list_start + 1 < tokens.size() && tokens[list_start] == "(") {
+        (insert_tuples->children).push_back(getValueList(arena, tokens, list_start + 1));
+        // skip the values, the commas between them and the closing bracket
+        list_start++;
+        while (list_start + 1 < tokens.size() && tokens[list_start + 1] == ",") {
+          list_start += 2;
+        }
+        list_start += 2;
+        if (list_start < tokens.size() && tokens[list_start] == ",") {
+          list_start++;
+        }
+      }
     }
     else
-      (insert_tuples->children).push_back(getSelectTree(tokens, start_index));
+      (insert_tuples->children).push_back(getSelectTree(arena, tokens, start_index));
 
     return insert_tuples;
   }
 
-  static ParseTreeNode* getSelectSublist(std::vector<std::string>& tokens, int start_index) {
+  static ParseTreeNode* getSelectSublist(Arena& arena, std::vector<std::string>& tokens, int start_index) {
     std::string value = tokens[start_index];
     if(value == "*")
-      return new ParseTreeNode(NODE_TYPE::STAR, "*");
+      return arena.create<ParseTreeNode>(NODE_TYPE::STAR, "*");
 
-    ParseTreeNode* sub_list = new ParseTreeNode(NODE_TYPE::SELECT_SUBLIST, "select_sublist");
-    (sub_list->children).push_back(new ParseTreeNode(NODE_TYPE::COLUMN_NAME, value));
+    ParseTreeNode* sub_list = arena.create<ParseTreeNode>(NODE_TYPE::SELECT_SUBLIST, "select_sublist");
+    (sub_list->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::COLUMN_NAME, value));
 
     if (start_index + 1 < tokens.size() && tokens[start_index + 1] == ",") {
-      (sub_list->children).push_back(getSelectSublist(tokens, start_index + 2));
+      (sub_list->children).push_back(getSelectSublist(arena, tokens, start_index + 2));
     }
 
     return sub_list;
   }
 
-  static ParseTreeNode* getTableList(std::vector<std::string>& tokens, int start_index) {
-    ParseTreeNode* table_list = new ParseTreeNode(NODE_TYPE::TABLE_LIST, "table_list");
+  static ParseTreeNode* getTableList(Arena& arena, std::vector<std::string>& tokens, int start_index) {
+    ParseTreeNode* table_list = arena.create<ParseTreeNode>(NODE_TYPE::TABLE_LIST, "table_list");
 
     std::string value = tokens[start_index];
-    (table_list->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_NAME, value));
+    (table_list->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_NAME, value));
 
     if (start_index < tokens.size() - 1 && tokens[start_index + 1] == ",") {
-      (table_list->children).push_back(getTableList(tokens, start_index + 2));
+      (table_list->children).push_back(getTableList(arena, tokens, start_index + 2));
     }
 
     return table_list;
@@ -223,14 +274,14 @@ private:
     return false;
   }
 
-  static ParseTreeNode* getPostfixNode(std::vector<std::string>& tokens, int start_index, int end_index) {
-    ParseTreeNode* root = new ParseTreeNode(NODE_TYPE::POSTFIX_EXPRESSION, "postfix_expression");
+  static ParseTreeNode* getPostfixNode(Arena& arena, std::vector<std::string>& tokens, int start_index, int end_index) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::POSTFIX_EXPRESSION, "postfix_expression");
     std::stack<std::string> st;
 
     for (int i = start_index; i < end_index;  ++i) {
       if (isOperator(tokens[i])) {
         while (!st.empty() && !isOpeningBracket(st.top()) && hasHigherPrecedence(st.top(), tokens[i])) {
-          (root->children).push_back(new ParseTreeNode(NODE_TYPE::POSTFIX_OPERATOR, st.top()));
+          (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::POSTFIX_OPERATOR, st.top()));
           st.pop();
         }
         st.push(tokens[i]);
@@ -238,56 +289,56 @@ private:
         st.push(tokens[i]);
       } else if (isClosingBracket(tokens[i])) {
         while (!st.empty() && !isOpeningBracket(st.top())) {
-          (root->children).push_back(new ParseTreeNode(NODE_TYPE::POSTFIX_OPERATOR, st.top()));
+          (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::POSTFIX_OPERATOR, st.top()));
           st.pop();
         }
         st.pop();
       } else {
-        (root->children).push_back(new ParseTreeNode(NODE_TYPE::POSTFIX_OPERAND, tokens[i]));
+        (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::POSTFIX_OPERAND, tokens[i]));
       }
     }
 
     while (!st.empty()) {
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::POSTFIX_OPERATOR, st.top()));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::POSTFIX_OPERATOR, st.top()));
       st.pop();
     }
     return root;
   }
 
-  static ParseTreeNode* getCreateTableTree(std::vector<std::string>& tokens) {
-    ParseTreeNode* root = new ParseTreeNode(NODE_TYPE::CREATE_TABLE_STATEMENT, "create_statement");
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::CREATE_LITERAL, "CREATE"));
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_LITERAL, "TABLE"));
+  static ParseTreeNode* getCreateTableTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::CREATE_TABLE_STATEMENT, "create_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::CREATE_LITERAL, "CREATE"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_LITERAL, "TABLE"));
 
     // add relation name child
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_NAME, tokens[2]));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_NAME, tokens[2]));
 
-    (root->children).push_back(getAttributeTypeList(tokens, 4));
+    (root->children).push_back(getAttributeTypeList(arena, tokens, 4));
 
     return root;
   }
 
-  static ParseTreeNode* getDropTableTree(std::vector<std::string>& tokens) {
-    ParseTreeNode* root = new ParseTreeNode(NODE_TYPE::DROP_TABLE_STATEMENT, "drop_statement");
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::DROP_LITERAL, "DROP"));
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_LITERAL, "TABLE"));
+  static ParseTreeNode* getDropTableTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::DROP_TABLE_STATEMENT, "drop_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::DROP_LITERAL, "DROP"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_LITERAL, "TABLE"));
 
     // add relation name child
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_NAME, tokens[2]));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_NAME, tokens[2]));
 
     return root;
   }
 
-  static ParseTreeNode* getInsertIntoTableTree(std::vector<std::string>& tokens) {
-    ParseTreeNode* root = new ParseTreeNode(NODE_TYPE::INSERT_STATEMENT, "insert_statement");
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::INSERT_LITERAL, "INSERT"));
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::INTO_LITERAL, "INTO"));
+  static ParseTreeNode* getInsertIntoTableTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::INSERT_STATEMENT, "insert_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::INSERT_LITERAL, "INSERT"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::INTO_LITERAL, "INTO"));
 
     // add relation name child
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_NAME, tokens[2]));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_NAME, tokens[2]));
 
     // add attribute list
-    (root->children).push_back(getAttributeList(tokens, 4));
+    (root->children).push_back(getAttributeList(arena, tokens, 4));
 
     int values_start = 4;
     while (tokens[values_start] != ")") {
@@ -296,30 +347,30 @@ private:
     values_start++;
 
     //std::cout << "values start at: " << values_start << " token: " << tokens[values_start] << std::endl;
-    (root->children).push_back(getInsertTuples(tokens, values_start));
+    (root->children).push_back(getInsertTuples(arena, tokens, values_start));
 
     return root;
   }
 
-  static ParseTreeNode* getSelectTree(std::vector<std::string>& tokens, int start_index = 0) {
+  static ParseTreeNode* getSelectTree(Arena& arena, std::vector<std::string>& tokens, int start_index = 0) {
     int distinct_index = 0;
-    ParseTreeNode* root = new ParseTreeNode(NODE_TYPE::SELECT_STATEMENT, "select_statement");
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::SELECT_LITERAL, "SELECT"));
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::SELECT_STATEMENT, "select_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::SELECT_LITERAL, "SELECT"));
     if(tokens[1 + start_index] == "DISTINCT") {
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::DISTINCT_LITERAL, "DISTINCT"));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::DISTINCT_LITERAL, "DISTINCT"));
       distinct_index++;
     }
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::SELECT_LIST, "select_list"));
-    ((root->children[root->children.size() - 1])->children).push_back(getSelectSublist(
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::SELECT_LIST, "select_list"));
+    ((root->children[root->children.size() - 1])->children).push_back(getSelectSublist(arena,
       tokens, 1 + start_index + distinct_index));
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::FROM_LITERAL, "FROM"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FROM_LITERAL, "FROM"));
 
     int table_list_start = start_index;
     while (tokens[table_list_start] != "FROM") {
       table_list_start++;
     }
     table_list_start++;
-    (root->children).push_back(getTableList(tokens, table_list_start));
+    (root->children).push_back(getTableList(arena, tokens, table_list_start));
 
     int where_start = table_list_start;
     int where_end = tokens.size();
@@ -344,39 +395,74 @@ private:
     }
 
     if(where_present) {
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::WHERE_LITERAL, "WHERE"));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::WHERE_LITERAL, "WHERE"));
       //make where_clause
 
-      (root->children).push_back(getPostfixNode(tokens, where_start + 1, where_end));
+      (root->children).push_back(getPostfixNode(arena, tokens, where_start + 1, where_end));
     }
 
     if(order_by_present) {
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::ORDER_LITERAL, "ORDER"));
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::BY_LITERAL, "BY"));
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::COLUMN_NAME, tokens[order_start + 2]));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::ORDER_LITERAL, "ORDER"));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::BY_LITERAL, "BY"));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::COLUMN_NAME, tokens[order_start + 2]));
     }
     return root;
   }
 
-  static ParseTreeNode* getDeleteFromTree(std::vector<std::string>& tokens) {
-    ParseTreeNode* root = new ParseTreeNode(NODE_TYPE::DELETE_STATEMENT, "delete_statement");
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::DELETE_LITERAL, "DELETE"));
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::FROM_LITERAL, "FROM"));
+  static ParseTreeNode* getDeleteFromTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::DELETE_STATEMENT, "delete_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::DELETE_LITERAL, "DELETE"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FROM_LITERAL, "FROM"));
 
     // add relation name child
-    (root->children).push_back(new ParseTreeNode(NODE_TYPE::TABLE_NAME, tokens[2]));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_NAME, tokens[2]));
 
     if (tokens.size() > 3) {
-      (root->children).push_back(new ParseTreeNode(NODE_TYPE::WHERE_LITERAL, "WHERE"));
-      (root->children).push_back(getPostfixNode(tokens, 4, tokens.size()));
+      (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::WHERE_LITERAL, "WHERE"));
+      (root->children).push_back(getPostfixNode(arena, tokens, 4, tokens.size()));
     }
 
     return root;
   }
 
+  // COPY table_name FROM "file": loads the rows of a CSV file, or of a TSV file if its name ends with .tsv
+  static ParseTreeNode* getCopyFromTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::COPY_STATEMENT, "copy_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::COPY_LITERAL, "COPY"));
+
+    // add relation name child
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TABLE_NAME, tokens[1]));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FROM_LITERAL, "FROM"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FILE_NAME, tokens[3]));
+
+    return root;
+  }
+
+  // SAVE TO "file": saves every table in one image file
+  static ParseTreeNode* getSaveTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::SAVE_STATEMENT, "save_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::SAVE_LITERAL, "SAVE"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::TO_LITERAL, "TO"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FILE_NAME, tokens[2]));
+    return root;
+  }
+
+  // LOAD FROM "file": replaces every table with the ones of an image file
+  static ParseTreeNode* getLoadTree(Arena& arena, std::vector<std::string>& tokens) {
+    ParseTreeNode* root = arena.create<ParseTreeNode>(NODE_TYPE::LOAD_STATEMENT, "load_statement");
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::LOAD_LITERAL, "LOAD"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FROM_LITERAL, "FROM"));
+    (root->children).push_back(arena.create<ParseTreeNode>(NODE_TYPE::FILE_NAME, tokens[2]));
+    return root;
+  }
+
 public:
-  static ParseTreeNode* getPostfixNodePublic(std::vector<std::string>& tokens, int start_index, int end_index) {
-    return getPostfixNode(tokens, start_index, end_index);
+  static ParseTreeNode* getPostfixNodePublic(Arena& arena, std::vector<std::string>& tokens, int start_index, int end_index) {
+    return getPostfixNode(arena, tokens, start_index, end_index);
+  }
+
+  static void toUpper(std::string& token) {
+    std::transform(token.begin(), token.end(), token.begin(), ::toupper);
   }
 
   static bool isOperator(std::string& token) {
@@ -388,36 +474,59 @@ public:
     return false;
   }
 
-  static ParseTreeNode* parseQuery(const std::string& query, std::vector<std::string>& tokens) {
+  static ParseTreeNode* parseQuery(Arena& arena, const std::string& query, std::vector<std::string>& tokens) {
     tokens = Tokenizer::getTokens(query);
-    // make first token toUpper
 
     if (tokens.size() < 3)
       return nullptr;
 
+    // the keywords that open a statement are case-insensitive
+    toUpper(tokens[0]);
+    if (tokens[0] == "CREATE" || tokens[0] == "DROP" || tokens[0] == "INSERT" || tokens[0] == "DELETE") {
+      toUpper(tokens[1]);
+    }
+
     if (isCreateTableQuery(tokens)) {
-      ParseTreeNode* ans = getCreateTableTree(tokens);
+      ParseTreeNode* ans = getCreateTableTree(arena, tokens);
       //ParseTreeNode::printParseTree(ans);
       return ans;
     } else if (isDropTableQuery(tokens)) {
-      ParseTreeNode* ans = getDropTableTree(tokens);
+      ParseTreeNode* ans = getDropTableTree(arena, tokens);
       //ParseTreeNode::printParseTree(ans);
       return ans;
     } else if (isInsertIntoTableQuery(tokens)) {
-      ParseTreeNode* ans = getInsertIntoTableTree(tokens);
+      ParseTreeNode* ans = getInsertIntoTableTree(arena, tokens);
       //ParseTreeNode::printParseTree(ans);
       return ans;
     } else if (isSelectQuery(tokens)) {
-      ParseTreeNode* ans = getSelectTree(tokens);
+      ParseTreeNode* ans = getSelectTree(arena, tokens);
       //ParseTreeNode::printParseTree(ans);
       return ans;
     } else if (isDeleteFromQuery(tokens)) {
-      ParseTreeNode* ans = getDeleteFromTree(tokens);
+      ParseTreeNode* ans = getDeleteFromTree(arena, tokens);
+      //ParseTreeNode::printParseTree(ans);
+      return ans;
+    } else if (isCopyFromQuery(tokens)) {
+      ParseTreeNode* ans = getCopyFromTree(arena, tokens);
+      //ParseTreeNode::printParseTree(ans);
+      return ans;
+    } else if (isSaveQuery(tokens)) {
+      ParseTreeNode* ans = getSaveTree(arena, tokens);
+      //ParseTreeNode::printParseTree(ans);
+      return ans;
+    } else if (isLoadQuery(tokens)) {
+      ParseTreeNode* ans = getLoadTree(arena, tokens);
       //ParseTreeNode::printParseTree(ans);
       return ans;
     }
     return nullptr;
   }
+
+  // Parses a query whose tokens the caller does not need
+  static ParseTreeNode* parseQuery(Arena& arena, const std::string& query) {
+    std::vector<std::string> tokens;
+    return parseQuery(arena, query, tokens);
+  }
 };
 
 #endif
@@ -6,20 +6,21 @@
 #include "parse_tree.cc"
 
 TEST(ParserTest, createTableTest) {
+  Arena arena;
   std::string test = "CREATE    TABLE test( id INT,    name STR20)";
-  ParseTreeNode* ans = Parser::parseQuery(test);
+  ParseTreeNode* ans = Parser::parseQuery(arena, test);
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("create table test (id INT, name STR20)");
+  ans = Parser::parseQuery(arena, "create table test (id INT, name STR20)");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Create TAble test (id INT, name STR20)");
+  ans = Parser::parseQuery(arena, "Create TAble test (id INT, name STR20)");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Create test (id INT, name STR20)");
+  ans = Parser::parseQuery(arena, "Create test (id INT, name STR20)");
   EXPECT_EQ(nullptr, ans);
 
-  ans = Parser::parseQuery("Cresate TAble test (id INT, name STR20)");
+  ans = Parser::parseQuery(arena, "Cresate TAble test (id INT, name STR20)");
   EXPECT_EQ(nullptr, ans);
   //ASSERT_TRUE("SRT" == "SRT");
   
@@ -29,20 +30,21 @@ TEST(ParserTest, createTableTest) {
 }
 
 TEST(ParserTest, dropTableTest) {
+  Arena arena;
   std::string test = "DROP    TABLE test";
-  ParseTreeNode* ans = Parser::parseQuery(test);
+  ParseTreeNode* ans = Parser::parseQuery(arena, test);
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("drop table test");
+  ans = Parser::parseQuery(arena, "drop table test");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Drop TAble test");
+  ans = Parser::parseQuery(arena, "Drop TAble test");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Drop test");
+  ans = Parser::parseQuery(arena, "Drop test");
   EXPECT_EQ(nullptr, ans);
 
-  ans = Parser::parseQuery("drops TAble test");
+  ans = Parser::parseQuery(arena, "drops TAble test");
   EXPECT_EQ(nullptr, ans);
 
   //for (int i = 0; i < ans.size(); ++i) {
@@ -51,20 +53,21 @@ TEST(ParserTest, dropTableTest) {
 }
 
 TEST(ParserTest, insertIntoTest) {
+  Arena arena;
   std::string test = "INSERT    INTO test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")";
-  ParseTreeNode* ans = Parser::parseQuery(test);
+  ParseTreeNode* ans = Parser::parseQuery(arena, test);
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("insert into test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
+  ans = Parser::parseQuery(arena, "insert into test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Insert Into test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
+  ans = Parser::parseQuery(arena, "Insert Into test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("INsert test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
+  ans = Parser::parseQuery(arena, "INsert test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
   EXPECT_EQ(nullptr, ans);
 
-  ans = Parser::parseQuery("Inseert TAble test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
+  ans = Parser::parseQuery(arena, "Inseert TAble test (id, value, name, text) VALUES (10, 20, \"some name\", \"some random text\")");
   EXPECT_EQ(nullptr, ans);
 
   //for (int i = 0; i < ans.size(); ++i) {
@@ -73,20 +76,21 @@ TEST(ParserTest, insertIntoTest) {
 }
 
 TEST(ParserTest, deleteFromTest) {
+  Arena arena;
   std::string test = "DELETE    FROM test";
-  ParseTreeNode* ans = Parser::parseQuery(test);
+  ParseTreeNode* ans = Parser::parseQuery(arena, test);
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("delete from test");
+  ans = Parser::parseQuery(arena, "delete from test");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Delete From test");
+  ans = Parser::parseQuery(arena, "Delete From test");
   EXPECT_NE(nullptr, ans);
 
-  ans = Parser::parseQuery("Delete test");
+  ans = Parser::parseQuery(arena, "Delete test");
   EXPECT_EQ(nullptr, ans);
 
-  ans = Parser::parseQuery("Deletes FROM test");
+  ans = Parser::parseQuery(arena, "Deletes FROM test");
   EXPECT_EQ(nullptr, ans);
 
   //for (int i = 0; i < ans.size(); ++i) {
@@ -94,6 +98,56 @@ TEST(ParserTest, deleteFromTest) {
   //}
 }
 
+TEST(ParserTest, insertManyTuplesTest) {
+  Arena arena;
+  ParseTreeNode* ans = Parser::parseQuery(arena, "INSERT INTO test (id, name) VALUES (1, \"a\"), (2, \"b\"), (3, \"c\")");
+  ASSERT_NE(nullptr, ans);
+  ParseTreeNode* tuples = ans->children.back();
+  EXPECT_EQ(INSERT_TUPLES, tuples->type);
+  // VALUES and one value list per tuple
+  ASSERT_EQ(4, tuples->children.size());
+  EXPECT_EQ(VALUES_LITERAL, tuples->children[0]->type);
+  for (int i = 1; i < 4; ++i) {
+    EXPECT_EQ(VALUE_LIST, tuples->children[i]->type);
+    EXPECT_EQ(std::to_string(i), tuples->children[i]->children[0]->value);
+  }
+  EXPECT_EQ("b", tuples->children[2]->children[1]->children[0]->value);
+}
+
+TEST(ParserTest, copyFromTest) {
+  Arena arena;
+  ParseTreeNode* ans = Parser::parseQuery(arena, "COPY test FROM \"test.csv\"");
+  ASSERT_NE(nullptr, ans);
+  EXPECT_EQ(COPY_STATEMENT, ans->type);
+  EXPECT_EQ("test", ans->children[1]->value);
+  EXPECT_EQ("test.csv", ans->children[3]->value);
+
+  ans = Parser::parseQuery(arena, "COPY test FROM \"test.tsv\"");
+  EXPECT_NE(nullptr, ans);
+
+  ans = Parser::parseQuery(arena, "COPY test \"test.csv\"");
+  EXPECT_EQ(nullptr, ans);
+}
+
+TEST(ParserTest, saveAndLoadTest) {
+  Arena arena;
+  ParseTreeNode* ans = Parser::parseQuery(arena, "SAVE TO \"test.img\"");
+  ASSERT_NE(nullptr, ans);
+  EXPECT_EQ(SAVE_STATEMENT, ans->type);
+  EXPECT_EQ("test.img", ans->children[2]->value);
+
+  ans = Parser::parseQuery(arena, "LOAD FROM \"test.img\"");
+  ASSERT_NE(nullptr, ans);
+  EXPECT_EQ(LOAD_STATEMENT, ans->type);
+  EXPECT_EQ("test.img", ans->children[2]->value);
+
+  ans = Parser::parseQuery(arena, "SAVE \"test.img\"");
+  EXPECT_EQ(nullptr, ans);
+
+  ans = Parser::parseQuery(arena, "LOAD \"test.img\"");
+  EXPECT_EQ(nullptr, ans);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,185 @@
+#ifndef __PREFETCHER_INCLUDED
+#define __PREFETCHER_INCLUDED
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "./StorageManager/Disk.h"
+#include "./StorageManager/Relation.h"
+
+// The order in which the prefetcher serves the reads queued for the I/O thread:
+//   FIFO_SCHEDULING: in the order they were requested (the default)
+//   SCAN_SCHEDULING: the reads queued while the I/O thread was busy are served as a batch,
+//                    sorted by track and block: first the ones ahead of the disk head in the
+//                    direction it sweeps, then the ones behind it, reversing the sweep (an
+//                    elevator). With Disk::HEAD_POSITION_SEEK, this saves seeks and rotations
+enum IO_SCHEDULING_POLICY { FIFO_SCHEDULING, SCAN_SCHEDULING };
+
+// Reads relation blocks into memory blocks on an I/O thread, so that the caller
+// computes on the blocks it has while the disk latency of the next ones passes.
+// The memory blocks of a request must not be touched until wait() returns for it.
+// The disk serializes its accesses, so the caller may read and write other
+// relations meanwhile, but must not create or delete relations.
+// Usage:
+//   unsigned long ticket = prefetcher.request(rel, relation_block_index, memory_block_index, n);
+//   ... work on other blocks ...
+//   prefetcher.wait(ticket);
+class Prefetcher {
+private:
+  struct Request {
+    const Relation* relation;
+    int relation_block_index;
+    int memory_block_index;
+    int num_blocks;
+    const std::vector<bool>* fields; // nullptr reads every field
+    unsigned long ticket;
+
+    bool operator<(const Request& other) const {
+      if (relation->getTrackIndex() != other.relation->getTrackIndex()) {
+        return relation->getTrackIndex() < other.relation->getTrackIndex();
+      }
+      return relation_block_index < other.relation_block_index;
+    }
+  };
+
+  Disk* disk;
+  enum IO_SCHEDULING_POLICY policy;
+  bool sweeping_up; // the direction of the SCAN sweep
+  std::thread worker; // started by the first request
+  std::mutex mutex;
+  std::condition_variable requested;
+  std::condition_variable completed;
+  std::deque<Request> requests; // not taken by the I/O thread yet
+  std::set<unsigned long> pending; // the tickets not read yet
+  unsigned long num_requested;
+  bool stopping;
+
+  Prefetcher(const Prefetcher&);
+  Prefetcher& operator=(const Prefetcher&);
+
+  // Orders a batch of requests as one sweep of the elevator, starting from the disk head
+  void orderBatch(std::vector<Request>& batch) {
+    std::sort(batch.begin(), batch.end());
+    int head_track = disk->getHeadTrack();
+    int head_block = disk->getHeadBlock();
+    // the first request at or after the head
+    int ahead = 0;
+    while (ahead < batch.size() &&
+           (batch[ahead].relation->getTrackIndex() < head_track ||
+            (batch[ahead].relation->getTrackIndex() == head_track &&
+             batch[ahead].relation_block_index < head_block))) {
+      ahead++;
+    }
+    if (sweeping_up) {
+      // up to the last request, then back down to the first
+      std::reverse(batch.begin(), batch.begin() + ahead);
+      std::rotate(batch.begin(), batch.begin() + ahead, batch.end());
+      if (ahead > 0) {
+        sweeping_up = false;
+      }
+    } else {
+      // down to the first request, then back up to the last
+      std::reverse(batch.begin(), batch.begin() + ahead);
+      if (ahead < batch.size()) {
+        sweeping_up = true;
+      }
+    }
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      while (requests.empty() && !stopping) {
+        requested.wait(lock);
+      }
+      if (requests.empty()) {
+        return;
+      }
+      std::vector<Request> batch;
+      if (policy == SCAN_SCHEDULING) {
+        batch.assign(requests.begin(), requests.end());
+        requests.clear();
+      } else {
+        batch.push_back(requests.front());
+        requests.pop_front();
+      }
+      lock.unlock();
+      if (policy == SCAN_SCHEDULING) {
+        orderBatch(batch);
+      }
+      for (int i = 0; i < batch.size(); ++i) {
+        const Request& request = batch[i];
+        if (request.fields != nullptr) {
+          request.relation->getBlocks(request.relation_block_index, request.memory_block_index,
+              request.num_blocks, *request.fields);
+        } else {
+          request.relation->getBlocks(request.relation_block_index, request.memory_block_index,
+              request.num_blocks);
+        }
+        std::lock_guard<std::mutex> done(mutex);
+        pending.erase(request.ticket);
+        completed.notify_all();
+      }
+      lock.lock();
+    }
+  }
+
+public:
+  Prefetcher(Disk* d) : disk(d), policy(FIFO_SCHEDULING), sweeping_up(true), num_requested(0),
+      stopping(false) {}
+
+  ~Prefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    requested.notify_one();
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  // Call it while no read is queued
+  void setPolicy(enum IO_SCHEDULING_POLICY policy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->policy = policy;
+  }
+
+  // Queues the read of num_blocks consecutive blocks; returns the ticket to wait for
+  unsigned long request(const Relation* rel, int relation_block_index, int memory_block_index,
+      int num_blocks, const std::vector<bool>* fields = nullptr) {
+    if (!worker.joinable()) {
+      worker = std::thread(&Prefetcher::run, this);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Request request = {rel, relation_block_index, memory_block_index, num_blocks, fields,
+        ++num_requested};
+    requests.push_back(request);
+    pending.insert(request.ticket);
+    requested.notify_one();
+    return request.ticket;
+  }
+
+  // Returns once the request of the ticket is read; with FIFO_SCHEDULING, so is every
+  // request before it
+  void wait(unsigned long ticket) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (pending.count(ticket) > 0) {
+      completed.wait(lock);
+    }
+  }
+
+  void waitAll() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!pending.empty()) {
+      completed.wait(lock);
+    }
+  }
+};
+
+#endif
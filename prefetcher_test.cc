@@ -0,0 +1,86 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "scanner.cc"
+#include "test_helpers.cc"
+
+// A relation "t" of 8 blocks, block b holding the tuple (b), and a relation "busy" on the
+// next track. The disk sleeps a tenth of the simulated time, so that the reads queued
+// behind a read of "busy" are served by the I/O thread as one batch
+class PrefetcherTest : public StorageTest {
+ protected:
+  PrefetcherTest() : StorageTest(10), mManager(&mem), prefetcher(&disk) {
+    rel = createIdRelation("t", 8);
+    busy = createIdRelation("busy", 1);
+    disk.setLatencyMode(SLEEP_LATENCY);
+    disk.setLatencyScale(0.1);
+  }
+
+  // Keeps the I/O thread reading "busy" into the memory block for a while
+  void keepBusy(int memory_block_index) {
+    prefetcher.request(busy, 0, memory_block_index, 1);
+  }
+
+  MemoryManager mManager;
+  Prefetcher prefetcher;
+  Relation* rel;
+  Relation* busy;
+};
+
+TEST_F(PrefetcherTest, everyTicketIsReadOnceWaited) {
+  std::vector<unsigned long> tickets;
+  for (int b = 0; b < 8; ++b) {
+    tickets.push_back(prefetcher.request(rel, b, b, 1));
+  }
+  for (int b = 7; b >= 0; --b) {
+    prefetcher.wait(tickets[b]);
+    EXPECT_EQ(b, readId(mem, b));
+  }
+}
+
+TEST_F(PrefetcherTest, scanSchedulingSweepsTheQueuedReads) {
+  prefetcher.setPolicy(SCAN_SCHEDULING);
+  keepBusy(9);
+  unsigned long first = prefetcher.request(rel, 5, 5, 1);
+  unsigned long second = prefetcher.request(rel, 2, 2, 1);
+  unsigned long third = prefetcher.request(rel, 7, 7, 1);
+  prefetcher.wait(first);
+  prefetcher.wait(second);
+  prefetcher.wait(third);
+  EXPECT_EQ(5, readId(mem, 5));
+  EXPECT_EQ(2, readId(mem, 2));
+  EXPECT_EQ(7, readId(mem, 7));
+  // the head was past "t": the sweep went down from block 7 to block 2
+  EXPECT_EQ(rel->getTrackIndex(), disk.getHeadTrack());
+  EXPECT_EQ(3, disk.getHeadBlock());
+}
+
+TEST_F(PrefetcherTest, scansWaitForEveryReadOfABatch) {
+  prefetcher.setPolicy(SCAN_SCHEDULING);
+  // the free blocks are 0, 2, 4, 6 and 8: every block of a batch is a run of its own
+  std::vector<int> taken;
+  ASSERT_TRUE(mManager.getNFreeBlockIndices(taken, 10));
+  for (int i = 0; i < 10; i += 2) {
+    mManager.releaseBlock(taken[i]);
+  }
+  keepBusy(1);
+  // a projected scan caches nothing, so nothing but the tickets waits for the I/O thread
+  std::vector<bool> fields(1, true);
+  TableScanner scanner(rel, &mem, mManager);
+  ASSERT_TRUE(scanner.open(4, &fields, &prefetcher));
+  int expected = 0;
+  while (scanner.nextBatch()) {
+    for (int k = 0; k < scanner.getBatchSize(); ++k) {
+      EXPECT_EQ(expected, scanner.getRelationBlockIndex(k));
+      EXPECT_EQ(expected, readId(mem, scanner.getMemoryBlockIndex(k)));
+      ++expected;
+    }
+  }
+  EXPECT_EQ(8, expected);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,181 @@
+#ifndef __PROFILER_INCLUDED
+#define __PROFILER_INCLUDED
+
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "./StorageManager/Disk.h"
+#include "./StorageManager/Relation.h"
+#include "./StorageManager/SchemaManager.h"
+
+// The disk I/Os and time of one operator invocation, the operators it calls included
+struct OperatorProfile {
+  std::string name; // e.g. "table scan", "two-pass sort"
+  std::string relation; // the relation the operator reads
+  int depth; // 0 for the operators the statement runs, 1 for the ones they call, ...
+  unsigned long reads;
+  unsigned long writes;
+  double disk_time; // simulated, in ms
+  double wall_time; // in ms
+};
+
+// The disk I/Os and time spent on the blocks of one relation during a query
+struct RelationProfile {
+  std::string relation;
+  bool temporary; // created by the query, and deleted at its end
+  unsigned long reads;
+  unsigned long writes;
+  double disk_time; // simulated, in ms
+};
+
+// Attributes the disk I/Os, the simulated disk time and the wall time of a query to
+// the operators it runs and to the relations it touches.
+// Usage:
+//   profiler.beginQuery();
+//   { OperatorScope scope(profiler, "sort", relation_name); ... } // once per operator
+//   profiler.endQuery(schema_manager, temp_relations);
+//   profiler.getOperators(), profiler.getRelations() or profiler.print(out)
+// The disk counters must be reset before beginQuery().
+class QueryProfiler {
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  Disk* disk;
+  std::vector<OperatorProfile> operators; // in the order they started
+  std::vector<Clock::time_point> start_times; // of the operators, same order
+  std::vector<int> running; // indices of the operators not finished yet, innermost last
+  std::vector<RelationProfile> relations;
+  Clock::time_point query_start;
+  double wall_time;
+
+  static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+public:
+  QueryProfiler(Disk* d) : disk(d), wall_time(0) {}
+
+  void beginQuery() {
+    operators.clear();
+    start_times.clear();
+    running.clear();
+    relations.clear();
+    query_start = Clock::now();
+    wall_time = 0;
+  }
+
+  // Returns the index of the operator, to pass to endOperator()
+  int beginOperator(const std::string& name, const std::string& relation) {
+    OperatorProfile op;
+    op.name = name;
+    op.relation = relation;
+    op.depth = running.size();
+    // the counters at the start; endOperator() turns them into the operator's share
+    op.reads = disk->getDiskReads();
+    op.writes = disk->getDiskWrites();
+    op.disk_time = disk->getDiskTimer();
+    op.wall_time = 0;
+    operators.push_back(op);
+    start_times.push_back(Clock::now());
+    running.push_back(operators.size() - 1);
+    return operators.size() - 1;
+  }
+
+  void endOperator(int index) {
+    OperatorProfile& op = operators[index];
+    op.reads = disk->getDiskReads() - op.reads;
+    op.writes = disk->getDiskWrites() - op.writes;
+    op.disk_time = disk->getDiskTimer() - op.disk_time;
+    op.wall_time = millisecondsSince(start_times[index]);
+    while (!running.empty() && running.back() >= index) {
+      running.pop_back();
+    }
+  }
+
+  // Collects the counters of the relations; call it before the temporary relations are deleted
+  void endQuery(SchemaManager& schema_manager, const std::vector<std::string>& temp_relations) {
+    wall_time = millisecondsSince(query_start);
+    std::vector<std::string> names;
+    schema_manager.getRelationNames(names);
+    for (int i = 0; i < names.size(); ++i) {
+      Relation* rel = schema_manager.getRelation(names[i]);
+      if (rel->getDiskReads() == 0 && rel->getDiskWrites() == 0) {
+        continue;
+      }
+      RelationProfile profile;
+      profile.relation = names[i];
+      profile.temporary = false;
+      for (int k = 0; k < temp_relations.size(); ++k) {
+        if (temp_relations[k] == names[i]) {
+          profile.temporary = true;
+        }
+      }
+      profile.reads = rel->getDiskReads();
+      profile.writes = rel->getDiskWrites();
+      profile.disk_time = rel->getDiskTimer();
+      relations.push_back(profile);
+    }
+  }
+
+  const std::vector<OperatorProfile>& getOperators() const {
+    return operators;
+  }
+
+  const std::vector<RelationProfile>& getRelations() const {
+    return relations;
+  }
+
+  double getWallTime() const {
+    return wall_time;
+  }
+
+  // Prints the operators, nested under the ones that call them, then the relations
+  void print(std::ostream& out) const {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2);
+    text << "Profile: " << disk->getDiskReads() << " reads, " << disk->getDiskWrites()
+         << " writes, " << disk->getDiskTimer() << " ms disk, " << wall_time << " ms wall\n";
+    if (disk->getNumOfDevices() > 1) {
+      for (int d = 0; d < disk->getNumOfDevices(); ++d) {
+        text << "  device " << d << ": " << disk->getDeviceIOs(d) << " I/Os, "
+             << disk->getDeviceTimer(d) << " ms busy\n";
+      }
+    }
+    for (int i = 0; i < operators.size(); ++i) {
+      const OperatorProfile& op = operators[i];
+      text << "  " << std::string(2 * op.depth, ' ') << op.name << " (" << op.relation << "): "
+           << op.reads << " reads, " << op.writes << " writes, " << op.disk_time << " ms disk, "
+           << op.wall_time << " ms wall\n";
+    }
+    for (int i = 0; i < relations.size(); ++i) {
+      const RelationProfile& rel = relations[i];
+      text << "  relation " << rel.relation << (rel.temporary ? " (temporary)" : "") << ": "
+           << rel.reads << " reads, " << rel.writes << " writes, " << rel.disk_time << " ms disk\n";
+    }
+    out << text.str();
+  }
+};
+
+// Profiles an operator invocation for as long as it is in scope
+class OperatorScope {
+private:
+  QueryProfiler& profiler;
+  int index;
+
+  OperatorScope(const OperatorScope&);
+  OperatorScope& operator=(const OperatorScope&);
+
+public:
+  OperatorScope(QueryProfiler& p, const std::string& name, const std::string& relation)
+      : profiler(p), index(p.beginOperator(name, relation)) {}
+
+  ~OperatorScope() {
+    profiler.endOperator(index);
+  }
+};
+
+#endif
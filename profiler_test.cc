@@ -0,0 +1,127 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "db_test_helpers.cc"
+
+// A table "t" (a INT, b INT) of 40 tuples in 10 blocks of 4, and a memory of 4 blocks:
+// too small to sort it in one pass
+class ProfilerTest : public DatabaseTest {
+ protected:
+  ProfilerTest() : DatabaseTest(4) {
+    run("CREATE TABLE t (a INT, b INT)");
+    std::string values;
+    for (int i = 0; i < 40; ++i) {
+      values += (i > 0 ? ", (" : "(") + std::to_string(i % 20) + ", " + std::to_string(i * 7 % 40) + ")";
+    }
+    run("INSERT INTO t (a, b) VALUES " + values);
+  }
+
+  const QueryProfiler& profile() {
+    return db_manager->getLastQueryProfile();
+  }
+
+  const RelationProfile* findRelation(const std::string& name) {
+    for (const RelationProfile& relation : profile().getRelations()) {
+      if (relation.relation == name) {
+        return &relation;
+      }
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(ProfilerTest, aScanIsOneOperatorOnOneRelation) {
+  run("SELECT * FROM t");
+  const std::vector<OperatorProfile>& operators = profile().getOperators();
+  ASSERT_EQ(1UL, operators.size());
+  EXPECT_EQ("table scan", operators[0].name);
+  EXPECT_EQ("t", operators[0].relation);
+  EXPECT_EQ(0, operators[0].depth);
+  EXPECT_EQ(10UL, operators[0].reads);
+  EXPECT_EQ(0UL, operators[0].writes);
+  EXPECT_DOUBLE_EQ(disk.getDiskTimer(), operators[0].disk_time);
+  ASSERT_EQ(1UL, profile().getRelations().size());
+  const RelationProfile* t = findRelation("t");
+  ASSERT_NE(nullptr, t);
+  EXPECT_FALSE(t->temporary);
+  EXPECT_EQ(10UL, t->reads);
+  EXPECT_EQ(0UL, t->writes);
+}
+
+TEST_F(ProfilerTest, theStatementOperatorsAddUpToTheQuery) {
+  run("SELECT * FROM t ORDER BY b");
+  unsigned long reads = 0, writes = 0;
+  double disk_time = 0;
+  for (const OperatorProfile& op : profile().getOperators()) {
+    if (op.depth == 0) {
+      reads += op.reads;
+      writes += op.writes;
+      disk_time += op.disk_time;
+    }
+  }
+  EXPECT_EQ(disk.getDiskReads(), reads);
+  EXPECT_EQ(disk.getDiskWrites(), writes);
+  EXPECT_NEAR(disk.getDiskTimer(), disk_time, 1e-6);
+}
+
+TEST_F(ProfilerTest, calledOperatorsAreNestedInTheirCaller) {
+  run("SELECT * FROM t ORDER BY b");
+  const std::vector<OperatorProfile>& operators = profile().getOperators();
+  ASSERT_GE(operators.size(), 3UL);
+  EXPECT_EQ("sort", operators[1].name);
+  EXPECT_EQ(0, operators[1].depth);
+  EXPECT_EQ("two-pass sort", operators[2].name);
+  EXPECT_EQ(1, operators[2].depth);
+  EXPECT_EQ(operators[1].reads, operators[2].reads);
+  EXPECT_EQ(operators[1].writes, operators[2].writes);
+  for (int i = 3; i < operators.size(); ++i) {
+    EXPECT_EQ(2, operators[i].depth);
+  }
+}
+
+TEST_F(ProfilerTest, theRelationsShareTheIOsAndTheTemporaryOnesAreMarked) {
+  run("SELECT * FROM t ORDER BY b");
+  const RelationProfile* sublists = findRelation("sublist_rel");
+  ASSERT_NE(nullptr, sublists);
+  EXPECT_TRUE(sublists->temporary);
+  EXPECT_EQ(10UL, sublists->reads);
+  EXPECT_EQ(10UL, sublists->writes);
+  EXPECT_FALSE(findRelation("t")->temporary);
+  unsigned long reads = 0, writes = 0;
+  for (const RelationProfile& relation : profile().getRelations()) {
+    reads += relation.reads;
+    writes += relation.writes;
+  }
+  EXPECT_EQ(disk.getDiskReads(), reads);
+  EXPECT_EQ(disk.getDiskWrites(), writes);
+}
+
+TEST_F(ProfilerTest, eachQueryStartsAFreshProfile) {
+  run("SELECT * FROM t ORDER BY b");
+  run("DELETE FROM t WHERE a = 3");
+  ASSERT_EQ(1UL, profile().getOperators().size());
+  EXPECT_EQ("delete", profile().getOperators()[0].name);
+  EXPECT_EQ(1UL, profile().getRelations().size());
+  EXPECT_EQ(nullptr, findRelation("sublist_rel"));
+}
+
+TEST_F(ProfilerTest, theReportListsTheOperatorsAndTheRelations) {
+  run("SELECT * FROM t ORDER BY b");
+  std::ostringstream out;
+  profile().print(out);
+  std::string report = out.str();
+  std::ostringstream totals;
+  totals << "Profile: " << disk.getDiskReads() << " reads, " << disk.getDiskWrites() << " writes, ";
+  EXPECT_EQ(0UL, report.find(totals.str()));
+  EXPECT_NE(std::string::npos, report.find("\n  sort (t_out_tmp): "));
+  EXPECT_NE(std::string::npos, report.find("\n    two-pass sort (t_out_tmp): "));
+  EXPECT_NE(std::string::npos, report.find("\n  relation sublist_rel (temporary): 10 reads, 10 writes, "));
+  EXPECT_NE(std::string::npos, report.find("\n  relation t: 10 reads, 0 writes, "));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
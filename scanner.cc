@@ -0,0 +1,206 @@
+#ifndef __SCANNER_INCLUDED
+#define __SCANNER_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+#include "./StorageManager/Block.h"
+#include "./StorageManager/MainMemory.h"
+#include "./StorageManager/Relation.h"
+#include "MemoryManager.cc"
+#include "prefetcher.cc"
+
+// Reads a relation front to back in batches of blocks, with one getBlocks call
+// per run of consecutive memory blocks in the buffer: a full scan pays one disk
+// seek per batch instead of one per block.
+// Blocks the buffer pool caches are copied from it instead of read, and a scan
+// of every field leaves the blocks it read cached for the next operators.
+// With a prefetcher, the buffer is split in two halves: the next batch is read
+// into one half on the I/O thread while the caller works on the other.
+// Usage:
+//   TableScanner scanner(rel, mem, mManager);
+//   scanner.open(max_blocks);
+//   while (scanner.nextBatch()) {
+//     for (int k = 0; k < scanner.getBatchSize(); ++k) { ... scanner.getBlock(k) ... }
+//   }
+// The buffer goes back to the memory manager on close() or destruction.
+class TableScanner {
+private:
+  Relation* rel;
+  MainMemory* mem;
+  MemoryManager& mManager;
+  Prefetcher* prefetcher; // nullptr reads the batches when they are needed
+  const std::vector<bool>* fields; // nullptr reads every field
+  std::vector<int> buffer; // memory block indices, sorted when the scan is opened
+  int num_blocks; // blocks of the relation when the scan was opened
+  int batch_first; // relation block index of the first block of the batch
+  int batch_size;
+  int batch_offset; // of the batch in the buffer
+  int ahead_first; // the batch being prefetched, if ahead_size > 0
+  int ahead_size;
+  int ahead_offset;
+  std::vector<unsigned long> ahead_tickets; // of the prefetch requests of the batch
+
+  TableScanner(const TableScanner&);
+  TableScanner& operator=(const TableScanner&);
+
+  // The most blocks of a batch
+  int getHalfSize() const {
+    if (prefetcher != nullptr && buffer.size() >= 2) {
+      return buffer.size() / 2;
+    }
+    return buffer.size();
+  }
+
+  void readRun(int relation_block_index, int buffer_offset, int length, std::vector<unsigned long>& tickets) {
+    if (prefetcher != nullptr) {
+      tickets.push_back(prefetcher->request(rel, relation_block_index, buffer[buffer_offset], length, fields));
+    } else if (fields != nullptr) {
+      rel->getBlocks(relation_block_index, buffer[buffer_offset], length, *fields);
+    } else {
+      rel->getBlocks(relation_block_index, buffer[buffer_offset], length);
+    }
+  }
+
+  // Starts reading the batch from relation block 'first' into the buffer from 'offset':
+  // the cached blocks are copied now, the others are read or prefetched, one request
+  // per run of consecutive buffer blocks.
+  // Returns the size of the batch, 0 after the last block
+  int startBatch(int first, int offset, std::vector<unsigned long>& tickets) {
+    tickets.clear();
+    int size = std::min(getHalfSize(), num_blocks - first);
+    if (size <= 0) {
+      return 0;
+    }
+    // the buffer blocks of the half that already cache blocks of the batch are moved in place
+    for (int k = 0; k < size; ++k) {
+      for (int j = offset + k; j < offset + getHalfSize(); ++j) {
+        if (mManager.isCached(rel, first + k, buffer[j])) {
+          std::swap(buffer[offset + k], buffer[j]);
+          break;
+        }
+      }
+    }
+    std::vector<bool> missed(size, false);
+    for (int k = 0; k < size; ++k) {
+      missed[k] = !mManager.copyCachedBlock(rel, first + k, buffer[offset + k]);
+    }
+    int run_start = -1;
+    for (int k = 0; k <= size; ++k) {
+      bool ends_run = k == size || !missed[k] || (k > 0 && buffer[offset + k] != buffer[offset + k - 1] + 1);
+      if (run_start != -1 && ends_run) {
+        readRun(first + run_start, offset + run_start, k - run_start, tickets);
+        mManager.countMisses(k - run_start);
+        run_start = -1;
+      }
+      if (k < size && missed[k] && run_start == -1) {
+        run_start = k;
+      }
+    }
+    return size;
+  }
+
+  // Waits for the batch started by startBatch(): for every one of its requests, since
+  // SCAN_SCHEDULING may serve them in any order
+  void finishBatch(int first, int offset, int size, const std::vector<unsigned long>& tickets) {
+    for (int i = 0; i < tickets.size(); ++i) {
+      prefetcher->wait(tickets[i]);
+    }
+    if (fields == nullptr) {
+      // projected blocks miss fields: only whole blocks are cached
+      for (int k = 0; k < size; ++k) {
+        mManager.cacheBlock(rel, first + k, buffer[offset + k]);
+      }
+    }
+  }
+
+public:
+  TableScanner(Relation* r, MainMemory* m, MemoryManager& mm)
+      : rel(r), mem(m), mManager(mm), prefetcher(nullptr), fields(nullptr), num_blocks(0), batch_first(0),
+        batch_size(0), batch_offset(0), ahead_first(0), ahead_size(0), ahead_offset(0) {}
+
+  ~TableScanner() {
+    close();
+  }
+
+  // Takes a buffer of at most max_blocks free blocks, but no more than the
+  // relation has. 'projection' flags the fields to read; it must outlive the scan.
+  // With 'prefetch', the next batch is read on the I/O thread of the prefetcher.
+  // Returns false if no block is free
+  bool open(int max_blocks, const std::vector<bool>* projection = nullptr, Prefetcher* prefetch = nullptr) {
+    close();
+    fields = projection;
+    prefetcher = prefetch;
+    num_blocks = rel->getNumOfBlocks();
+    int n = std::min(max_blocks, std::min(num_blocks, mManager.numFreeBlocks()));
+    n = std::max(n, 1);
+    if (!mManager.getNBlockIndicesFor(rel, buffer, n)) {
+      buffer.clear();
+      return false;
+    }
+    std::sort(buffer.begin(), buffer.end());
+    rewind();
+    return true;
+  }
+
+  // Starts over from the first block, e.g. for the inner relation of a join
+  void rewind() {
+    if (ahead_size > 0) {
+      finishBatch(ahead_first, ahead_offset, ahead_size, ahead_tickets);
+    }
+    batch_first = 0;
+    batch_size = 0;
+    batch_offset = 0;
+    ahead_size = 0;
+  }
+
+  // Reads the next batch into the buffer; returns false after the last block
+  bool nextBatch() {
+    int first = batch_first + batch_size;
+    if (ahead_size == 0) {
+      ahead_first = first;
+      ahead_offset = batch_size > 0 && batch_offset == 0 ? buffer.size() - getHalfSize() : 0;
+      ahead_size = startBatch(ahead_first, ahead_offset, ahead_tickets);
+    }
+    finishBatch(ahead_first, ahead_offset, ahead_size, ahead_tickets);
+    batch_first = ahead_first;
+    batch_size = ahead_size;
+    batch_offset = ahead_offset;
+    ahead_size = 0;
+    if (batch_size == 0) {
+      return false;
+    }
+    if (prefetcher != nullptr && getHalfSize() < buffer.size()) {
+      // the other half is read while the caller works on this batch
+      ahead_first = batch_first + batch_size;
+      ahead_offset = batch_offset == 0 ? buffer.size() - getHalfSize() : 0;
+      ahead_size = startBatch(ahead_first, ahead_offset, ahead_tickets);
+    }
+    return true;
+  }
+
+  int getBatchSize() const {
+    return batch_size;
+  }
+
+  Block* getBlock(int k) const {
+    return mem->getBlock(buffer[batch_offset + k]);
+  }
+
+  int getMemoryBlockIndex(int k) const {
+    return buffer[batch_offset + k];
+  }
+
+  int getRelationBlockIndex(int k) const {
+    return batch_first + k;
+  }
+
+  // The blocks read whole stay cached in the buffer pool
+  void close() {
+    rewind();
+    mManager.unpinNBlocks(buffer);
+    buffer.clear();
+  }
+};
+
+#endif
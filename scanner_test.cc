@@ -0,0 +1,79 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "scanner.cc"
+#include "test_helpers.cc"
+
+// A relation "t" of 8 blocks, block b holding the tuple (b), and a memory of 10 blocks
+class ScannerTest : public StorageTest {
+ protected:
+  ScannerTest() : StorageTest(10), mManager(&mem) {
+    rel = createIdRelation("t", 8);
+    disk.resetDiskIOs();
+    disk.resetDiskTimer();
+  }
+
+  // Scans the relation with a buffer of max_blocks blocks; returns the ids read, in order,
+  // and the size of every batch
+  std::vector<int> scan(int max_blocks, std::vector<int>& batch_sizes) {
+    std::vector<int> ids;
+    TableScanner scanner(rel, &mem, mManager);
+    EXPECT_TRUE(scanner.open(max_blocks));
+    while (scanner.nextBatch()) {
+      batch_sizes.push_back(scanner.getBatchSize());
+      for (int k = 0; k < scanner.getBatchSize(); ++k) {
+        EXPECT_EQ((int)ids.size(), scanner.getRelationBlockIndex(k));
+        ids.push_back(readId(mem, scanner.getMemoryBlockIndex(k)));
+      }
+    }
+    return ids;
+  }
+
+  MemoryManager mManager;
+  Relation* rel;
+};
+
+TEST_F(ScannerTest, batchesPayOneSeekEach) {
+  std::vector<int> batch_sizes;
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}), scan(4, batch_sizes));
+  EXPECT_EQ(std::vector<int>({4, 4}), batch_sizes);
+  EXPECT_EQ(8UL, disk.getDiskReads());
+  EXPECT_DOUBLE_EQ(2 * disk.estimateAccessTime(4), disk.getDiskTimer());
+}
+
+TEST_F(ScannerTest, theBufferIsSizedToTheFreeMemory) {
+  std::vector<int> taken;
+  ASSERT_TRUE(mManager.getNFreeBlockIndices(taken, 7));
+  std::vector<int> batch_sizes;
+  EXPECT_EQ(8UL, scan(8, batch_sizes).size());
+  EXPECT_EQ(std::vector<int>({3, 3, 2}), batch_sizes);
+  mManager.releaseNBlocks(taken);
+  EXPECT_EQ(10, mManager.numFreeBlocks());
+}
+
+TEST_F(ScannerTest, scatteredFreeBlocksAreReadRunByRun) {
+  // the free blocks are 0, 2, 4, 6 and 8: every block of a batch is a run of its own
+  std::vector<int> taken;
+  ASSERT_TRUE(mManager.getNFreeBlockIndices(taken, 10));
+  for (int i = 0; i < 10; i += 2) {
+    mManager.releaseBlock(taken[i]);
+  }
+  std::vector<int> batch_sizes;
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}), scan(5, batch_sizes));
+  EXPECT_DOUBLE_EQ(8 * disk.estimateAccessTime(1), disk.getDiskTimer());
+}
+
+TEST_F(ScannerTest, aSecondScanFindsTheBlocksInTheBufferPool) {
+  std::vector<int> batch_sizes;
+  scan(8, batch_sizes);
+  disk.resetDiskIOs();
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}), scan(8, batch_sizes));
+  EXPECT_EQ(0UL, disk.getDiskReads());
+  EXPECT_EQ(8UL, mManager.getHits());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
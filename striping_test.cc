@@ -0,0 +1,71 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "test_helpers.cc"
+
+// An empty relation "t", and memory blocks 0 to 7 holding the tuples (0) to (7) to write
+class StripingTest : public StorageTest {
+ protected:
+  StripingTest() : StorageTest(10) {
+    rel = createIdRelation("t", 0);
+    for (int b = 0; b < 8; ++b) {
+      fillIdBlock(mem, rel, b, b);
+    }
+  }
+
+  // The time of an access whose busiest device transfers num_blocks blocks
+  double deviceTime(int num_blocks) {
+    const DiskProfile& profile = disk.getProfile();
+    int num_transfers = (num_blocks + profile.queue_depth - 1) / profile.queue_depth;
+    return profile.seek_time + profile.rotation_latency + profile.transfer_time_per_block * num_transfers;
+  }
+
+  Relation* rel;
+};
+
+TEST_F(StripingTest, devicesServeTheirBlocksInParallel) {
+  ASSERT_TRUE(disk.setNumOfDevices(4));
+  disk.resetDiskIOs();
+  disk.resetDiskTimer();
+  rel->setBlocks(0, 0, 8);
+  EXPECT_EQ(8UL, disk.getDiskIOs());
+  EXPECT_DOUBLE_EQ(deviceTime(2), disk.getDiskTimer());
+  for (int d = 0; d < 4; ++d) {
+    EXPECT_EQ(2UL, disk.getDeviceIOs(d));
+    EXPECT_DOUBLE_EQ(deviceTime(2), disk.getDeviceTimer(d));
+  }
+}
+
+TEST_F(StripingTest, estimatesFollowTheStripe) {
+  EXPECT_DOUBLE_EQ(deviceTime(8), disk.estimateAccessTime(8));
+  ASSERT_TRUE(disk.setNumOfDevices(3));
+  EXPECT_DOUBLE_EQ(deviceTime(3), disk.estimateAccessTime(8));
+  EXPECT_DOUBLE_EQ(deviceTime(1), disk.estimateAccessTime(2));
+  ASSERT_TRUE(disk.setProfile(Disk::getSataSSDProfile()));
+  ASSERT_TRUE(disk.setNumOfDevices(2));
+  // 4 blocks a device, transferred at once
+  EXPECT_DOUBLE_EQ(deviceTime(4), disk.estimateAccessTime(8));
+  EXPECT_DOUBLE_EQ(deviceTime(1), disk.estimateAccessTime(8));
+
+  rel->setBlocks(0, 0, 8);
+  disk.resetDiskTimer();
+  rel->getBlocks(0, 0, 8);
+  EXPECT_DOUBLE_EQ(disk.estimateAccessTime(8), disk.getDiskTimer());
+}
+
+TEST_F(StripingTest, missingDevicesCountNothing) {
+  ASSERT_TRUE(disk.setNumOfDevices(2));
+  rel->setBlocks(0, 0, 8);
+  EXPECT_FALSE(disk.setNumOfDevices(0));
+  EXPECT_EQ(2, disk.getNumOfDevices());
+  EXPECT_EQ(0UL, disk.getDeviceIOs(2));
+  EXPECT_EQ(0UL, disk.getDeviceIOs(-1));
+  EXPECT_EQ(0, disk.getDeviceTimer(2));
+  EXPECT_EQ(0, disk.getDeviceTimer(-1));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
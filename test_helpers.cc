@@ -0,0 +1,66 @@
+#ifndef __TEST_HELPERS_INCLUDED
+#define __TEST_HELPERS_INCLUDED
+
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "./StorageManager/Block.h"
+#include "./StorageManager/Disk.h"
+#include "./StorageManager/MainMemory.h"
+#include "./StorageManager/Relation.h"
+#include "./StorageManager/Schema.h"
+#include "./StorageManager/SchemaManager.h"
+#include "./StorageManager/Tuple.h"
+
+// The schema of the relations of the storage tests: a single INT field "id"
+static Schema getIdSchema() {
+  std::vector<std::string> names = {"id"};
+  std::vector<enum FIELD_TYPE> types = {INT};
+  return Schema(names, types);
+}
+
+// Empties the memory block and puts the tuple (id) of the relation in it
+static void fillIdBlock(MainMemory& mem, Relation* relation, int memory_block_index, int id) {
+  Tuple tuple = relation->createTuple();
+  tuple.setField(0, id);
+  Block* block = mem.getBlock(memory_block_index);
+  block->clear();
+  block->appendTuple(tuple);
+}
+
+// Returns the id of the first tuple in the memory block, -1 if it is empty
+static int readId(MainMemory& mem, int memory_block_index) {
+  std::vector<Tuple> tuples = mem.getBlock(memory_block_index)->getTuples();
+  if (tuples.empty() || tuples[0].isNull()) {
+    return -1;
+  }
+  return tuples[0].getField(0).integer;
+}
+
+// An in-memory disk without latency, a memory of the given number of blocks and their
+// schema manager
+class StorageTest : public ::testing::Test {
+ protected:
+  explicit StorageTest(int memory_blocks) : mem(memory_blocks), schema_manager(&mem, &disk) {
+    disk.setLatencyMode(VIRTUAL_LATENCY);
+  }
+
+  // Creates the relation (id INT) of num_blocks blocks, block b holding the tuple (b).
+  // The blocks are written through memory block 0, which is left empty
+  Relation* createIdRelation(const std::string& name, int num_blocks) {
+    Relation* relation = schema_manager.createRelation(name, getIdSchema());
+    for (int b = 0; b < num_blocks; ++b) {
+      fillIdBlock(mem, relation, 0, b);
+      relation->setBlock(b, 0);
+    }
+    mem.getBlock(0)->clear();
+    return relation;
+  }
+
+  MainMemory mem;
+  Disk disk;
+  SchemaManager schema_manager;
+};
+
+#endif
@@ -81,6 +81,15 @@ public:
     }
   }
 
+  // One value list per tuple of a multi-row INSERT ... VALUES
+  static void getValueLists(ParseTreeNode* root, std::vector<std::vector<std::string>>& value_lists) {
+    ParseTreeNode* insert_tuples = root->children[4];
+    for (int i = 1; i < insert_tuples->children.size(); ++i) {
+      value_lists.push_back(std::vector<std::string>());
+      getValueList(insert_tuples->children[i], value_lists.back());
+    }
+  }
+
   static std::string getTableName(ParseTreeNode* root) {
     return root->children[2]->value;
   }
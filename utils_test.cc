@@ -7,8 +7,9 @@
 #include "utils.cc"
 
 TEST(UtilsTest, AttributeTypeList) {
+  Arena arena;
   std::string test = "CREATE    TABLE test( id INT,    name STR20)";
-  ParseTreeNode* ans = Parser::parseQuery(test);
+  ParseTreeNode* ans = Parser::parseQuery(arena, test);
   std::vector<std::string> cols;
   std::vector<enum FIELD_TYPE> dt;
   Utils::getAttributeTypeList(ans, cols, dt);
@@ -19,8 +20,9 @@ TEST(UtilsTest, AttributeTypeList) {
 }
 
 TEST(UtilsTest, relationName) {
+  Arena arena;
   std::string test = "CREATE    TABLE test( id INT,    name STR20)";
-  ParseTreeNode* ans = Parser::parseQuery(test);
+  ParseTreeNode* ans = Parser::parseQuery(arena, test);
   std::string relationName = Utils::getTableName(ans);
   EXPECT_EQ("test", relationName);
 }
@@ -0,0 +1,202 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test_helpers.cc"
+
+// A disk in a fresh directory. crash() leaves it the way a killed process would:
+// the disk is never destroyed, so neither its destructor nor a checkpoint runs
+class WalTest : public ::testing::Test {
+ protected:
+  WalTest() : mem(4) {
+    char path[] = "/tmp/wal_test_XXXXXX";
+    directory = mkdtemp(path);
+    open();
+  }
+
+  ~WalTest() {
+    delete schema_manager;
+    delete disk;
+    system(("rm -rf " + directory).c_str());
+  }
+
+  void open() {
+    disk = new Disk(directory);
+    disk->setLatencyMode(VIRTUAL_LATENCY);
+    schema_manager = new SchemaManager(&mem, disk);
+  }
+
+  void kill() {
+    schema_manager = nullptr;
+    disk = nullptr;
+  }
+
+  void crash() {
+    kill();
+    open();
+  }
+
+  void restart() {
+    delete schema_manager;
+    delete disk;
+    open();
+  }
+
+  Relation* createRelation(const std::string& name) {
+    return schema_manager->createRelation(name, getIdSchema());
+  }
+
+  // Writes a block holding the tuple (id) at the block index of the relation
+  void writeBlock(Relation* relation, int block_index, int id) {
+    fillIdBlock(mem, relation, 0, id);
+    relation->setBlock(block_index, 0);
+  }
+
+  // Returns the ids of the relation, block after block
+  std::vector<int> readIds(const std::string& name) {
+    std::vector<int> ids;
+    Relation* relation = schema_manager->getRelation(name);
+    for (int i = 0; relation != nullptr && i < relation->getNumOfBlocks(); ++i) {
+      relation->getBlock(i, 0);
+      for (const Tuple& tuple : mem.getBlock(0)->getTuples()) {
+        if (!tuple.isNull()) {
+          ids.push_back(tuple.getField(0).integer);
+        }
+      }
+    }
+    return ids;
+  }
+
+  std::string directory;
+  MainMemory mem;
+  Disk* disk;
+  SchemaManager* schema_manager;
+};
+
+TEST_F(WalTest, committedStatementsSurviveACrash) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  writeBlock(relation, 1, 2);
+  disk->commit();
+  crash();
+  EXPECT_EQ(std::vector<int>({1, 2}), readIds("t"));
+}
+
+TEST_F(WalTest, uncommittedStatementsLeaveNothing) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  disk->commit();
+  writeBlock(relation, 0, 5);
+  writeBlock(relation, 1, 6);
+  crash();
+  EXPECT_EQ(std::vector<int>({1}), readIds("t"));
+}
+
+TEST_F(WalTest, checkpointedStatementsAreInTheTrackFiles) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  disk->commit();
+  disk->checkpoint();
+  writeBlock(relation, 0, 5);
+  relation->deleteBlocks(0);
+  crash();
+  EXPECT_EQ(std::vector<int>({1}), readIds("t"));
+  restart();
+  EXPECT_EQ(std::vector<int>({1}), readIds("t"));
+}
+
+TEST_F(WalTest, aTornRecordEndsTheReplay) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  disk->commit();
+  writeBlock(relation, 1, 2);
+  disk->commit();
+  kill();
+  // the last commit record is cut short
+  std::string path = directory + "/wal";
+  struct stat st;
+  ASSERT_EQ(0, stat(path.c_str(), &st));
+  ASSERT_EQ(0, truncate(path.c_str(), st.st_size - 4));
+  open();
+  EXPECT_EQ(std::vector<int>({1}), readIds("t"));
+}
+
+TEST_F(WalTest, aRemovedTrackIsNotReused) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  writeBlock(relation, 1, 2);
+  disk->commit();
+  disk->checkpoint();
+  schema_manager->deleteRelation("t");
+  relation = createRelation("u");
+  writeBlock(relation, 0, 3);
+  disk->commit();
+  EXPECT_EQ(std::vector<int>({3}), readIds("u"));
+  crash();
+  EXPECT_EQ(std::vector<int>({3}), readIds("u"));
+  restart();
+  EXPECT_EQ(std::vector<int>({3}), readIds("u"));
+}
+
+TEST_F(WalTest, aCommitIsSyncedWhenItReturns) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  unsigned long syncs = disk->getNumOfLogSyncs();
+  disk->commit();
+  EXPECT_EQ(syncs + 1, disk->getNumOfLogSyncs());
+}
+
+TEST_F(WalTest, asynchronousCommitsAreSyncedTogetherLater) {
+  disk->setAsyncCommitDelay(100);
+  Relation* relation = createRelation("t");
+  unsigned long syncs = disk->getNumOfLogSyncs();
+  writeBlock(relation, 0, 1);
+  disk->commit();
+  writeBlock(relation, 1, 2);
+  disk->commit();
+  EXPECT_EQ(syncs, disk->getNumOfLogSyncs());
+  usleep(500000);
+  EXPECT_EQ(syncs + 1, disk->getNumOfLogSyncs());
+  crash();
+  EXPECT_EQ(std::vector<int>({1, 2}), readIds("t"));
+}
+
+TEST_F(WalTest, aDropCutShortLeavesNoBlocks) {
+  Relation* relation = createRelation("t");
+  writeBlock(relation, 0, 1);
+  disk->commit();
+  disk->checkpoint();
+  schema_manager->deleteRelation("t");
+  crash();
+  // the catalog is synced at once, the removal of the track file only with the commit
+  EXPECT_FALSE(schema_manager->relationExists("t"));
+  relation = createRelation("u");
+  EXPECT_EQ(0, relation->getNumOfBlocks());
+  disk->commit();
+  restart();
+  EXPECT_EQ(std::vector<int>(), readIds("u"));
+}
+
+TEST_F(WalTest, temporaryRelationsAreDroppedOnOpen) {
+  Relation* relation = schema_manager->createRelation("tmp", getIdSchema(), false, ROW_LAYOUT, true);
+  writeBlock(relation, 0, 1);
+  disk->commit();
+  disk->checkpoint();
+  crash();
+  EXPECT_FALSE(schema_manager->relationExists("tmp"));
+  // its track is empty for the next relation
+  relation = createRelation("tmp");
+  ASSERT_NE(nullptr, relation);
+  EXPECT_EQ(0, relation->getNumOfBlocks());
+  crash();
+  EXPECT_TRUE(schema_manager->relationExists("tmp"));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}